@@ -44,6 +44,10 @@ static char _CVT_cc[] = "University of Edinburgh $Id$";
 #include "Log.h"
 #include "Task.h"
 #include "ColourTransforms.h"
+#include "Environment.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 using namespace std;
@@ -57,7 +61,6 @@ using namespace std;
  */
 void CVT::run( Session* session, std::string argument ){
 
-  Timer tile_timer;
   this->session = session;
   LOG_INFO("CVT handler reached");
   checkImage();
@@ -76,14 +79,11 @@ void CVT::run( Session* session, std::string argument ){
 
   if( argument == "jpeg" || argument == "png") { // png added by Zsolt Husz, 8/05/2009
 
-    enum CompressionType requestType=JPEG; // png added by Zsolt Husz, 8/05/2009
+    requestType=JPEG; // png added by Zsolt Husz, 8/05/2009
 
     if (argument == "png") // png added by Zsolt Husz, 8/05/2009
       requestType = PNG;
 
-    unsigned int n;
-    int cielab = 0;
-
     LOG_INFO("CVT :: JPEG/PNG output handler reached");
 
     // Get a fake tile in case we are dealing with a sequence
@@ -100,39 +100,32 @@ void CVT::run( Session* session, std::string argument ){
     session->viewParams->setAlpha(requestType==PNG);
     (*session->image)->recomputeChannel(requestType==PNG); //forces channel number update
 
-    int requested_res = session->view->getResolution();
+    resolution = session->view->getResolution();
     im_width = session->view->getImageWidth();
     im_height = session->view->getImageHeight();
 
     LOG_INFO("CVT :: image set to " << im_width << " x " << im_height <<
-	      " using resolution " << requested_res);
+	      " using resolution " << resolution);
 
     // The tile size of the source tile
     unsigned int src_tile_width = (*session->image)->getTileWidth();
     unsigned int src_tile_height = (*session->image)->getTileHeight();
 
-    // The tile size of the destination tile
-    unsigned int dst_tile_width = src_tile_width;
-    unsigned int dst_tile_height = src_tile_height;
-
     // The basic tile size ie. not the current tile
-    unsigned int basic_tile_width = src_tile_width;
+    basic_tile_width = src_tile_width;
 
     unsigned int rem_x = im_width % src_tile_width;
     unsigned int rem_y = im_height % src_tile_height;
 
-    unsigned int channels = (*session->image)->getNumChannels();
+    channels = (*session->image)->getNumChannels();
 
     // The number of tiles in each direction
-    unsigned int ntlx = (im_width / src_tile_width) + (rem_x == 0 ? 0 : 1);
+    ntlx = (im_width / src_tile_width) + (rem_x == 0 ? 0 : 1);
     unsigned int ntly = (im_height / src_tile_height) + (rem_y == 0 ? 0 : 1);
 
     int len;
 
     // If we have a region defined, calculate our viewport
-    unsigned int view_left, view_top, view_width, view_height;
-    unsigned int startx, endx, starty, endy, xoffset, yoffset;
-    unsigned int tile_width_padding;
 
     if( session->view->viewPortSet() ){
 
@@ -167,6 +160,20 @@ void CVT::run( Session* session, std::string argument ){
       endy = ntly;
     }
 
+    // Answer revalidation before rendering anything
+    char params[256];
+    snprintf( params, 256, "CVT,%s,%d,%u,%u,%u,%u,%g,%d,%d,%d,%d",
+	      (requestType == PNG)? "png": "jpeg", resolution,
+	      view_left, view_top, view_width, view_height,
+	      (double) session->view->getContrast(),
+	      (int) session->view->shaded,
+	      session->view->xangle, session->view->yangle,
+	      session->jpeg->getQuality() );
+    string etag = makeETag( session, params );
+    if( sendNotModified( session, etag ) ){
+      LOG_INFO("CVT :: Total command time " << command_timer.getTime() << "us");
+      return;
+    }
 
     // Allocate memory for a strip (tile height x image width)
     unsigned int o_channels = channels;
@@ -192,12 +199,10 @@ void CVT::run( Session* session, std::string argument ){
     // Initialise our PNH compression object
     len = session->png->InitCompression( complete_image, src_tile_height );
 #ifndef DEBUG
-      session->out->printf( // 			  "Pragma: no-cache\r\n"
-			 "Last-Modified: Mon, 1 Jan 2000 00:00:00 GMT\r\n"
-			 "ETag: \"CVT\"\r\n"
- 			 "Content-type: image/png\r\n"
-			 "Content-disposition: inline;filename=\"cvt.png\""
-			 "\r\n\r\n" );
+      session->out->putS( ( cacheHeaders( etag ) +
+			    "Content-type: image/png\r\n"
+			    "Content-disposition: inline;filename=\"cvt.png\""
+			    "\r\n\r\n" ).c_str() );
 #endif
       // Send the PNG header to the client
       if( session->out->putStr( (const char*) complete_image.data, len ) != len ){
@@ -208,12 +213,10 @@ void CVT::run( Session* session, std::string argument ){
 
         session->jpeg->InitCompression( complete_image, src_tile_height );
 #ifndef DEBUG
-      session->out->printf( // 			  "Pragma: no-cache\r\n"
-			 "Last-Modified: Mon, 1 Jan 2000 00:00:00 GMT\r\n"
-			 "ETag: \"CVT\"\r\n"
- 			 "Content-type: image/jpeg\r\n"
-			 "Content-disposition: inline;filename=\"cvt.jpg\""
-			 "\r\n\r\n" );
+      session->out->putS( ( cacheHeaders( etag ) +
+			    "Content-type: image/jpeg\r\n"
+			    "Content-disposition: inline;filename=\"cvt.jpg\""
+			    "\r\n\r\n" ).c_str() );
 #endif
     // Send the JPEG header to the client
       len = session->jpeg->getHeaderSize();
@@ -222,148 +225,69 @@ void CVT::run( Session* session, std::string argument ){
       }
     }
 
-    // Decode the image strip by strip and dynamically compress with JPEG
-
-    for( unsigned int i=starty; i<endy; i++ ){
-      unsigned int buffer_index = 0;
-      // Keep track of the current pixel boundary horizontally. ie. only up
-      //  to the beginning of the current tile boundary.
-      int current_width = 0;
-
-      for( unsigned int j=startx; j<endx; j++ ){
-        LOG_COND_INFO(tile_timer.start());
-	// Get an uncompressed tile from our TileManager
-	TileManager tilemanager( session->tileCache, *session->image, session->jpeg, session->png);
-	RawTile rawtile = tilemanager.getTile( requested_res, (i*ntlx) + j, session->view->xangle, session->view->yangle, UNCOMPRESSED );
-
-	LOG_INFO("CVT :: Tile access time " << tile_timer.getTime() << "us");
-
-	// Check the colour space - CIELAB images will need to be converted
-	if( (*session->image)->getColourSpace() == CIELAB ){
-	  cielab = 1;
-	  LOG_INFO("CVT :: Converting from CIELAB->sRGB");
-	}
-
-#ifdef WLZ_IIP_LOG
-	// Only log this out once per image
-        if((logCat != NULL) &&
-	   (logCat->getPriority() >= log4cpp::Priority::INFO) &&
-	   (i==starty) && (j==starty))
+    // Make sure the image information and hash are up to date before
+    // any tiles or strips are rendered concurrently
+    (*session->image)->loadImageInfo( session->view->xangle, session->view->yangle );
+    (void) (*session->image)->getHash();
+    error.clear();
+
+    // Woolz views need no per pixel conversion unless shaded or contrast
+    // adjusted, so may be rendered a strip at a time straight into the
+    // strip buffer rather than through the tiles (CVT_DIRECT=0 disables this)
+    WlzImage* wlzImage = dynamic_cast<WlzImage*>( *session->image );
+    if( wlzImage && Environment::getCVTDirect() &&
+	!session->view->shaded && (session->view->getContrast() == 1.0) &&
+	((*session->image)->getColourSpace() != CIELAB) ){
+      LOG_INFO("CVT :: Rendering strips directly");
+      this->sendRegionStrips( wlzImage, complete_image, bufDest );
+    }
+    else{
+
+      // Render the tiles of the view port in raster order. With OpenMP the
+      // tiles are rendered in parallel by a team of threads while one
+      // thread of the team compresses and sends the strips, in order, as
+      // soon as all of their tiles are available.
+      unsigned int ntx = endx - startx;
+      unsigned int nty = endy - starty;
+      tiles.assign( ntx * nty, (RawTile*) NULL );
+      stripDone.assign( nty, 0 );
+      pthread_mutex_init( &stripMutex, NULL );
+      pthread_cond_init( &stripCond, NULL );
+      bool parallel = false;
+
+#ifdef _OPENMP
+      parallel = (omp_get_max_threads() > 1) && (ntx * nty > 1);
+      if( parallel ){
+#pragma omp parallel
 	{
-	  LOG_INFO("CVT :: Tile data is " << rawtile.channels <<
-	            " channels, " << rawtile.bpc << " bits per channel");
-	}
-#endif
-	// Set the tile width and height to be that of the source tile
-	// - Use the rawtile data because if we take a tile from cache
-	//   the image pointer will not necessarily be pointing to the
-	//   the current tile
-	//	src_tile_width = (*session->image)->getTileWidth();
-	//	src_tile_height = (*session->image)->getTileHeight();
-	src_tile_width = rawtile.width;
-	src_tile_height = rawtile.height;
-	tile_width_padding = rawtile.width_padding;
-	dst_tile_width = src_tile_width;
-	dst_tile_height = src_tile_height;
-
-	// Variables for the pixel offset within the current tile
-	unsigned int xf = 0;
-	unsigned int yf = 0;
-
-	// If our viewport has been set, we need to modify our start
-	// and end points on the source image
-	if( session->view->viewPortSet() ){
-
-	  if( j == startx ){
-	    // Calculate the width used in the current tile
-	    // If there is only 1 tile, the width is just the view width
-	    if( j < endx - 1 ) dst_tile_width = src_tile_width - xoffset;
-	    else dst_tile_width = view_width;
-	    xf = xoffset;
-	  }
-	  else if( j == endx-1 ){
-	    dst_tile_width = (view_width+view_left) % basic_tile_width;
-	  }
-
-	  if( i == starty ){
-	    // Calculate the height used in the current row of tiles
-	    // If there is only 1 row the height is just the view height
-	    if( i < endy - 1 ) dst_tile_height = src_tile_height - yoffset;
-	    else dst_tile_height = view_height;
-	    yf = yoffset;
-  
-	  }
-	  else if( i == endy-1 ){
-	    dst_tile_height = (view_height+view_top) % basic_tile_width;
-  	  }
-	  LOG_INFO("CVT :: destination tile height: " << dst_tile_height <<
-	            ", tile width: " << dst_tile_width);
-	}
-
-
-	// Copy our tile data into the appropriate part of the strip memory
-	// one whole tile width at a time
-	for( unsigned int k=0; k<dst_tile_height; k++ ){
+	  // The first thread to get here compresses the strips while the
+	  // others render the tiles, unless it is the only thread
+	  bool team = omp_get_num_threads() > 1;
 
-	  buffer_index = (current_width*channels) + (k*view_width*channels);
-	  unsigned int inx = ((k+yf)*(basic_tile_width-tile_width_padding)*channels) + (xf*channels);
-	  unsigned char* ptr = (unsigned char*) rawtile.data; 
+#pragma omp single nowait
+	  this->sendStrips( team, complete_image, bufDest );
 
-	  // If we have a CIELAB image, convert each pixel to sRGB first
-	  // Otherwise just do a fast memcpy
-	  if( cielab ){
-	    for( n=0; n<dst_tile_width*channels; n+=channels ){
-              iip_LAB2sRGB( &ptr[inx + n], &bufDest[buffer_index + n] );
+	  if( team ){
+#pragma omp for schedule(dynamic) nowait
+	    for( int k = 0; k < (int) (ntx * nty); k++ ){
+	      this->renderTile( k );
 	    }
 	  }
-	  else if( session->view->shaded ){
-	    int m;
-	    for( n=0, m=0; n<dst_tile_width*channels; n+=channels, m++ ){
-              shade( &ptr[inx + n], &bufDest[current_width + (k*view_width) + m],
-		     session->view->shade[0], session->view->shade[1],
-		     session->view->getContrast() );
-	    }
-	  }
-	  // If we have a 16 bit image, multiply by the contrast adjustment if it exists
-	  // and clip to 8 bits
-	  else if( rawtile.bpc == 16 ){
-	    unsigned short* sptr = (unsigned short*) rawtile.data;
-	    for( n=0; n<dst_tile_width*channels; n++ ){
-	      float v = (float)sptr[inx+n] * session->view->getContrast();
-	      if( v > 255.0 ) v = 255.0;
-              bufDest[buffer_index + n] = (unsigned char) v;
-	    }
-	  }
-	  else if( (rawtile.bpc == 8) && (session->view->getContrast() != 1.0) ){
-	    unsigned char* sptr = (unsigned char*) rawtile.data;
-	    for( n=0; n<dst_tile_width*channels; n++ ){
-	      float v = (float)sptr[inx+n] * session->view->getContrast();
-	      if( v > 255.0 ) v = 255.0;
-              bufDest[buffer_index + n] = (unsigned char) v;
-	    }
-          } else {
-                memcpy( &bufDest[buffer_index],	&ptr[inx], dst_tile_width*channels );
-          }
 	}
-	current_width += dst_tile_width;
       }
+#endif
+      if( !parallel ) this->sendStrips( false, complete_image, bufDest );
 
-      // Compress the strip
-      if(requestType == PNG) // png added by Zsolt Husz, 8/05/2009
-        len = session->png->CompressStrip( bufDest, dst_tile_height );
-      else
-        len = session->jpeg->CompressStrip( bufDest, dst_tile_height );  // bug fix 15/05/2009
-
-      LOG_INFO("CVT :: Compressed data strip length is " << len);
-
-      // Send this strip out to the client
-      if(len != session->out->putStr((const char* )complete_image.data, len)){
-	LOG_ERROR("CVT :: Error writing jpeg strip data: " << len);
-      }
+      for( unsigned int k = 0; k < tiles.size(); k++ ) delete tiles[k];
+      tiles.clear();
+      pthread_cond_destroy( &stripCond );
+      pthread_mutex_destroy( &stripMutex );
+    }
 
-      if( session->out->flush() == -1 ) {
-	LOG_ERROR("CVT :: Error flushing jpeg tile");
-      }
+    if( error.length() ){
+      if( bufDest != buf ) delete[] bufDest;
+      delete[] buf;
+      throw error;
     }
 
     // Finish off the image compression
@@ -397,3 +321,313 @@ void CVT::run( Session* session, std::string argument ){
   // Total CVT response time
   LOG_INFO("CVT :: Total command time " << command_timer.getTime() << "us");
 }
+
+
+
+/**
+ * Renders a single tile of the view port and marks it as done in its
+ * strip. Safe to call concurrently. If an earlier tile failed the tile
+ * is not rendered but is still counted.
+ * @param k index of the tile within the view port in raster order
+ */
+void CVT::renderTile( unsigned int k ){
+
+  Timer tile_timer;
+  RawTile *rawtile = NULL;
+  unsigned int ntx = endx - startx;
+  unsigned int i = starty + (k / ntx);
+  unsigned int j = startx + (k % ntx);
+
+  pthread_mutex_lock( &stripMutex );
+  bool failed = (error.length() > 0);
+  pthread_mutex_unlock( &stripMutex );
+
+  if( !failed ){
+    LOG_COND_INFO(tile_timer.start());
+    try{
+      // Get an uncompressed tile from our TileManager
+      TileManager tilemanager( session->tileCache, *session->image, session->jpeg, session->png);
+      rawtile = new RawTile( tilemanager.getTile( resolution, (i*ntlx) + j,
+						  session->view->xangle,
+						  session->view->yangle,
+						  UNCOMPRESSED ) );
+    }
+    catch( const string& e ){
+      pthread_mutex_lock( &stripMutex );
+      if( error.length() == 0 ) error = e;
+      pthread_mutex_unlock( &stripMutex );
+    }
+    catch( ... ){
+      pthread_mutex_lock( &stripMutex );
+      if( error.length() == 0 ) error = "CVT :: Tile rendering failed";
+      pthread_mutex_unlock( &stripMutex );
+    }
+    LOG_INFO("CVT :: Tile access time " << tile_timer.getTime() << "us");
+  }
+
+  pthread_mutex_lock( &stripMutex );
+  tiles[k] = rawtile;
+  stripDone[i - starty]++;
+  pthread_cond_broadcast( &stripCond );
+  pthread_mutex_unlock( &stripMutex );
+}
+
+
+
+/**
+ * Copies the tiles of each strip into the strip buffer, then compresses
+ * and sends it. Strips are processed in order and their tiles freed.
+ * @param wait if true wait for the tiles of each strip to be rendered
+ *        by other threads, otherwise render them here
+ * @param complete_image raw tile holding the compressed output buffer
+ * @param bufDest strip buffer
+ */
+void CVT::sendStrips( bool wait, RawTile& complete_image, unsigned char* bufDest ){
+
+  unsigned int n;
+  int cielab = 0;
+  unsigned int ntx = endx - startx;
+  unsigned int src_tile_width, src_tile_height;
+  unsigned int dst_tile_width = 0, dst_tile_height = 0;
+  unsigned int tile_width_padding;
+
+  // Decode the image strip by strip and dynamically compress with JPEG
+
+  for( unsigned int i=starty; i<endy; i++ ){
+    unsigned int buffer_index = 0;
+    // Keep track of the current pixel boundary horizontally. ie. only up
+    //  to the beginning of the current tile boundary.
+    int current_width = 0;
+
+    // Wait for, or render, the tiles of this strip
+    if( !wait ){
+      for( unsigned int j=startx; j<endx; j++ ){
+	this->renderTile( ((i - starty) * ntx) + (j - startx) );
+      }
+    }
+    pthread_mutex_lock( &stripMutex );
+    while( (stripDone[i - starty] < ntx) && (error.length() == 0) ){
+      pthread_cond_wait( &stripCond, &stripMutex );
+    }
+    bool failed = (error.length() > 0);
+    pthread_mutex_unlock( &stripMutex );
+    if( failed ) break;
+
+    for( unsigned int j=startx; j<endx; j++ ){
+      RawTile& rawtile = *tiles[ ((i - starty) * ntx) + (j - startx) ];
+
+      // Check the colour space - CIELAB images will need to be converted
+      if( (*session->image)->getColourSpace() == CIELAB ){
+	cielab = 1;
+	LOG_INFO("CVT :: Converting from CIELAB->sRGB");
+      }
+
+#ifdef WLZ_IIP_LOG
+      // Only log this out once per image
+      if((logCat != NULL) &&
+	 (logCat->getPriority() >= log4cpp::Priority::INFO) &&
+	 (i==starty) && (j==starty))
+      {
+	LOG_INFO("CVT :: Tile data is " << rawtile.channels <<
+		  " channels, " << rawtile.bpc << " bits per channel");
+      }
+#endif
+      // Set the tile width and height to be that of the source tile
+      // - Use the rawtile data because if we take a tile from cache
+      //   the image pointer will not necessarily be pointing to the
+      //   the current tile
+      //	src_tile_width = (*session->image)->getTileWidth();
+      //	src_tile_height = (*session->image)->getTileHeight();
+      src_tile_width = rawtile.width;
+      src_tile_height = rawtile.height;
+      tile_width_padding = rawtile.width_padding;
+      dst_tile_width = src_tile_width;
+      dst_tile_height = src_tile_height;
+
+      // Variables for the pixel offset within the current tile
+      unsigned int xf = 0;
+      unsigned int yf = 0;
+
+      // If our viewport has been set, we need to modify our start
+      // and end points on the source image
+      if( session->view->viewPortSet() ){
+
+	if( j == startx ){
+	  // Calculate the width used in the current tile
+	  // If there is only 1 tile, the width is just the view width
+	  if( j < endx - 1 ) dst_tile_width = src_tile_width - xoffset;
+	  else dst_tile_width = view_width;
+	  xf = xoffset;
+	}
+	else if( j == endx-1 ){
+	  dst_tile_width = (view_width+view_left) % basic_tile_width;
+	}
+
+	if( i == starty ){
+	  // Calculate the height used in the current row of tiles
+	  // If there is only 1 row the height is just the view height
+	  if( i < endy - 1 ) dst_tile_height = src_tile_height - yoffset;
+	  else dst_tile_height = view_height;
+	  yf = yoffset;
+
+	}
+	else if( i == endy-1 ){
+	  dst_tile_height = (view_height+view_top) % basic_tile_width;
+	}
+	LOG_INFO("CVT :: destination tile height: " << dst_tile_height <<
+		  ", tile width: " << dst_tile_width);
+      }
+
+
+      // Copy our tile data into the appropriate part of the strip memory
+      // one whole tile width at a time
+      for( unsigned int k=0; k<dst_tile_height; k++ ){
+
+	buffer_index = (current_width*channels) + (k*view_width*channels);
+	unsigned int inx = ((k+yf)*(basic_tile_width-tile_width_padding)*channels) + (xf*channels);
+	unsigned char* ptr = (unsigned char*) rawtile.data; 
+
+	// If we have a CIELAB image, convert each pixel to sRGB first
+	// Otherwise just do a fast memcpy
+	if( cielab ){
+	  for( n=0; n<dst_tile_width*channels; n+=channels ){
+	    iip_LAB2sRGB( &ptr[inx + n], &bufDest[buffer_index + n] );
+	  }
+	}
+	else if( session->view->shaded ){
+	  int m;
+	  for( n=0, m=0; n<dst_tile_width*channels; n+=channels, m++ ){
+	    shade( &ptr[inx + n], &bufDest[current_width + (k*view_width) + m],
+		   session->view->shade[0], session->view->shade[1],
+		   session->view->getContrast() );
+	  }
+	}
+	// If we have a 16 bit image, multiply by the contrast adjustment if it exists
+	// and clip to 8 bits
+	else if( rawtile.bpc == 16 ){
+	  unsigned short* sptr = (unsigned short*) rawtile.data;
+	  for( n=0; n<dst_tile_width*channels; n++ ){
+	    float v = (float)sptr[inx+n] * session->view->getContrast();
+	    if( v > 255.0 ) v = 255.0;
+	    bufDest[buffer_index + n] = (unsigned char) v;
+	  }
+	}
+	else if( (rawtile.bpc == 8) && (session->view->getContrast() != 1.0) ){
+	  unsigned char* sptr = (unsigned char*) rawtile.data;
+	  for( n=0; n<dst_tile_width*channels; n++ ){
+	    float v = (float)sptr[inx+n] * session->view->getContrast();
+	    if( v > 255.0 ) v = 255.0;
+	    bufDest[buffer_index + n] = (unsigned char) v;
+	  }
+	} else {
+	      memcpy( &bufDest[buffer_index],	&ptr[inx], dst_tile_width*channels );
+	}
+      }
+      current_width += dst_tile_width;
+    }
+
+    // The tiles of this strip are no longer needed
+    pthread_mutex_lock( &stripMutex );
+    for( unsigned int j=startx; j<endx; j++ ){
+      unsigned int k = ((i - starty) * ntx) + (j - startx);
+      delete tiles[k];
+      tiles[k] = NULL;
+    }
+    pthread_mutex_unlock( &stripMutex );
+
+    this->sendStrip( complete_image, bufDest, dst_tile_height );
+  }
+}
+
+
+
+/**
+ * Renders each strip of the view port of a Woolz image straight into the
+ * strip buffer, sectioning the whole strip at once rather than tile by
+ * tile, then compresses and sends it. With OpenMP the rows of each strip
+ * are split into bands which are rendered in parallel. Errors are left
+ * in error and stop further strips being sent.
+ * @param image the Woolz image
+ * @param complete_image raw tile holding the compressed output buffer
+ * @param bufDest strip buffer
+ */
+void CVT::sendRegionStrips( WlzImage* image, RawTile& complete_image, unsigned char* bufDest ){
+
+  unsigned int src_tile_height = image->getTileHeight();
+
+  for( unsigned int i=starty; i<endy; i++ ){
+
+    Timer strip_timer;
+
+    // The rows of the view port which fall within this strip
+    unsigned int top = i * src_tile_height;
+    unsigned int bottom = top + src_tile_height;
+    if( top < view_top ) top = view_top;
+    if( bottom > view_top + view_height ) bottom = view_top + view_height;
+    if( bottom <= top ) continue;
+    unsigned int height = bottom - top;
+
+    LOG_COND_INFO(strip_timer.start());
+    int nBand = 1;
+#ifdef _OPENMP
+    nBand = omp_get_max_threads();
+    if( nBand > (int) height ) nBand = height;
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for( int b = 0; b < nBand; b++ ){
+      unsigned int r0 = (height * b) / nBand;
+      unsigned int r1 = (height * (b + 1)) / nBand;
+      WlzIVertex2 pos, size;
+      pos.vtX = view_left;
+      pos.vtY = top + r0;
+      size.vtX = view_width;
+      size.vtY = r1 - r0;
+      try{
+	image->renderRegion( bufDest + (r0 * view_width * channels), pos, size,
+			     image->getNumResolutions() - 1 - resolution );
+      }
+      catch( const string& e ){
+#pragma omp critical (cvt_error)
+	if( error.length() == 0 ) error = e;
+      }
+      catch( ... ){
+#pragma omp critical (cvt_error)
+	if( error.length() == 0 ) error = "CVT :: Strip rendering failed";
+      }
+    }
+    if( error.length() ) break;
+    LOG_INFO("CVT :: Strip render time " << strip_timer.getTime() << "us");
+
+    this->sendStrip( complete_image, bufDest, height );
+  }
+}
+
+
+
+/**
+ * Compresses a strip and sends it to the client.
+ * @param complete_image raw tile holding the compressed output buffer
+ * @param bufDest strip buffer
+ * @param height number of rows in the strip
+ */
+void CVT::sendStrip( RawTile& complete_image, unsigned char* bufDest, unsigned int height ){
+
+  int len;
+
+  // Compress the strip
+  if(requestType == PNG) // png added by Zsolt Husz, 8/05/2009
+    len = session->png->CompressStrip( bufDest, height );
+  else
+    len = session->jpeg->CompressStrip( bufDest, height );  // bug fix 15/05/2009
+
+  LOG_INFO("CVT :: Compressed data strip length is " << len);
+
+  // Send this strip out to the client
+  if(len != session->out->putStr((const char* )complete_image.data, len)){
+    LOG_ERROR("CVT :: Error writing jpeg strip data: " << len);
+  }
+
+  if( session->out->flush() == -1 ) {
+    LOG_ERROR("CVT :: Error flushing jpeg tile");
+  }
+}
@@ -11,7 +11,7 @@ static char _Cache_h[] = "University of Edinburgh $Id$";
 /*  IIP Image Server
 
     Copyright (C) 2005-2006 Ruven Pillay.
-    Based on an LRU cache by Patrick Audley <http://blackcat.ca/lifeline/query.php/tag=LRU_CACHE>
+    Originally based on an LRU cache by Patrick Audley <http://blackcat.ca/lifeline/query.php/tag=LRU_CACHE>
     Copyright (C) 2004 by Patrick Audley
 
     This program is free software; you can redistribute it and/or modify
@@ -61,113 +61,332 @@ namespace __gnu_cxx
 #endif
 
 #include <iostream>
-#include <list>
+#include <map>
+#include <vector>
 #include <string>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
 #include "RawTile.h"
+#include "CacheKey.h"
+#include "SharedTileCache.h"
+
+
+/// Number of independently locked shards, must be a power of 2
+#define CACHE_SHARDS 16
 
 
 
 /// Cache to store raw tile data
+/** The cache is split into CACHE_SHARDS shards selected by the hash of
+ *  the tile key, each with its own lock, size limit and CLOCK
+ *  replacement policy, so that concurrent request workers rarely
+ *  contend for a lock. Tiles are keyed by a compact binary CacheKey.
+ *  The tile data is held separately from the keys, stored once for
+ *  each distinct content and reference counted, so identical tiles
+ *  (eg background tiles or the same view reached through different
+ *  parameters) only take the memory of one. The memory of shared
+ *  data is charged to the shard of the tile which first stored it.
+ *  An optional shared memory cache may be set as a second level to
+ *  share tiles between server processes.
+ */
 
 class Cache {
 
 
  private:
 
-  /// Max memory size in bytes
-  unsigned long maxSize;
+  /// Tile data shared by all the cached tiles with the same content
+  struct Payload {
+    unsigned long long hash[2];
+    void *data;
+    unsigned int length;
+    unsigned int refs;
+    /// Shard charged for the data
+    unsigned int shard;
+    /// False if the data is not in the payload index (a hash collision)
+    bool indexed;
+  };
 
-  /// Basic object storage size
-  int tileSize;
+  /// Key of the payload index, the content hash and length
+  struct PayloadKey {
+    unsigned long long hash[2];
+    unsigned int length;
+  };
+
+  struct PayloadKeyLess {
+    bool operator()( const PayloadKey& a, const PayloadKey& b ) const {
+      if( a.hash[0] != b.hash[0] ) return a.hash[0] < b.hash[0];
+      if( a.hash[1] != b.hash[1] ) return a.hash[1] < b.hash[1];
+      return a.length < b.length;
+    }
+  };
 
-  /// Current memory running total
-  unsigned long currentSize;
+  typedef std::map < PayloadKey, Payload*, PayloadKeyLess > PayloadMap;
 
-  /// Main cache storage typedef
-#ifdef POOL_ALLOCATOR
-  typedef std::list < std::pair<const std::string,RawTile>,
-    __gnu_cxx::__pool_alloc< std::pair<const std::string,RawTile> > > TileList;
-#else
-  typedef std::list < std::pair<const std::string,RawTile> > TileList;
-#endif
+  /// A shard of the payload index
+  struct PayloadShard {
+    pthread_mutex_t mutex;
+    PayloadMap payloads;
+  };
 
-  /// Main cache list iterator typedef
-  typedef std::list < std::pair<const std::string,RawTile> >::iterator List_Iter;
+  /// A cached tile together with its CLOCK reference bit
+  /** The tile refers to the payload data rather than owning a copy. */
+  struct Entry {
+    CacheKey key;
+    RawTile tile;
+    Payload *payload;
+    unsigned long size;
+    bool referenced;
+    Entry( const CacheKey& k, const RawTile& r, Payload *p, unsigned long s ) :
+      key( k ), tile( r.tileNum, r.resolution, r.hSequence, r.vSequence,
+		      r.width, r.height, r.channels, r.bpc ),
+      payload( p ), size( s ), referenced( true ) {
+      tile.compressionType = r.compressionType;
+      tile.quality = r.quality;
+      tile.filename = r.filename;
+      tile.width_padding = r.width_padding;
+      tile.data = p->data;
+      tile.dataLength = p->length;
+      tile.localData = 0;
+    };
+  };
 
-  /// Index typedef
+  /// Index typedef mapping keys to slots of the CLOCK ring
 #ifdef USE_HASHMAP
 #ifdef POOL_ALLOCATOR
-  typedef __gnu_cxx::hash_map < const std::string, List_Iter,
-    __gnu_cxx::hash< const std::string >,
-    std::equal_to< const std::string >,
-    __gnu_cxx::__pool_alloc< std::pair<const std::string, List_Iter> >
+  typedef __gnu_cxx::hash_map < CacheKey, unsigned int, CacheKeyHash,
+    std::equal_to< CacheKey >,
+    __gnu_cxx::__pool_alloc< std::pair<const CacheKey, unsigned int> >
     > TileMap;
 #else
-  typedef __gnu_cxx::hash_map < const std::string,List_Iter > TileMap;
+  typedef __gnu_cxx::hash_map < CacheKey, unsigned int, CacheKeyHash > TileMap;
 #endif
 #else
-  typedef std::map < const std::string,List_Iter > TileMap;
+  struct CacheKeyLess {
+    bool operator()( const CacheKey& a, const CacheKey& b ) const {
+      return memcmp( &a, &b, sizeof( CacheKey ) ) < 0;
+    }
+  };
+  typedef std::map < CacheKey, unsigned int, CacheKeyLess > TileMap;
 #endif
 
-  /// Main cache storage object
-  TileList tileList;
+  /// A single shard of the cache
+  struct Shard {
+    /// Mutex protecting the shard
+    pthread_mutex_t mutex;
+    /// CLOCK ring of entries, NULL slots are free
+    std::vector<Entry*> ring;
+    /// Indices of free slots in the ring
+    std::vector<unsigned int> freeSlots;
+    /// Index from key to ring slot
+    TileMap tileMap;
+    /// Position of the CLOCK hand in the ring
+    unsigned int hand;
+    /// Current memory running total
+    unsigned long currentSize;
+    /// Number of hits, misses and evictions
+    unsigned long hits, misses, evictions;
+    /// Memory of payloads charged to this shard which have been freed
+    /// while it was not locked, updated atomically
+    unsigned long released;
+  };
+
+  /// Max memory size in bytes of each shard
+  unsigned long maxSize;
+
+  /// Basic object storage size
+  int tileSize;
+
+  /// Payload storage overhead
+  int payloadSize;
+
+  /// The shards
+  Shard shards[CACHE_SHARDS];
+
+  /// The payload index shards, always locked after any tile shard
+  PayloadShard payloadShards[CACHE_SHARDS];
 
-  /// Main Cache storage index object
-  TileMap tileMap;
+  /// Optional second level cache shared between processes
+  SharedTileCache *sharedCache;
 
 
-  /// Internal touch function
-  /** Touches a key in the Cache and makes it the most recently used
-   *  @param key to be touched
-   *  @return a Map_Iter pointing to the key that was touched.
+  /// Return the shard for a key
+  Shard& _shard( const CacheKey& key ) {
+    size_t h = key.hash();
+    return shards[ (h ^ (h >> 17)) & (CACHE_SHARDS - 1) ];
+  }
+
+
+  /// Account for payloads charged to a shard which have been freed,
+  /// the shard must be locked
+  void _settle( Shard& s ) {
+    s.currentSize -= __sync_fetch_and_and( &s.released, 0UL );
+  }
+
+
+  /// Get the payload for a tile's data, storing it if there is none
+  /** @param r tile
+   *  @param h content hash of the tile data
+   *  @param shard index of the shard to charge if the data is stored
+   *  @param created set true if the data was stored
+   *  @return payload with its reference count incremented, or NULL if
+   *          the data can not be stored
    */
-  TileMap::iterator _touch( const std::string &key ) {
-    TileMap::iterator miter = tileMap.find( key );
-    if( miter == tileMap.end() ) return miter;
-    // Move the found node to the head of the list.
-    tileList.splice( tileList.begin(), tileList, miter->second );
-    return miter;
+  Payload* _acquire( const RawTile& r, const unsigned long long h[2],
+		     unsigned int shard, bool& created ) {
+    PayloadKey pk;
+    pk.hash[0] = h[0]; pk.hash[1] = h[1];
+    pk.length = r.dataLength;
+    PayloadShard& ps = payloadShards[ h[0] & (CACHE_SHARDS - 1) ];
+    bool collision = false;
+
+    created = false;
+    pthread_mutex_lock( &ps.mutex );
+    PayloadMap::iterator piter = ps.payloads.find( pk );
+    if( piter != ps.payloads.end() ){
+      Payload *p = piter->second;
+      if( memcmp( p->data, r.data, p->length ) == 0 ){
+	p->refs++;
+	pthread_mutex_unlock( &ps.mutex );
+	return p;
+      }
+      collision = true;
+    }
+    Payload *p = new Payload;
+    p->data = malloc( r.dataLength );
+    if( p->data == NULL ){
+      pthread_mutex_unlock( &ps.mutex );
+      delete p;
+      return NULL;
+    }
+    memcpy( p->data, r.data, r.dataLength );
+    p->hash[0] = h[0]; p->hash[1] = h[1];
+    p->length = r.dataLength;
+    p->refs = 1;
+    p->shard = shard;
+    p->indexed = !collision;
+    if( p->indexed ) ps.payloads[ pk ] = p;
+    pthread_mutex_unlock( &ps.mutex );
+    created = true;
+    return p;
   }
 
 
-  /// Interal remove function
-  /**
-   *  @param miter Map_Iter that points to the key to remove
-   *  @warning miter is now longer usable after being passed to this function.
+  /// Release a reference to a payload, freeing it with its last reference
+  /** The memory of a freed payload is credited to the shard which was
+   *  charged for it when that shard is next locked.
+   *  @param p payload
    */
-  void _remove( const TileMap::iterator &miter ) {
-    // Reduce our current size counter
-    currentSize -= ( (miter->second->second).dataLength + (miter->second->second).filename.length()*sizeof(char) + tileSize );
-    tileList.erase( miter->second );
-    tileMap.erase( miter );
+  void _release( Payload *p ) {
+    PayloadShard& ps = payloadShards[ p->hash[0] & (CACHE_SHARDS - 1) ];
+
+    pthread_mutex_lock( &ps.mutex );
+    if( --(p->refs) > 0 ){
+      pthread_mutex_unlock( &ps.mutex );
+      return;
+    }
+    if( p->indexed ){
+      PayloadKey pk;
+      pk.hash[0] = p->hash[0]; pk.hash[1] = p->hash[1];
+      pk.length = p->length;
+      ps.payloads.erase( pk );
+    }
+    pthread_mutex_unlock( &ps.mutex );
+    __sync_fetch_and_add( &shards[ p->shard ].released,
+			  (unsigned long)( p->length + payloadSize ) );
+    free( p->data );
+    delete p;
   }
 
 
-  /// Interal remove function
-  /** @param key to remove */
-  void _remove( const std::string &key ) {
-    TileMap::iterator miter = tileMap.find( key );
-    this->_remove( miter );
+  /// Internal eviction function, the shard must be locked
+  /** Advances the CLOCK hand clearing reference bits and evicts the
+   *  first unreferenced entry it finds.
+   *  @param s shard
+   */
+  void _evict( Shard& s ) {
+    for( ;; ){
+      if( s.hand >= s.ring.size() ) s.hand = 0;
+      Entry *e = s.ring[ s.hand ];
+      if( e ){
+	if( e->referenced ) e->referenced = false;
+	else{
+	  s.tileMap.erase( e->key );
+	  s.currentSize -= e->size;
+	  s.ring[ s.hand ] = NULL;
+	  s.freeSlots.push_back( s.hand );
+	  s.evictions++;
+	  s.hand++;
+	  this->_release( e->payload );
+	  delete e;
+	  this->_settle( s );
+	  return;
+	}
+      }
+      s.hand++;
+    }
   }
 
 
+  /// Sum a shard counter over all shards
+  unsigned long _sum( unsigned long Shard::*counter ) {
+    unsigned long n = 0;
+    for( int i = 0; i < CACHE_SHARDS; i++ ){
+      pthread_mutex_lock( &shards[i].mutex );
+      this->_settle( shards[i] );
+      n += shards[i].*counter;
+      pthread_mutex_unlock( &shards[i].mutex );
+    }
+    return n;
+  }
+
 
  public:
 
   /// Constructor
   /** @param max Maximum cache size in MB */
   Cache( float max ) {
-    maxSize = (unsigned long)(max*1024000) ; currentSize = 0;
-    // 128 added at the end represents 2*average strings lengths
-    tileSize = sizeof( RawTile ) + sizeof( std::pair<const std::string,RawTile> ) +
-      sizeof( std::pair<const std::string, List_Iter> ) + 128;
+    maxSize = (unsigned long)(max*1024000) / CACHE_SHARDS;
+    sharedCache = NULL;
+    // 64 added at the end represents the vector and index overheads
+    tileSize = sizeof( Entry ) + sizeof( std::pair<const CacheKey, unsigned int> ) + 64;
+    payloadSize = sizeof( Payload ) + sizeof( std::pair<const PayloadKey, Payload*> ) + 32;
+    for( int i = 0; i < CACHE_SHARDS; i++ ){
+      Shard& s = shards[i];
+      pthread_mutex_init( &s.mutex, NULL );
+      s.hand = 0; s.currentSize = 0;
+      s.hits = s.misses = s.evictions = 0;
+      s.released = 0;
+      pthread_mutex_init( &payloadShards[i].mutex, NULL );
+    }
   };
 
 
   /// Destructor
   ~Cache() {
-    tileList.clear();
-    tileMap.clear();
+    for( int i = 0; i < CACHE_SHARDS; i++ ){
+      Shard& s = shards[i];
+      for( unsigned int j = 0; j < s.ring.size(); j++ ){
+	if( s.ring[j] ){
+	  this->_release( s.ring[j]->payload );
+	  delete s.ring[j];
+	}
+      }
+      s.ring.clear();
+      s.tileMap.clear();
+    }
+    for( int i = 0; i < CACHE_SHARDS; i++ ){
+      pthread_mutex_destroy( &shards[i].mutex );
+      pthread_mutex_destroy( &payloadShards[i].mutex );
+    }
+  }
+
+
+  /// Set the second level shared cache
+  /** @param s Shared cache, or NULL for none */
+  void setSharedCache( SharedTileCache *s ) {
+    sharedCache = ( s && s->isValid() ) ? s : NULL;
   }
 
 
@@ -175,49 +394,106 @@ class Cache {
   /** @param r Tile to be inserted */
   void insert( const RawTile& r ) {
 
-    if( maxSize == 0 ) return;
+    if( maxSize == 0 && sharedCache == NULL ) return;
 
-    std::string key = this->getIndex( r.filename, r.resolution, r.tileNum,
-				      r.hSequence, r.vSequence, r.compressionType, r.quality );
+    CacheKey key = this->getIndex( r.filename, r.resolution, r.tileNum,
+				   r.hSequence, r.vSequence, r.compressionType, r.quality );
 
-    // Touch the key, if it exists
-    TileMap::iterator miter = this->_touch( key );
+    if( sharedCache ) sharedCache->insert( key, r );
 
-    // If this index already exists, do nothing
-    if( miter != tileMap.end() ) return;
+    if( maxSize == 0 ) return;
+
+    // Don't let a single tile flush the whole shard
+    if( (unsigned long)( r.dataLength + payloadSize + tileSize ) > maxSize ) return;
 
-    // Store the key if it doesn't already exist in our cache
-    // Ok, do the actual insert at the head of the list
-    tileList.push_front( std::make_pair(key,r) );
+    // Hash the data before taking any lock
+    unsigned long long h[2];
+    hash128( (const char*) r.data, r.dataLength, h );
 
-    // And store this in our map
-    List_Iter liter = tileList.begin();
-    tileMap[ key ] = liter;
+    Shard& s = this->_shard( key );
+    pthread_mutex_lock( &s.mutex );
+    this->_settle( s );
+
+    // If this index already exists, just mark it as referenced
+    TileMap::iterator miter = s.tileMap.find( key );
+    if( miter != s.tileMap.end() ){
+      s.ring[ miter->second ]->referenced = true;
+      pthread_mutex_unlock( &s.mutex );
+      return;
+    }
 
-    // Update our total current size variable
-    currentSize += (r.dataLength + r.filename.length()*sizeof(char) + tileSize);
+    // Share the data of an identical tile if there is one
+    bool created;
+    Payload *p = this->_acquire( r, h, &s - shards, created );
+    if( p == NULL ){
+      pthread_mutex_unlock( &s.mutex );
+      return;
+    }
+    unsigned long size = tileSize + ( created ? r.dataLength + payloadSize : 0 );
+
+    // Make room for the new tile before inserting it. Shared data charged
+    // to this shard may outlive its tiles, so the shard may empty first.
+    while( s.currentSize + size > maxSize && !s.tileMap.empty() ) this->_evict( s );
+    if( s.currentSize + size > maxSize ){
+      this->_release( p );
+      this->_settle( s );
+      pthread_mutex_unlock( &s.mutex );
+      return;
+    }
 
-    // Check to see if we need to remove an element due to exceeding max_size
-    while( currentSize > maxSize ) {
-      // Remove the last element.
-      liter = tileList.end();
-      --liter;
-      this->_remove( liter->first );
+    unsigned int slot;
+    Entry *e = new Entry( key, r, p, tileSize );
+    if( s.freeSlots.empty() ){
+      slot = s.ring.size();
+      s.ring.push_back( e );
+    }
+    else{
+      slot = s.freeSlots.back();
+      s.freeSlots.pop_back();
+      s.ring[ slot ] = e;
     }
+    s.tileMap[ key ] = slot;
+    s.currentSize += size;
 
+    pthread_mutex_unlock( &s.mutex );
   }
 
 
   /// Return the number of tiles in the cache
-  unsigned int getNumElements() { return tileList.size(); }
+  unsigned int getNumElements() {
+    unsigned int n = 0;
+    for( int i = 0; i < CACHE_SHARDS; i++ ){
+      pthread_mutex_lock( &shards[i].mutex );
+      n += shards[i].tileMap.size();
+      pthread_mutex_unlock( &shards[i].mutex );
+    }
+    return n;
+  }
 
 
   /// Return the number of MB stored
-  float getMemorySize() { return (float) ( currentSize / 1024000.0 ); }
+  float getMemorySize() {
+    return (float) ( this->_sum( &Shard::currentSize ) / 1024000.0 );
+  }
+
+
+  /// Return the number of cache hits
+  unsigned long getHits() { return this->_sum( &Shard::hits ); }
+
+
+  /// Return the number of cache misses
+  unsigned long getMisses() { return this->_sum( &Shard::misses ); }
+
+
+  /// Return the number of tiles evicted from the cache
+  unsigned long getEvictions() { return this->_sum( &Shard::evictions ); }
 
 
   /// Get a tile from the cache
-  /** 
+  /** The cached tile is copied into the given tile while its shard is
+   *  locked, so the copy remains valid even if another thread evicts
+   *  the cached tile. Tiles not in this cache are looked for in the
+   *  shared cache.
    *  @param f filename
    *  @param r resolution number
    *  @param t tile number
@@ -225,19 +501,38 @@ class Cache {
    *  @param v vertical sequence number
    *  @param c compression type
    *  @param q compression quality
-   *  @return pointer to data or NULL on error
+   *  @param dst default constructed tile into which the cached tile is
+   *         copied
+   *  @return dst or NULL if the tile is not in the cache
    */
-  RawTile* getTile( std::string f, int r, int t, int h, int v, CompressionType c, int q ) {
-
-    if( maxSize == 0 ) return NULL;
-
-    std::string key = this->getIndex( f, r, t, h, v, c, q );
-
-    TileMap::iterator miter = tileMap.find( key );
-    if( miter == tileMap.end() ) return NULL;
-    this->_touch( key );
+  RawTile* getTile( std::string f, int r, int t, int h, int v, CompressionType c, int q,
+		    RawTile* dst ) {
+
+    if( maxSize == 0 && sharedCache == NULL ) return NULL;
+
+    CacheKey key = this->getIndex( f, r, t, h, v, c, q );
+
+    if( maxSize ){
+      Shard& s = this->_shard( key );
+      pthread_mutex_lock( &s.mutex );
+      TileMap::iterator miter = s.tileMap.find( key );
+      if( miter != s.tileMap.end() ){
+	Entry *e = s.ring[ miter->second ];
+	e->referenced = true;
+	s.hits++;
+	*dst = e->tile;
+	pthread_mutex_unlock( &s.mutex );
+	return dst;
+      }
+      s.misses++;
+      pthread_mutex_unlock( &s.mutex );
+    }
 
-    return &(miter->second->second);
+    if( sharedCache && sharedCache->getTile( key, dst ) ){
+      dst->filename = f;
+      return dst;
+    }
+    return NULL;
   }
 
 
@@ -250,12 +545,10 @@ class Cache {
    *  @param v vertical sequence number
    *  @param c compression type
    *  @param q compression quality
-   *  @return string
+   *  @return key
    */
-  std::string getIndex( std::string f, int r, int t, int h, int v, CompressionType c, int q ) {
-    char tmp[100];
-    snprintf( tmp, 100, ":%d:%d:%d:%d:%d:%d", r, t, h, v, c, q );
-    return f+std::string( tmp );
+  CacheKey getIndex( const std::string& f, int r, int t, int h, int v, CompressionType c, int q ) {
+    return CacheKey( f, r, t, h, v, c, q );
   }
 
 
@@ -0,0 +1,192 @@
+#ifndef _CACHEKEY_H
+#define _CACHEKEY_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _CacheKey_h[] = "University of Edinburgh $Id$";
+#endif
+
+// Tile Cache Key
+
+/*  IIP Image Server
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include "RawTile.h"
+
+
+
+/// Rotate a 64 bit value left
+inline unsigned long long hash128Rotl( unsigned long long x, int r ) {
+  return (x << r) | (x >> (64 - r));
+}
+
+
+/// Final avalanche of a 64 bit hash half
+inline unsigned long long hash128Mix( unsigned long long k ) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+
+/// Compute a 128 bit hash of a byte string
+/** This is MurmurHash3 x64_128 (Austin Appleby, public domain) with a zero
+ *  seed. It consumes 16 bytes per round in two independent lanes and mixes
+ *  all 128 bits, so collisions are negligible for cache keys. Values are
+ *  read in the host's byte order, which is fine as hashes are never
+ *  shared between machines.
+ *  @param s bytes to hash
+ *  @param n number of bytes
+ *  @param h returned hash
+ */
+inline void hash128( const char *s, size_t n, unsigned long long h[2] ) {
+  const unsigned long long c1 = 0x87c37b91114253d5ULL;
+  const unsigned long long c2 = 0x4cf5ad432745937fULL;
+  const unsigned char *p = (const unsigned char*) s;
+  const size_t nblocks = n / 16;
+  unsigned long long h1 = 0, h2 = 0, k1, k2;
+
+  for( size_t i = 0; i < nblocks; i++, p += 16 ){
+    memcpy( &k1, p, 8 );
+    memcpy( &k2, p + 8, 8 );
+    k1 *= c1; k1 = hash128Rotl( k1, 31 ); k1 *= c2; h1 ^= k1;
+    h1 = hash128Rotl( h1, 27 ); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = hash128Rotl( k2, 33 ); k2 *= c1; h2 ^= k2;
+    h2 = hash128Rotl( h2, 31 ); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+
+  // The remaining 0 to 15 bytes
+  const size_t tail = n & 15;
+  k1 = k2 = 0;
+  for( size_t i = tail; i > 8; i-- ){
+    k2 ^= (unsigned long long) p[i - 1] << (8 * (i - 9));
+  }
+  if( tail > 8 ){
+    k2 *= c2; k2 = hash128Rotl( k2, 33 ); k2 *= c1; h2 ^= k2;
+  }
+  for( size_t i = (tail < 8)? tail: 8; i > 0; i-- ){
+    k1 ^= (unsigned long long) p[i - 1] << (8 * (i - 1));
+  }
+  if( tail > 0 ){
+    k1 *= c1; k1 = hash128Rotl( k1, 31 ); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= n; h2 ^= n;
+  h1 += h2; h2 += h1;
+  h1 = hash128Mix( h1 ); h2 = hash128Mix( h2 );
+  h1 += h2; h2 += h1;
+  h[0] = h1; h[1] = h2;
+}
+
+
+
+/// Compact fixed size key identifying a tile in the tile caches
+/** The image (for Woolz images the view) is identified by a 128 bit
+ *  hash of its name rather than the name itself, so keys are cheap to
+ *  compare and hash and may be stored in shared memory.
+ */
+struct CacheKey {
+
+  /// 128 bit hash of the image name
+  unsigned long long image[2];
+
+  /// Resolution number
+  int resolution;
+
+  /// Tile number
+  int tileNum;
+
+  /// Horizontal sequence number
+  int hSequence;
+
+  /// Vertical sequence number
+  int vSequence;
+
+  /// Compression type
+  int compressionType;
+
+  /// Compression quality
+  int quality;
+
+
+  /// Default constructor
+  CacheKey() {
+    image[0] = image[1] = 0;
+    resolution = tileNum = hSequence = vSequence = 0;
+    compressionType = UNCOMPRESSED; quality = 0;
+  }
+
+
+  /// Constructor
+  /**
+   *  @param f image name
+   *  @param r resolution number
+   *  @param t tile number
+   *  @param h horizontal sequence number
+   *  @param v vertical sequence number
+   *  @param c compression type
+   *  @param q compression quality
+   */
+  CacheKey( const std::string &f, int r, int t, int h, int v,
+	    CompressionType c, int q ) {
+    hash128( f.data(), f.length(), image );
+    resolution = r; tileNum = t; hSequence = h; vSequence = v;
+    compressionType = c; quality = q;
+  }
+
+
+  /// Return a hash of the whole key
+  size_t hash() const {
+    unsigned long long x = image[0] ^ (image[1] * 31ULL);
+    x ^= (unsigned long long) tileNum * 0x9e3779b97f4a7c15ULL;
+    x ^= ((unsigned long long) resolution << 48) ^
+	 ((unsigned long long) hSequence << 32) ^
+	 ((unsigned long long) vSequence << 16) ^
+	 ((unsigned long long) compressionType << 8) ^
+	 (unsigned long long) quality;
+    x ^= x >> 29;
+    return (size_t) x;
+  }
+
+
+  /// Equality operator
+  friend bool operator == ( const CacheKey& A, const CacheKey& B ) {
+    return( A.image[0] == B.image[0] && A.image[1] == B.image[1] &&
+	    A.tileNum == B.tileNum && A.resolution == B.resolution &&
+	    A.hSequence == B.hSequence && A.vSequence == B.vSequence &&
+	    A.compressionType == B.compressionType && A.quality == B.quality );
+  }
+
+};
+
+
+
+/// Hash function object for CacheKey
+struct CacheKeyHash {
+  size_t operator()( const CacheKey& k ) const { return k.hash(); }
+};
+
+
+
+#endif
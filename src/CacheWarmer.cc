@@ -0,0 +1,310 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _CacheWarmer_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         CacheWarmer.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Warming of the caches from a manifest of objects and views.
+* \ingroup	WlzIIPServer
+*/
+
+#include <sched.h>
+#include <algorithm>
+#include <fstream>
+#include "Log.h"
+#include "CacheWarmer.h"
+#include "Task.h"
+#include "Tokenizer.h"
+#include "TileManager.h"
+#include "JPEGCompressor.h"
+#include "PNGCompressor.h"
+#include "IIPResponse.h"
+#include "View.h"
+#include "ViewParameters.h"
+#include "WlzImage.h"
+#include "Timer.h"
+
+using namespace std;
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Reads the manifest and starts the threads which warm the
+* 		caches. Nothing is done if there is no manifest or no
+* 		threads are requested.
+* \param	tileCache		Tile cache into which tiles are
+* 					inserted.
+* \param	manifest		Manifest file name, may be empty.
+* \param	nThreads		Number of warming threads.
+* \param	maxTiles		Maximum number of tiles rendered for
+* 					each entry.
+* \param	jpegQuality		JPEG quality of the tiles.
+*/
+CacheWarmer::CacheWarmer(Cache *tileCache, const string &manifest,
+			 int nThreads, int maxTiles, int jpegQuality)
+{
+  this->tileCache = tileCache;
+  this->maxTiles = maxTiles;
+  this->jpegQuality = jpegQuality;
+  this->nThreads = 0;
+  threads = NULL;
+  stop = false;
+  next = 0;
+  nDone = 0;
+  nFailed = 0;
+  pthread_mutex_init(&mutex, NULL);
+  if(manifest.empty() || (nThreads < 1))
+  {
+    return;
+  }
+  ifstream	in(manifest.c_str());
+  string	line;
+
+  if(!in)
+  {
+    LOG_ERROR("CacheWarmer :: Failed to open manifest " << manifest);
+    return;
+  }
+  while(getline(in, line))
+  {
+    size_t	b = line.find_first_not_of(" \t\r"),
+    		e = line.find_last_not_of(" \t\r");
+
+    if((b != string::npos) && (line[b] != '#'))
+    {
+      entries.push_back(line.substr(b, e - b + 1));
+    }
+  }
+  LOG_INFO("CacheWarmer :: Warming " << entries.size() <<
+           " entries from " << manifest);
+  if(entries.empty())
+  {
+    return;
+  }
+  threads = new pthread_t[nThreads];
+  for(int i = 0; i < nThreads; ++i)
+  {
+    if(pthread_create(&(threads[this->nThreads]), NULL,
+		      CacheWarmer::run, this) != 0)
+    {
+      LOG_ERROR("CacheWarmer :: Failed to create warming thread " << i);
+    }
+    else
+    {
+      ++(this->nThreads);
+    }
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Stops warming and waits for the threads to finish the
+* 		entries they are warming.
+*/
+CacheWarmer::~CacheWarmer()
+{
+  pthread_mutex_lock(&mutex);
+  stop = true;
+  pthread_mutex_unlock(&mutex);
+  for(int i = 0; i < nThreads; ++i)
+  {
+    (void )pthread_join(threads[i], NULL);
+  }
+  delete[] threads;
+  pthread_mutex_destroy(&mutex);
+}
+
+/*!
+* \return	NULL.
+* \ingroup	WlzIIPServer
+* \brief	Entry point of a warming thread, which runs at the lowest
+* 		scheduling priority where supported so that requests are
+* 		served first.
+* \param	arg			The warmer.
+*/
+void		*CacheWarmer::run(void *arg)
+{
+#ifdef SCHED_IDLE
+  struct sched_param param;
+
+  param.sched_priority = 0;
+  (void )pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+  ((CacheWarmer *)arg)->work();
+  return(NULL);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Warms entries until all have been warmed or the warmer is
+* 		destroyed, logging progress.
+*/
+void		CacheWarmer::work()
+{
+  pthread_mutex_lock(&mutex);
+  while(!stop && (next < entries.size()))
+  {
+    Timer	timer;
+    const size_t idx = next++;
+
+    pthread_mutex_unlock(&mutex);
+    timer.start();
+    const bool	ok = warm(entries[idx]);
+    const unsigned int t = timer.getTime();
+    pthread_mutex_lock(&mutex);
+    ++((ok)? nDone: nFailed);
+    LOG_INFO("CacheWarmer :: " << (ok? "Warmed": "Failed to warm") <<
+	     " entry " << (idx + 1) << " of " << entries.size() <<
+	     " in " << t << "us: " << entries[idx]);
+    if(nDone + nFailed == (int )entries.size())
+    {
+      LOG_INFO("CacheWarmer :: Warming complete, " << nDone <<
+               " entries warmed and " << nFailed << " failed");
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \return	True if the entry was warmed.
+* \ingroup	WlzIIPServer
+* \brief	Runs the commands of an entry, so loading its object into
+* 		the object cache and making its view structures, then
+* 		renders its tiles into the tile cache, coarsest
+* 		resolution first, until the tile limit is reached.
+* 		Commands which would send a response are ignored.
+* \param	entry			Manifest entry.
+*/
+bool		CacheWarmer::warm(const string &entry)
+{
+  bool		ok = false;
+  IIPImage	*image = NULL;
+  JPEGCompressor jpeg(jpegQuality);
+  PNGCompressor png;
+  View		view;
+  IIPResponse	response;
+  ViewParameters viewParams;
+  imageCacheMapType imageCache;
+  Session	session;
+
+  session.image = &image;
+  session.response = &response;
+  session.view = &view;
+  session.viewParams = &viewParams;
+  session.jpeg = &jpeg;
+  session.png = &png;
+  session.imageCache = &imageCache;
+  session.tileCache = tileCache;
+  session.prefetcher = NULL;
+  session.out = NULL;
+  try
+  {
+    Tokenizer	izer(entry, "&");
+
+    while(izer.hasMoreTokens())
+    {
+      const string token = izer.nextToken();
+      const size_t n = token.find_first_of("=");
+      if(n == string::npos)
+      {
+        continue;
+      }
+      string	command = token.substr(0, n);
+      const string argument = token.substr(n + 1);
+
+      transform(command.begin(), command.end(), command.begin(), ::tolower);
+      if((command == "wlz") || (command == "qlt") || (command == "sds") ||
+         (command == "dst") || (command == "yaw") || (command == "pit") ||
+	 (command == "rol") || (command == "mod") || (command == "fxp") ||
+	 (command == "fxt") || (command == "upv") || (command == "rmd") ||
+	 (command == "scl") || (command == "sel") || (command == "map"))
+      {
+	Task	*task = Task::factory(command);
+
+	if(task)
+	{
+	  try
+	  {
+	    task->run(&session, argument);
+	  }
+	  catch(...)
+	  {
+	    delete task;
+	    throw;
+	  }
+	  delete task;
+	}
+      }
+      else
+      {
+        LOG_WARN("CacheWarmer :: Ignoring command " << command);
+      }
+    }
+    WlzImage	*wlzImage = dynamic_cast<WlzImage *>(image);
+    if(wlzImage == NULL)
+    {
+      throw string("no Woolz object given");
+    }
+    wlzImage->loadImageInfo(view.xangle, view.yangle);
+    TileManager	tileManager(tileCache, wlzImage, &jpeg, &png);
+    int		nTiles = 0;
+    for(int r = 0; (r < wlzImage->getNumResolutions()) &&
+                   (nTiles < maxTiles); ++r)
+    {
+      unsigned int width,
+      		height;
+
+      wlzImage->getLevelSize(wlzImage->getNumResolutions() - 1 - r,
+                             width, height);
+      const int	nT = ((width + wlzImage->getTileWidth() - 1) /
+                      wlzImage->getTileWidth()) *
+		     ((height + wlzImage->getTileHeight() - 1) /
+		      wlzImage->getTileHeight());
+      for(int t = 0; (t < nT) && (nTiles < maxTiles); ++t, ++nTiles)
+      {
+	(void )tileManager.getTile(r, t, view.xangle, view.yangle, JPEG);
+      }
+    }
+    ok = true;
+  }
+  catch(const string &error)
+  {
+    LOG_WARN("CacheWarmer :: " << error);
+  }
+  catch(...)
+  {
+    LOG_WARN("CacheWarmer :: Failed to warm " << entry);
+  }
+  delete image;
+  return(ok);
+}
@@ -0,0 +1,90 @@
+#ifndef _CACHEWARMER_H
+#define _CACHEWARMER_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _CacheWarmer_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         CacheWarmer.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Warming of the caches from a manifest of objects and views.
+* \ingroup	WlzIIPServer
+*/
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "Cache.h"
+
+/*!
+* \brief	Loads and sections the objects and views listed in a
+* 		manifest, and renders their coarsest tiles into the tile
+* 		cache, on low priority background threads while the
+* 		server accepts requests. Each line of the manifest is a
+* 		query string, as sent by a client but without any command
+* 		which sends a response, for example
+* \verbatim
+  wlz=/opt/data/atlas.wlz&mod=zeta&fxp=256,256,128&pit=90&yaw=0&dst=0
+\endverbatim
+* 		Blank lines and lines starting with '#' are ignored.
+* 		Progress is reported in the log.
+* \ingroup	WlzIIPServer
+*/
+class CacheWarmer
+{
+  private:
+    Cache		*tileCache;		/*!< Tile cache. */
+    int			maxTiles;		/*!< Maximum number of tiles
+    						     rendered per entry. */
+    int			jpegQuality;		/*!< JPEG quality of tiles. */
+    int			nThreads;		/*!< Number of threads. */
+    pthread_t		*threads;		/*!< Warming threads. */
+    pthread_mutex_t	mutex;			/*!< Protects the following. */
+    bool		stop;			/*!< Set to stop the threads. */
+    size_t		next;			/*!< Next entry to warm. */
+    int			nDone;			/*!< Number of entries
+    						     warmed. */
+    int			nFailed;		/*!< Number of entries which
+    						     failed. */
+    std::vector<std::string> entries;		/*!< Manifest entries. */
+    static void		*run(void *arg);
+    void		work();
+    bool		warm(const std::string &entry);
+
+  public:
+    CacheWarmer(Cache *tileCache, const std::string &manifest,
+                int nThreads, int maxTiles, int jpegQuality);
+    ~CacheWarmer();
+};
+
+#endif
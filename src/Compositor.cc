@@ -0,0 +1,1036 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _Compositor_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         Compositor.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Fixed point compositing of grey value intervals into
+* 		interleaved 8 bit tile buffers.
+* \ingroup	WlzIIPServer
+*/
+
+#include <cstring>
+#include "Compositor.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COMPOSITOR_X86
+#include <immintrin.h>
+#endif
+
+static CompositorISA		CompositorInit(void);
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Source values used for domains without values.
+*/
+static WlzUByte			compositorWhite[COMPOSITOR_CHUNK];
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Best instruction set supported by the host, found once at
+* 		start up.
+*/
+static const CompositorISA	compositorISA = CompositorInit();
+
+/*!
+* \return	Best supported instruction set.
+* \ingroup	WlzIIPServer
+* \brief	Sets up the domain source values and finds the best
+* 		instruction set, for which there are kernels, that is
+* 		supported by the host.
+*/
+static CompositorISA		CompositorInit(void)
+{
+  CompositorISA	isa = COMPOSITOR_ISA_SCALAR;
+
+  (void )memset(compositorWhite, 255, COMPOSITOR_CHUNK);
+#ifdef COMPOSITOR_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+  {
+    isa = COMPOSITOR_ISA_AVX2;
+  }
+  else if(__builtin_cpu_supports("sse4.1"))
+  {
+    isa = COMPOSITOR_ISA_SSE4;
+  }
+#endif
+  return(isa);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Compositing kernels for byte values. The general template
+* 		is the portable kernel, which is also used for the pixels
+* 		left over by the vector kernels.
+*/
+template <int NCH, int MODE, int ISA>
+struct CompositorBytes
+{
+  /*!
+  * \ingroup	WlzIIPServer
+  * \brief	Composites byte values into the buffer.
+  * \param	c			Compositor.
+  * \param	dst			Destination buffer.
+  * \param	src			Source values.
+  * \param	n			Number of source values.
+  */
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const WlzUByte *src,
+				  int n)
+  {
+    for(int i = 0; i < n; ++i)
+    {
+      const unsigned int s = src[i];
+
+      for(int k = 0; k < NCH; ++k)
+      {
+	if(MODE == COMPOSITOR_MODE_REPLACE)
+	{
+	  dst[k] = s | c->set[k];
+	}
+	else
+	{
+	  unsigned int v = (s * c->w[k]) + c->bias[k];
+
+	  if(MODE == COMPOSITOR_MODE_BLEND)
+	  {
+	    v += dst[k] * c->wD[k];
+	  }
+	  dst[k] = v >> 8;
+	}
+      }
+      dst += NCH;
+    }
+  }
+};
+
+#ifdef COMPOSITOR_X86
+/*!
+* \ingroup	WlzIIPServer
+* \brief	SSE4.1 compositing kernel for byte values.
+*/
+template <int NCH, int MODE>
+struct CompositorBytes<NCH, MODE, COMPOSITOR_ISA_SSE4>
+{
+  /*!
+  * \ingroup	WlzIIPServer
+  * \brief	Composites byte values into the buffer. Blocks of 16
+  * 		pixels are composited as NCH vectors of 16 bytes, with
+  * 		each vector's source bytes gathered by a shuffle.
+  * \param	c			Compositor.
+  * \param	dst			Destination buffer.
+  * \param	src			Source values.
+  * \param	n			Number of source values.
+  */
+  __attribute__((target("sse4.1")))
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const WlzUByte *src,
+				  int n)
+  {
+    int		i = 0;
+    // Bytes of the source read for each block.
+    const int	span = (((NCH - 1) * 16) / NCH) + 16;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i	shuf[NCH],
+		set[NCH],
+		wLo[NCH],
+		wHi[NCH],
+		wDLo[NCH],
+		wDHi[NCH],
+		bLo[NCH],
+		bHi[NCH];
+
+    for(int k = 0; k < NCH; ++k)
+    {
+      shuf[k] = _mm_loadu_si128((const __m128i *)(c->shuf16[k]));
+      set[k] = _mm_cmpeq_epi8(shuf[k], _mm_set1_epi8((char )0x80));
+      wLo[k] = _mm_loadu_si128((const __m128i *)(c->w16[k]));
+      wHi[k] = _mm_loadu_si128((const __m128i *)(c->w16[k] + 8));
+      wDLo[k] = _mm_loadu_si128((const __m128i *)(c->wD16[k]));
+      wDHi[k] = _mm_loadu_si128((const __m128i *)(c->wD16[k] + 8));
+      bLo[k] = _mm_loadu_si128((const __m128i *)(c->bias16[k]));
+      bHi[k] = _mm_loadu_si128((const __m128i *)(c->bias16[k] + 8));
+    }
+    for(; i + span <= n; i += 16)
+    {
+      for(int k = 0; k < NCH; ++k)
+      {
+	__m128i	s;
+	__m128i	*dp = (__m128i *)(dst + (i * NCH) + (16 * k));
+
+	s = _mm_loadu_si128((const __m128i *)(src + i + ((16 * k) / NCH)));
+	if(NCH > 1)
+	{
+	  s = _mm_shuffle_epi8(s, shuf[k]);
+	}
+	if(MODE == COMPOSITOR_MODE_REPLACE)
+	{
+	  s = _mm_or_si128(s, set[k]);
+	}
+	else
+	{
+	  __m128i lo,
+		  hi;
+
+	  lo = _mm_add_epi16(
+	       _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), wLo[k]), bLo[k]);
+	  hi = _mm_add_epi16(
+	       _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), wHi[k]), bHi[k]);
+	  if(MODE == COMPOSITOR_MODE_BLEND)
+	  {
+	    __m128i d = _mm_loadu_si128(dp);
+
+	    lo = _mm_add_epi16(lo,
+		 _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), wDLo[k]));
+	    hi = _mm_add_epi16(hi,
+		 _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), wDHi[k]));
+	  }
+	  s = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+	}
+	_mm_storeu_si128(dp, s);
+      }
+    }
+    CompositorBytes<NCH, MODE, COMPOSITOR_ISA_SCALAR>::run(c, dst + (i * NCH),
+    							  src + i, n - i);
+  }
+};
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	AVX2 compositing kernel for byte values.
+*/
+template <int NCH, int MODE>
+struct CompositorBytes<NCH, MODE, COMPOSITOR_ISA_AVX2>
+{
+  /*!
+  * \ingroup	WlzIIPServer
+  * \brief	Composites byte values into the buffer. Blocks of 32
+  * 		pixels are composited as NCH vectors of 32 bytes. The
+  * 		shuffle only works within 16 byte lanes, so the source
+  * 		bytes of each vector are first broadcast to both lanes.
+  * \param	c			Compositor.
+  * \param	dst			Destination buffer.
+  * \param	src			Source values.
+  * \param	n			Number of source values.
+  */
+  __attribute__((target("avx2")))
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const WlzUByte *src,
+				  int n)
+  {
+    int		i = 0;
+    // Bytes of the source read for each block.
+    const int	span = (NCH == 1)? 32: (((NCH - 1) * 32) / NCH) + 16;
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i	shuf[NCH],
+		set[NCH],
+		wLo[NCH],
+		wHi[NCH],
+		wDLo[NCH],
+		wDHi[NCH],
+		bLo[NCH],
+		bHi[NCH];
+
+    for(int k = 0; k < NCH; ++k)
+    {
+      shuf[k] = _mm256_loadu_si256((const __m256i *)(c->shuf32[k]));
+      set[k] = _mm256_cmpeq_epi8(shuf[k], _mm256_set1_epi8((char )0x80));
+      wLo[k] = _mm256_loadu_si256((const __m256i *)(c->w32[k]));
+      wHi[k] = _mm256_loadu_si256((const __m256i *)(c->w32[k] + 16));
+      wDLo[k] = _mm256_loadu_si256((const __m256i *)(c->wD32[k]));
+      wDHi[k] = _mm256_loadu_si256((const __m256i *)(c->wD32[k] + 16));
+      bLo[k] = _mm256_loadu_si256((const __m256i *)(c->bias32[k]));
+      bHi[k] = _mm256_loadu_si256((const __m256i *)(c->bias32[k] + 16));
+    }
+    for(; i + span <= n; i += 32)
+    {
+      for(int k = 0; k < NCH; ++k)
+      {
+	__m256i	s;
+	__m256i	*dp = (__m256i *)(dst + (i * NCH) + (32 * k));
+
+	if(NCH == 1)
+	{
+	  s = _mm256_loadu_si256((const __m256i *)(src + i));
+	}
+	else
+	{
+	  s = _mm256_broadcastsi128_si256(
+	      _mm_loadu_si128((const __m128i *)(src + i + ((32 * k) / NCH))));
+	  s = _mm256_shuffle_epi8(s, shuf[k]);
+	}
+	if(MODE == COMPOSITOR_MODE_REPLACE)
+	{
+	  s = _mm256_or_si256(s, set[k]);
+	}
+	else
+	{
+	  __m256i lo,
+		  hi;
+
+	  lo = _mm256_add_epi16(
+	       _mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), wLo[k]),
+	       bLo[k]);
+	  hi = _mm256_add_epi16(
+	       _mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), wHi[k]),
+	       bHi[k]);
+	  if(MODE == COMPOSITOR_MODE_BLEND)
+	  {
+	    __m256i d = _mm256_loadu_si256(dp);
+
+	    lo = _mm256_add_epi16(lo,
+		 _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), wDLo[k]));
+	    hi = _mm256_add_epi16(hi,
+		 _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), wDHi[k]));
+	  }
+	  s = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8),
+				  _mm256_srli_epi16(hi, 8));
+	}
+	_mm256_storeu_si256(dp, s);
+      }
+    }
+    CompositorBytes<NCH, MODE, COMPOSITOR_ISA_SCALAR>::run(c, dst + (i * NCH),
+    							  src + i, n - i);
+  }
+};
+#endif /* COMPOSITOR_X86 */
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Clamps values to bytes.
+* \param	dst			Destination for the bytes.
+* \param	src			Source values.
+* \param	n			Number of values.
+*/
+template <typename T>
+static void			CompositorNarrow(
+				  WlzUByte *dst,
+				  const T *src,
+				  int n)
+{
+  for(int i = 0; i < n; ++i)
+  {
+    const T	v = src[i];
+
+    dst[i] = (v > 0)? ((v < 255)? (WlzUByte )v: 255): 0;
+  }
+}
+
+#ifdef __SSE2__
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Clamps short values to bytes.
+* \param	dst			Destination for the bytes.
+* \param	src			Source values.
+* \param	n			Number of values.
+*/
+static void			CompositorNarrow(
+				  WlzUByte *dst,
+				  const short *src,
+				  int n)
+{
+  int		i = 0;
+
+  for(; i + 16 <= n; i += 16)
+  {
+    __m128i	a = _mm_loadu_si128((const __m128i *)(src + i)),
+		b = _mm_loadu_si128((const __m128i *)(src + i + 8));
+
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+  }
+  CompositorNarrow<short>(dst + i, src + i, n - i);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Clamps int values to bytes.
+* \param	dst			Destination for the bytes.
+* \param	src			Source values.
+* \param	n			Number of values.
+*/
+static void			CompositorNarrow(
+				  WlzUByte *dst,
+				  const int *src,
+				  int n)
+{
+  int		i = 0;
+
+  for(; i + 16 <= n; i += 16)
+  {
+    __m128i	a = _mm_packs_epi32(
+		    _mm_loadu_si128((const __m128i *)(src + i)),
+		    _mm_loadu_si128((const __m128i *)(src + i + 4))),
+		b = _mm_packs_epi32(
+		    _mm_loadu_si128((const __m128i *)(src + i + 8)),
+		    _mm_loadu_si128((const __m128i *)(src + i + 12)));
+
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+  }
+  CompositorNarrow<int>(dst + i, src + i, n - i);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Clamps float values to bytes, NaN becomes zero.
+* \param	dst			Destination for the bytes.
+* \param	src			Source values.
+* \param	n			Number of values.
+*/
+static void			CompositorNarrow(
+				  WlzUByte *dst,
+				  const float *src,
+				  int n)
+{
+  int		i = 0;
+  const __m128 	lo = _mm_setzero_ps(),
+  		hi = _mm_set1_ps(255.0f);
+  __m128i	v[4];
+
+  for(; i + 16 <= n; i += 16)
+  {
+    for(int k = 0; k < 4; ++k)
+    {
+      // _mm_max_ps() returns its second operand for NaN.
+      v[k] = _mm_cvttps_epi32(
+             _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + (4 * k)), lo), hi));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i),
+		     _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]),
+				      _mm_packs_epi32(v[2], v[3])));
+  }
+  CompositorNarrow<float>(dst + i, src + i, n - i);
+}
+#endif /* __SSE2__ */
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Compositing kernels for each type of source value. The
+* 		general template clamps the values to bytes a chunk at a
+* 		time and composites the bytes.
+*/
+template <typename T, int NCH, int MODE, int ISA>
+struct CompositorRun
+{
+  /*!
+  * \ingroup	WlzIIPServer
+  * \brief	Composites values into the buffer.
+  * \param	c			Compositor.
+  * \param	dst			Destination buffer.
+  * \param	gSrc			Source values.
+  * \param	n			Number of source values.
+  */
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const void *gSrc,
+				  int n)
+  {
+    const T	*src = (const T *)gSrc;
+    WlzUByte	buf[COMPOSITOR_CHUNK];
+
+    while(n > 0)
+    {
+      const int	m = (n < COMPOSITOR_CHUNK)? n: COMPOSITOR_CHUNK;
+
+      CompositorNarrow(buf, src, m);
+      CompositorBytes<NCH, MODE, ISA>::run(c, dst, buf, m);
+      dst += m * NCH;
+      src += m;
+      n -= m;
+    }
+  }
+};
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Compositing kernel for byte values.
+*/
+template <int NCH, int MODE, int ISA>
+struct CompositorRun<WlzUByte, NCH, MODE, ISA>
+{
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const void *gSrc,
+				  int n)
+  {
+    CompositorBytes<NCH, MODE, ISA>::run(c, dst, (const WlzUByte *)gSrc, n);
+  }
+};
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Compositing kernel for domains without values, for which
+* 		every value is 255.
+*/
+template <int NCH, int MODE, int ISA>
+struct CompositorRun<void, NCH, MODE, ISA>
+{
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const void *,
+				  int n)
+  {
+    while(n > 0)
+    {
+      const int	m = (n < COMPOSITOR_CHUNK)? n: COMPOSITOR_CHUNK;
+
+      CompositorBytes<NCH, MODE, ISA>::run(c, dst, compositorWhite, m);
+      dst += m * NCH;
+      n -= m;
+    }
+  }
+};
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Compositing kernel for RGBA values. The colour channels
+* 		are blended using the selector alpha and the alpha channel,
+* 		if any, using the product of the selector and source alpha.
+*/
+template <int NCH, int MODE, int ISA>
+struct CompositorRun<WlzUInt, NCH, MODE, ISA>
+{
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const void *gSrc,
+				  int n)
+  {
+    const WlzUInt *src = (const WlzUInt *)gSrc;
+
+    for(int i = 0; i < n; ++i)
+    {
+      const WlzUInt v = src[i];
+      const unsigned int s[4] = {WLZ_RGBA_RED_GET(v),
+				 WLZ_RGBA_GREEN_GET(v),
+				 WLZ_RGBA_BLUE_GET(v),
+				 WLZ_RGBA_ALPHA_GET(v)};
+
+      for(int k = 0; k < NCH; ++k)
+      {
+	if(c->set[k])
+	{
+	  const unsigned int aS = ((s[3] * c->wA) + 128) >> 8,
+			     t = (dst[k] * (255 - aS)) + 128;
+
+	  dst[k] = aS + ((t + (t >> 8)) >> 8);
+	}
+	else
+	{
+	  dst[k] = ((s[k] * c->w[k]) + (dst[k] * c->wD[k]) + c->bias[k]) >> 8;
+	}
+      }
+      dst += NCH;
+    }
+  }
+};
+
+/*!
+* \return	Bin index.
+* \ingroup	WlzIIPServer
+* \brief	Returns the look up table bin of an integral source value.
+* \param	v			Source value.
+* \param	lut			Look up table.
+*/
+template <typename T>
+static inline int		CompositorMapIndex(
+				  T v,
+				  const CompositorLUT *lut)
+{
+  const WlzLong	i = (WlzLong )v - lut->bin1;
+
+  return((i < 0)? 0: (i >= lut->nBin)? lut->nBin - 1: (int )i);
+}
+
+/*!
+* \return	Bin index.
+* \ingroup	WlzIIPServer
+* \brief	Returns the look up table bin of a floating point source
+* 		value, which is rounded to the nearest integer.
+* \param	v			Source value.
+* \param	lut			Look up table.
+*/
+static inline int		CompositorMapIndex(
+				  double v,
+				  const CompositorLUT *lut)
+{
+  const double	i = v - lut->bin1;
+
+  return((!(i >= 0.5))? 0:
+         (i >= lut->nBin - 0.5)? lut->nBin - 1: (int )(i + 0.5));
+}
+
+/*!
+* \return	Bin index.
+* \ingroup	WlzIIPServer
+* \brief	Returns the look up table bin of a float source value.
+* \param	v			Source value.
+* \param	lut			Look up table.
+*/
+static inline int		CompositorMapIndex(
+				  float v,
+				  const CompositorLUT *lut)
+{
+  return(CompositorMapIndex((double )v, lut));
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Kernel which maps source values through a grey look up
+* 		table a chunk at a time and composites the mapped bytes
+* 		using the byte kernel of the compositor.
+*/
+template <typename T>
+struct CompositorMapGrey
+{
+  /*!
+  * \ingroup	WlzIIPServer
+  * \brief	Maps and composites values into the buffer.
+  * \param	c			Compositor.
+  * \param	dst			Destination buffer.
+  * \param	gSrc			Source values.
+  * \param	n			Number of source values.
+  */
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const void *gSrc,
+				  int n)
+  {
+    const T	*src = (const T *)gSrc;
+    const CompositorLUT *lut = c->lut;
+    WlzUByte	buf[COMPOSITOR_CHUNK];
+
+    while(n > 0)
+    {
+      const int	m = (n < COMPOSITOR_CHUNK)? n: COMPOSITOR_CHUNK;
+
+      for(int i = 0; i < m; ++i)
+      {
+	const int v = lut->grey[CompositorMapIndex(src[i], lut)];
+
+	buf[i] = (v < 0)? 0: (v > 255)? 255: v;
+      }
+      (*(c->mapFn))(c, dst, buf, m);
+      dst += m * c->nCh;
+      src += m;
+      n -= m;
+    }
+  }
+};
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Kernel which maps source values through an RGBA look up
+* 		table a chunk at a time and composites the mapped values
+* 		using the RGBA kernel of the compositor.
+*/
+template <typename T>
+struct CompositorMapRGBA
+{
+  static void			run(
+				  const Compositor *c,
+				  WlzUByte *dst,
+				  const void *gSrc,
+				  int n)
+  {
+    const T	*src = (const T *)gSrc;
+    const CompositorLUT *lut = c->lut;
+    WlzUInt	buf[COMPOSITOR_CHUNK];
+
+    while(n > 0)
+    {
+      const int	m = (n < COMPOSITOR_CHUNK)? n: COMPOSITOR_CHUNK;
+
+      for(int i = 0; i < m; ++i)
+      {
+	buf[i] = lut->rgba[CompositorMapIndex(src[i], lut)];
+      }
+      (*(c->mapFn))(c, dst, buf, m);
+      dst += m * c->nCh;
+      src += m;
+      n -= m;
+    }
+  }
+};
+
+#define COMPOSITOR_MODES(T,N,I) \
+  {CompositorRun<T, N, COMPOSITOR_MODE_BLEND, I>::run, \
+   CompositorRun<T, N, COMPOSITOR_MODE_OPAQUE, I>::run, \
+   CompositorRun<T, N, COMPOSITOR_MODE_REPLACE, I>::run}
+
+#define COMPOSITOR_CHANNELS(T,I) \
+  {COMPOSITOR_MODES(T, 1, I), COMPOSITOR_MODES(T, 2, I), \
+   COMPOSITOR_MODES(T, 3, I), COMPOSITOR_MODES(T, 4, I)}
+
+#define COMPOSITOR_SOURCES(I) \
+  {COMPOSITOR_CHANNELS(void, I), COMPOSITOR_CHANNELS(WlzUByte, I), \
+   COMPOSITOR_CHANNELS(short, I), COMPOSITOR_CHANNELS(int, I), \
+   COMPOSITOR_CHANNELS(WlzLong, I), COMPOSITOR_CHANNELS(float, I), \
+   COMPOSITOR_CHANNELS(double, I), COMPOSITOR_CHANNELS(WlzUInt, I)}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Kernels indexed by instruction set, source, number of
+* 		channels - 1 and mode.
+*/
+static const CompositorFn	compositorFn[COMPOSITOR_ISA_COUNT]
+					    [COMPOSITOR_SRC_COUNT][4]
+					    [COMPOSITOR_MODE_COUNT] =
+{
+  COMPOSITOR_SOURCES(COMPOSITOR_ISA_SCALAR),
+#ifdef COMPOSITOR_X86
+  COMPOSITOR_SOURCES(COMPOSITOR_ISA_SSE4),
+  COMPOSITOR_SOURCES(COMPOSITOR_ISA_AVX2)
+#else
+  COMPOSITOR_SOURCES(COMPOSITOR_ISA_SCALAR),
+  COMPOSITOR_SOURCES(COMPOSITOR_ISA_SCALAR)
+#endif
+};
+
+#define COMPOSITOR_MAPS(T) \
+  {CompositorMapGrey<T>::run, CompositorMapRGBA<T>::run}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Look up table kernels indexed by source and grey (0) or
+* 		RGBA (1) table. There are none for domains or RGBA values.
+*/
+static const CompositorFn	compositorMapFn[COMPOSITOR_SRC_COUNT][2] =
+{
+  {NULL, NULL},
+  COMPOSITOR_MAPS(WlzUByte),
+  COMPOSITOR_MAPS(short),
+  COMPOSITOR_MAPS(int),
+  COMPOSITOR_MAPS(WlzLong),
+  COMPOSITOR_MAPS(float),
+  COMPOSITOR_MAPS(double),
+  {NULL, NULL}
+};
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs a compositor using the best kernels for the host.
+* \param	gType			Grey type of the source values or
+* 					WLZ_GREY_ERROR for a domain
+* 					without values.
+* \param	nCh			Number of buffer channels (1-4).
+* \param	nCol			Number of colour channels to set,
+* 					1 for grey or 3 for RGB.
+* \param	alphaOff		Offset of the alpha channel in the
+* 					buffer or zero if there is none.
+* \param	a			Selector alpha (0-255).
+* \param	r			Selector red (0-255).
+* \param	g			Selector green (0-255).
+* \param	b			Selector blue (0-255).
+*/
+Compositor::Compositor(WlzGreyType gType, int nCh, int nCol, int alphaOff,
+		       int a, int r, int g, int b)
+{
+  init(gType, NULL, nCh, nCol, alphaOff, a, r, g, b, compositorISA);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs a compositor using the kernels for the given
+* 		instruction set, or the best supported by the host if
+* 		that is not.
+* \param	gType			Grey type of the source values or
+* 					WLZ_GREY_ERROR for a domain
+* 					without values.
+* \param	nCh			Number of buffer channels (1-4).
+* \param	nCol			Number of colour channels to set,
+* 					1 for grey or 3 for RGB.
+* \param	alphaOff		Offset of the alpha channel in the
+* 					buffer or zero if there is none.
+* \param	a			Selector alpha (0-255).
+* \param	r			Selector red (0-255).
+* \param	g			Selector green (0-255).
+* \param	b			Selector blue (0-255).
+* \param	isa			Instruction set.
+*/
+Compositor::Compositor(WlzGreyType gType, int nCh, int nCol, int alphaOff,
+		       int a, int r, int g, int b, CompositorISA isa)
+{
+  init(gType, NULL, nCh, nCol, alphaOff, a, r, g, b,
+       (isa < compositorISA)? isa: compositorISA);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs a compositor which maps the source values
+* 		through a look up table before compositing them, using
+* 		the best kernels for the host. The channels should be
+* 		given as for grey values if the table has grey values
+* 		and as for RGBA values if it has RGBA values.
+* \param	gType			Grey type of the source values.
+* \param	lut			Look up table which must remain
+* 					valid while the compositor is used.
+* \param	nCh			Number of buffer channels (1-4).
+* \param	nCol			Number of colour channels to set,
+* 					1 for grey or 3 for RGB.
+* \param	alphaOff		Offset of the alpha channel in the
+* 					buffer or zero if there is none.
+* \param	a			Selector alpha (0-255).
+* \param	r			Selector red (0-255).
+* \param	g			Selector green (0-255).
+* \param	b			Selector blue (0-255).
+*/
+Compositor::Compositor(WlzGreyType gType, const CompositorLUT *lut,
+		       int nCh, int nCol, int alphaOff,
+		       int a, int r, int g, int b)
+{
+  init(gType, lut, nCh, nCol, alphaOff, a, r, g, b, compositorISA);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Computes the weights and vector tables for the selector
+* 		and chooses the kernel.
+* \param	gType			Grey type of the source values.
+* \param	lut			Look up table or NULL.
+* \param	nCh			Number of buffer channels (1-4).
+* \param	nCol			Number of colour channels to set.
+* \param	alphaOff		Offset of the alpha channel or zero.
+* \param	a			Selector alpha.
+* \param	r			Selector red.
+* \param	g			Selector green.
+* \param	b			Selector blue.
+* \param	isa			Instruction set.
+*/
+void				Compositor::init(
+				  WlzGreyType gType,
+				  const CompositorLUT *lut,
+				  int nCh,
+				  int nCol,
+				  int alphaOff,
+				  int a,
+				  int r,
+				  int g,
+				  int b,
+				  CompositorISA isa)
+{
+  int		col[3];
+  bool		all = true,
+  		white = true;
+  CompositorSource src;
+
+  a = WLZ_CLAMP(a, 0, 255);
+  col[0] = WLZ_CLAMP(r, 0, 255);
+  col[1] = WLZ_CLAMP(g, 0, 255);
+  col[2] = WLZ_CLAMP(b, 0, 255);
+  this->nCh = WLZ_CLAMP(nCh, 1, 4);
+  this->alphaOff = (alphaOff > 0 && alphaOff < this->nCh)? alphaOff: 0;
+  nCol = WLZ_CLAMP(nCol, 1, 3);
+  // Weights are in 1/256ths, w[k] <= wA and wA + wD = 256 so the sums
+  // of products can not overflow 16 bits.
+  wA = ((a * 256) + 127) / 255;
+  for(int k = 0; k < 4; ++k)
+  {
+    set[k] = 0;
+    if(k >= this->nCh)
+    {
+      w[k] = 0;
+      wD[k] = 256;
+      bias[k] = 128;
+    }
+    else if((this->alphaOff > 0) && (k == this->alphaOff))
+    {
+      set[k] = 0xff;
+      w[k] = 0;
+      wD[k] = 256 - wA;
+      bias[k] = (255 * wA) + 128;
+    }
+    else if(k < nCol)
+    {
+      w[k] = ((a * col[k] * 256) + 32512) / 65025;
+      wD[k] = 256 - wA;
+      bias[k] = 128;
+      white = white && (col[k] == 255);
+    }
+    else
+    {
+      // Channel is left unchanged.
+      w[k] = 0;
+      wD[k] = 256;
+      bias[k] = 128;
+      all = false;
+    }
+  }
+  mode = COMPOSITOR_MODE_BLEND;
+  if(all && (a == 255))
+  {
+    mode = (white)? COMPOSITOR_MODE_REPLACE: COMPOSITOR_MODE_OPAQUE;
+  }
+  // Tables for the vector kernels.
+  for(int k = 0; k < this->nCh; ++k)
+  {
+    for(int j = 0; j < 16; ++j)
+    {
+      const int	byte = (16 * k) + j,
+      		ch = byte % this->nCh;
+
+      shuf16[k][j] = (set[ch])? 0x80:
+                     (byte / this->nCh) - ((16 * k) / this->nCh);
+      w16[k][j] = w[ch];
+      wD16[k][j] = wD[ch];
+      bias16[k][j] = bias[ch];
+    }
+    for(int j = 0; j < 32; ++j)
+    {
+      const int	byte = (32 * k) + j,
+      		ch = byte % this->nCh,
+		q = j % 16,
+		l = ((q < 8)? 0: 16) + ((j / 16) * 8) + (q % 8);
+
+      shuf32[k][j] = (set[ch])? 0x80:
+                     (byte / this->nCh) - ((32 * k) / this->nCh);
+      w32[k][l] = w[ch];
+      wD32[k][l] = wD[ch];
+      bias32[k][l] = bias[ch];
+    }
+  }
+  src = getSource(gType);
+  this->lut = lut;
+  mapFn = NULL;
+  if(src == COMPOSITOR_SRC_COUNT)
+  {
+    fn = NULL;
+  }
+  else if(lut == NULL)
+  {
+    fn = compositorFn[isa][src][this->nCh - 1][mode];
+  }
+  else if((lut->nBin < 1) || ((lut->grey == NULL) == (lut->rgba == NULL)))
+  {
+    fn = NULL;
+  }
+  else
+  {
+    const int	rgba = (lut->rgba != NULL)? 1: 0;
+
+    fn = compositorMapFn[src][rgba];
+    mapFn = compositorFn[isa][(rgba)? COMPOSITOR_SRC_RGBA: COMPOSITOR_SRC_UBYTE]
+			[this->nCh - 1][mode];
+  }
+}
+
+/*!
+* \return	Source type or COMPOSITOR_SRC_COUNT if the grey type is
+* 		not supported.
+* \ingroup	WlzIIPServer
+* \brief	Returns the source type for the given grey type.
+* \param	gType			Grey type, WLZ_GREY_ERROR for a
+* 					domain without values.
+*/
+CompositorSource		Compositor::getSource(WlzGreyType gType)
+{
+  CompositorSource src;
+
+  switch(gType)
+  {
+    case WLZ_GREY_ERROR:
+      src = COMPOSITOR_SRC_DOMAIN;
+      break;
+    case WLZ_GREY_UBYTE:
+      src = COMPOSITOR_SRC_UBYTE;
+      break;
+    case WLZ_GREY_SHORT:
+      src = COMPOSITOR_SRC_SHORT;
+      break;
+    case WLZ_GREY_INT:
+      src = COMPOSITOR_SRC_INT;
+      break;
+    case WLZ_GREY_LONG:
+      src = COMPOSITOR_SRC_LONG;
+      break;
+    case WLZ_GREY_FLOAT:
+      src = COMPOSITOR_SRC_FLOAT;
+      break;
+    case WLZ_GREY_DOUBLE:
+      src = COMPOSITOR_SRC_DOUBLE;
+      break;
+    case WLZ_GREY_RGBA:
+      src = COMPOSITOR_SRC_RGBA;
+      break;
+    default:
+      src = COMPOSITOR_SRC_COUNT;
+      break;
+  }
+  return(src);
+}
+
+/*!
+* \return	Best instruction set supported by the host.
+* \ingroup	WlzIIPServer
+* \brief	Returns the instruction set of the kernels used by default.
+*/
+CompositorISA			Compositor::getISA()
+{
+  return(compositorISA);
+}
+
+/*!
+* \return	Name of the instruction set.
+* \ingroup	WlzIIPServer
+* \brief	Returns the name of the given instruction set.
+* \param	isa			Instruction set.
+*/
+const char			*Compositor::getISAName(CompositorISA isa)
+{
+  const char	*name;
+
+  switch(isa)
+  {
+    case COMPOSITOR_ISA_AVX2:
+      name = "AVX2";
+      break;
+    case COMPOSITOR_ISA_SSE4:
+      name = "SSE4.1";
+      break;
+    default:
+      name = "scalar";
+      break;
+  }
+  return(name);
+}
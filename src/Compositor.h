@@ -0,0 +1,224 @@
+#ifndef _COMPOSITOR_H
+#define _COMPOSITOR_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _Compositor_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         Compositor.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Fixed point compositing of grey value intervals into
+* 		interleaved 8 bit tile buffers.
+* \ingroup	WlzIIPServer
+*/
+
+#include <cstddef>
+#include <Wlz.h>
+
+/*!
+* \def		COMPOSITOR_CHUNK
+* \ingroup	WlzIIPServer
+* \brief	Number of values of a non-byte interval which are clamped
+* 		to bytes at a time before being composited.
+*/
+#define COMPOSITOR_CHUNK	(1024)
+
+/*!
+* \enum		_CompositorMode
+* \ingroup	WlzIIPServer
+* \brief	Compositing modes, from the most general to the most
+* 		specialised. Typedef: CompositorMode.
+*/
+typedef enum _CompositorMode
+{
+  COMPOSITOR_MODE_BLEND = 0,		/*!< Alpha blend over the buffer. */
+  COMPOSITOR_MODE_OPAQUE,		/*!< Opaque, buffer values are not
+  					     read. */
+  COMPOSITOR_MODE_REPLACE,		/*!< Opaque and white, source values
+  					     are just copied. */
+  COMPOSITOR_MODE_COUNT
+} CompositorMode;
+
+/*!
+* \enum		_CompositorISA
+* \ingroup	WlzIIPServer
+* \brief	Instruction sets for which compositing kernels are built.
+* 		Typedef: CompositorISA.
+*/
+typedef enum _CompositorISA
+{
+  COMPOSITOR_ISA_SCALAR = 0,		/*!< Portable C++. */
+  COMPOSITOR_ISA_SSE4,			/*!< SSE4.1 */
+  COMPOSITOR_ISA_AVX2,			/*!< AVX2 */
+  COMPOSITOR_ISA_COUNT
+} CompositorISA;
+
+/*!
+* \enum		_CompositorSource
+* \ingroup	WlzIIPServer
+* \brief	Types of source values for which kernels are built.
+* 		Typedef: CompositorSource.
+*/
+typedef enum _CompositorSource
+{
+  COMPOSITOR_SRC_DOMAIN = 0,		/*!< No values, every pixel of the
+  					     domain has value 255. */
+  COMPOSITOR_SRC_UBYTE,			/*!< WLZ_GREY_UBYTE */
+  COMPOSITOR_SRC_SHORT,			/*!< WLZ_GREY_SHORT */
+  COMPOSITOR_SRC_INT,			/*!< WLZ_GREY_INT */
+  COMPOSITOR_SRC_LONG,			/*!< WLZ_GREY_LONG */
+  COMPOSITOR_SRC_FLOAT,			/*!< WLZ_GREY_FLOAT */
+  COMPOSITOR_SRC_DOUBLE,		/*!< WLZ_GREY_DOUBLE */
+  COMPOSITOR_SRC_RGBA,			/*!< WLZ_GREY_RGBA */
+  COMPOSITOR_SRC_COUNT
+} CompositorSource;
+
+/*!
+* \struct	_CompositorLUT
+* \ingroup	WlzIIPServer
+* \brief	A flat look up table which maps source values to either
+* 		grey values or RGBA values before they are composited.
+* 		Source values are rounded to the nearest integer and
+* 		clamped to the bins of the table. Exactly one of grey
+* 		and rgba is non NULL.
+* 		Typedef: CompositorLUT.
+*/
+typedef struct _CompositorLUT
+{
+  int			bin1;		/*!< Source value of the first bin. */
+  int			nBin;		/*!< Number of bins. */
+  const int		*grey;		/*!< Grey value of each bin, which is
+  					     clamped to [0-255]. */
+  const WlzUInt		*rgba;		/*!< RGBA value of each bin. */
+} CompositorLUT;
+
+class Compositor;
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Kernel which composites n source values into the
+* 		destination buffer.
+*/
+typedef void (*CompositorFn)(const Compositor *, WlzUByte *,
+			     const void *, int);
+
+/*!
+* \brief	Composites the values of an interval into an interleaved
+* 		buffer of 1 to 4 channels using a selector colour and alpha.
+* 		Each output channel is computed in 8 bit fixed point as
+* 		\f$(s w + d w_d + b) >> 8\f$, where \f$s\f$ is the source
+* 		value, \f$d\f$ the buffer value, and \f$w\f$, \f$w_d\f$
+* 		and \f$b\f$ are per channel constants for the selector.
+* 		Kernels are templates on the source grey type, the number
+* 		of channels and the mode (blend, opaque or replace), and
+* 		are built for each instruction set. The kernel is chosen
+* 		once, when the compositor is constructed, using the fastest
+* 		instruction set supported by the host. Values of types
+* 		other than bytes are clamped to [0-255] before compositing.
+* 		A domain without values is composited as if every value
+* 		were 255. If a look up table is given the source values
+* 		are mapped through it, a chunk at a time, and the grey or
+* 		RGBA values of the table are composited.
+* \ingroup	WlzIIPServer
+*/
+class Compositor
+{
+  public:
+    Compositor(WlzGreyType gType, int nCh, int nCol, int alphaOff,
+	       int a, int r, int g, int b, CompositorISA isa);
+    Compositor(WlzGreyType gType, int nCh, int nCol, int alphaOff,
+	       int a, int r, int g, int b);
+    Compositor(WlzGreyType gType, const CompositorLUT *lut,
+	       int nCh, int nCol, int alphaOff,
+	       int a, int r, int g, int b);
+    /*!
+    * \return	True if there is a kernel for the grey type.
+    * \ingroup	WlzIIPServer
+    * \brief	Checks that the grey type (and look up table) given to
+    * 		the constructor is supported.
+    */
+    bool		isValid() const {return(fn != NULL);}
+    /*!
+    * \ingroup	WlzIIPServer
+    * \brief	Composites the values of an interval into the buffer.
+    * \param	dst		Destination buffer, at the first pixel
+    * 				of the interval.
+    * \param	src		Source values of the grey type given to
+    * 				the constructor, ignored for a domain.
+    * \param	n		Number of values.
+    */
+    void		composite(WlzUByte *dst, const void *src,
+    				  int n) const {(*fn)(this, dst, src, n);}
+    CompositorMode	getMode() const {return(mode);}
+    static CompositorSource getSource(WlzGreyType gType);
+    static CompositorISA getISA();
+    static const char	*getISAName(CompositorISA isa);
+
+    int			nCh;		/*!< Number of output channels. */
+    int			alphaOff;	/*!< Offset of the alpha channel,
+    					     zero if none. */
+    CompositorMode	mode;		/*!< Compositing mode. */
+    unsigned short	wA;		/*!< Source alpha weight. */
+    unsigned short	w[4];		/*!< Source weight of each channel. */
+    unsigned short	wD[4];		/*!< Buffer weight of each channel. */
+    unsigned short	bias[4];	/*!< Rounding bias and constant alpha
+    					     of each channel. */
+    unsigned char	set[4];		/*!< 0xff for the alpha channel, or'd
+    					     with the value in replace mode,
+					     otherwise zero. */
+    unsigned char	shuf16[4][16];	/*!< Source byte of each buffer byte
+    					     of the 16 byte vectors of 16
+					     pixels, 0x80 for none. */
+    unsigned short	w16[4][16];	/*!< Source weights for shuf16. */
+    unsigned short	wD16[4][16];	/*!< Buffer weights for shuf16. */
+    unsigned short	bias16[4][16];	/*!< Biases for shuf16. */
+    unsigned char	shuf32[4][32];	/*!< Source byte of each buffer byte
+    					     of the 32 byte vectors of 32
+					     pixels, 0x80 for none. */
+    unsigned short	w32[4][32];	/*!< Source weights for shuf32,
+    					     in unpacked lane order. */
+    unsigned short	wD32[4][32];	/*!< Buffer weights for shuf32. */
+    unsigned short	bias32[4][32];	/*!< Biases for shuf32. */
+    const CompositorLUT	*lut;		/*!< Look up table or NULL. */
+    CompositorFn	mapFn;		/*!< Kernel for the grey or RGBA
+    					     values of the look up table. */
+
+  private:
+    CompositorFn	fn;		/*!< Kernel. */
+    void		init(WlzGreyType gType, const CompositorLUT *lut,
+    			     int nCh, int nCol,
+    			     int alphaOff, int a, int r, int g, int b,
+			     CompositorISA isa);
+};
+
+#endif
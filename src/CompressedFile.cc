@@ -0,0 +1,445 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _CompressedFile_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         CompressedFile.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Reading of compressed files through stdio streams.
+* \ingroup	WlzIIPServer
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+#include "Log.h"
+#include "CompressedFile.h"
+
+using namespace std;
+
+/*!
+* \def		COMPRESSEDFILE_BUF_SZ
+* \ingroup	WlzIIPServer
+* \brief	Size of each of the two decompressed data buffers.
+*/
+#define COMPRESSEDFILE_BUF_SZ	(1 << 20)
+
+/*!
+* \enum		_CompressedFileType
+* \ingroup	WlzIIPServer
+* \brief	Compression formats.
+*/
+typedef enum _CompressedFileType
+{
+  COMPRESSEDFILE_GZIP,			/*!< Gzip (or zlib) streams, which
+  					     may have many members. */
+  COMPRESSEDFILE_ZSTD			/*!< Zstandard frames. */
+} CompressedFileType;
+
+/*!
+* \struct	_CompressedFile
+* \ingroup	WlzIIPServer
+* \brief	State of a compressed file being read. A decompression thread
+* 		fills one buffer while the other is read, so decompression
+* 		runs concurrently with the parsing of the decompressed data.
+*/
+typedef struct _CompressedFile
+{
+  CompressedFileType type;		/*!< Compression format. */
+  gzFile	gz;			/*!< Gzip file. */
+#ifdef HAVE_LIBZSTD
+  FILE		*zFP;			/*!< Zstandard file. */
+  ZSTD_DCtx	*zCtx;			/*!< Zstandard context. */
+  ZSTD_inBuffer	zIn;			/*!< Zstandard input. */
+  char		*zInBuf;		/*!< Zstandard input buffer. */
+#endif
+  bool		threaded;		/*!< True if the decompression
+  					     thread is running. */
+  pthread_t	thread;			/*!< Decompression thread. */
+  pthread_mutex_t mutex;		/*!< Protects the buffer flags. */
+  pthread_cond_t cond;			/*!< Signals a change of the
+  					     buffer flags. */
+  char		*buf[2];		/*!< Decompressed data buffers. */
+  long		len[2];			/*!< Lengths of the data in the
+  					     buffers, 0 at the end of the
+					     data and -1 on error. */
+  bool		full[2];		/*!< True if a buffer has data
+  					     to be read. */
+  int		rd;			/*!< Buffer being read. */
+  long		pos;			/*!< Read position in the buffer
+  					     being read. */
+  bool		stop;			/*!< Set when the file is closed. */
+} CompressedFile;
+
+static long			CompressedFileDecode(
+				  CompressedFile *cf,
+				  char *buf,
+				  size_t size);
+static void			*CompressedFileRun(
+				  void *arg);
+static ssize_t			CompressedFileRead(
+				  void *cookie,
+				  char *buf,
+				  size_t size);
+static int			CompressedFileClose(
+				  void *cookie);
+static void			CompressedFileFree(
+				  CompressedFile *cf);
+
+/*!
+* \return	Stream from which the decompressed data of the file may be
+* 		read or NULL on error.
+* \ingroup	WlzIIPServer
+* \brief	Opens a file for reading. Files with a .gz extension are
+* 		decompressed in process using zlib and, if built with
+* 		zstd, files with a .zst extension using zstd. Other files
+* 		are opened with fopen(). The stream must be closed with
+* 		fclose().
+* \param	name			File name.
+*/
+FILE				*CompressedFileOpen(
+				  const string &name)
+{
+  FILE		*fP = NULL;
+  CompressedFile *cf = NULL;
+  const size_t	len = name.length();
+
+  if((len > 3) && (name.compare(len - 3, 3, ".gz") == 0))
+  {
+    gzFile	gz;
+
+    if((gz = gzopen(name.c_str(), "rb")) != NULL)
+    {
+      (void )gzbuffer(gz, COMPRESSEDFILE_BUF_SZ / 4);
+      cf = (CompressedFile *)calloc(1, sizeof(CompressedFile));
+      if(cf == NULL)
+      {
+        (void )gzclose(gz);
+      }
+      else
+      {
+	cf->type = COMPRESSEDFILE_GZIP;
+	cf->gz = gz;
+      }
+    }
+  }
+#ifdef HAVE_LIBZSTD
+  else if((len > 4) && (name.compare(len - 4, 4, ".zst") == 0))
+  {
+    FILE	*zFP;
+
+    if((zFP = fopen(name.c_str(), "rb")) != NULL)
+    {
+      cf = (CompressedFile *)calloc(1, sizeof(CompressedFile));
+      if((cf == NULL) ||
+         ((cf->zCtx = ZSTD_createDCtx()) == NULL) ||
+	 ((cf->zInBuf = (char *)malloc(ZSTD_DStreamInSize())) == NULL))
+      {
+	if(cf)
+	{
+	  if(cf->zCtx)
+	  {
+	    (void )ZSTD_freeDCtx(cf->zCtx);
+	  }
+	  free(cf);
+	  cf = NULL;
+	}
+        (void )fclose(zFP);
+      }
+      else
+      {
+	cf->type = COMPRESSEDFILE_ZSTD;
+	cf->zFP = zFP;
+	cf->zIn.src = cf->zInBuf;
+	cf->zIn.size = 0;
+	cf->zIn.pos = 0;
+      }
+    }
+  }
+#endif
+  else
+  {
+    return(fopen(name.c_str(), "r"));
+  }
+  if(cf)
+  {
+    cookie_io_functions_t io;
+
+    (void )memset(&io, 0, sizeof(io));
+    io.read = CompressedFileRead;
+    io.close = CompressedFileClose;
+    pthread_mutex_init(&(cf->mutex), NULL);
+    pthread_cond_init(&(cf->cond), NULL);
+    if(((cf->buf[0] = (char *)malloc(COMPRESSEDFILE_BUF_SZ)) != NULL) &&
+       ((cf->buf[1] = (char *)malloc(COMPRESSEDFILE_BUF_SZ)) != NULL))
+    {
+      cf->threaded = (pthread_create(&(cf->thread), NULL,
+                                     CompressedFileRun, cf) == 0);
+      if(!(cf->threaded))
+      {
+        LOG_DEBUG("CompressedFileOpen() decompressing " << name <<
+		  " without a thread.");
+      }
+    }
+    if((cf->buf[0] == NULL) || (cf->buf[1] == NULL) ||
+       ((fP = fopencookie(cf, "r", io)) == NULL))
+    {
+      (void )CompressedFileClose(cf);
+    }
+    else
+    {
+      (void )setvbuf(fP, NULL, _IOFBF, COMPRESSEDFILE_BUF_SZ / 4);
+    }
+  }
+  return(fP);
+}
+
+/*!
+* \return	Number of bytes decompressed, 0 at the end of the data or
+* 		-1 on error.
+* \ingroup	WlzIIPServer
+* \brief	Decompresses data from the file. Concatenated gzip members
+* 		and zstd frames are decompressed in turn.
+* \param	cf			Compressed file.
+* \param	buf			Destination buffer.
+* \param	size			Size of the destination buffer.
+*/
+static long			CompressedFileDecode(
+				  CompressedFile *cf,
+				  char *buf,
+				  size_t size)
+{
+  long		n = -1;
+
+  switch(cf->type)
+  {
+    case COMPRESSEDFILE_GZIP:
+      n = gzread(cf->gz, buf, size);
+      break;
+#ifdef HAVE_LIBZSTD
+    case COMPRESSEDFILE_ZSTD:
+      {
+	ZSTD_outBuffer out;
+
+	out.dst = buf;
+	out.size = size;
+	out.pos = 0;
+	while(out.pos < out.size)
+	{
+	  if(cf->zIn.pos >= cf->zIn.size)
+	  {
+	    cf->zIn.size = fread(cf->zInBuf, 1, ZSTD_DStreamInSize(), cf->zFP);
+	    cf->zIn.pos = 0;
+	    if(cf->zIn.size == 0)
+	    {
+	      break;
+	    }
+	  }
+	  if(ZSTD_isError(ZSTD_decompressStream(cf->zCtx, &out, &(cf->zIn))))
+	  {
+	    return(-1);
+	  }
+	}
+	n = out.pos;
+      }
+      break;
+#endif
+    default:
+      break;
+  }
+  return(n);
+}
+
+/*!
+* \return	NULL.
+* \ingroup	WlzIIPServer
+* \brief	Decompression thread which fills the buffers alternately
+* 		until the end of the data or the file is closed.
+* \param	arg			Compressed file.
+*/
+static void			*CompressedFileRun(
+				  void *arg)
+{
+  int		idx = 0;
+  long		n = 1;
+  CompressedFile *cf = (CompressedFile *)arg;
+
+  while(n > 0)
+  {
+    bool	stop;
+
+    pthread_mutex_lock(&(cf->mutex));
+    while(cf->full[idx] && !(cf->stop))
+    {
+      pthread_cond_wait(&(cf->cond), &(cf->mutex));
+    }
+    stop = cf->stop;
+    pthread_mutex_unlock(&(cf->mutex));
+    if(stop)
+    {
+      break;
+    }
+    n = CompressedFileDecode(cf, cf->buf[idx], COMPRESSEDFILE_BUF_SZ);
+    pthread_mutex_lock(&(cf->mutex));
+    cf->len[idx] = n;
+    cf->full[idx] = true;
+    pthread_cond_broadcast(&(cf->cond));
+    pthread_mutex_unlock(&(cf->mutex));
+    idx = !idx;
+  }
+  return(NULL);
+}
+
+/*!
+* \return	Number of bytes read, 0 at the end of the data or -1 on
+* 		error.
+* \ingroup	WlzIIPServer
+* \brief	Stream read function which copies decompressed data from
+* 		the buffers, waiting for the decompression thread to fill
+* 		them as required.
+* \param	cookie			Compressed file.
+* \param	buf			Destination buffer.
+* \param	size			Number of bytes requested.
+*/
+static ssize_t			CompressedFileRead(
+				  void *cookie,
+				  char *buf,
+				  size_t size)
+{
+  size_t	cnt = 0;
+  CompressedFile *cf = (CompressedFile *)cookie;
+
+  if(!(cf->threaded))
+  {
+    return(CompressedFileDecode(cf, buf, size));
+  }
+  while(cnt < size)
+  {
+    long	len;
+    const int	rd = cf->rd;
+
+    pthread_mutex_lock(&(cf->mutex));
+    while(!(cf->full[rd]))
+    {
+      pthread_cond_wait(&(cf->cond), &(cf->mutex));
+    }
+    len = cf->len[rd];
+    pthread_mutex_unlock(&(cf->mutex));
+    if(len <= 0)
+    {
+      // The buffer is left full to mark the end of the data.
+      if((len < 0) && (cnt == 0))
+      {
+        return(-1);
+      }
+      break;
+    }
+    size_t n = len - cf->pos;
+    if(n > size - cnt)
+    {
+      n = size - cnt;
+    }
+    (void )memcpy(buf + cnt, cf->buf[rd] + cf->pos, n);
+    cnt += n;
+    cf->pos += n;
+    if(cf->pos >= len)
+    {
+      cf->pos = 0;
+      cf->rd = !rd;
+      pthread_mutex_lock(&(cf->mutex));
+      cf->full[rd] = false;
+      pthread_cond_broadcast(&(cf->cond));
+      pthread_mutex_unlock(&(cf->mutex));
+    }
+  }
+  return(cnt);
+}
+
+/*!
+* \return	Zero.
+* \ingroup	WlzIIPServer
+* \brief	Stream close function which stops the decompression thread
+* 		and frees the compressed file.
+* \param	cookie			Compressed file.
+*/
+static int			CompressedFileClose(
+				  void *cookie)
+{
+  CompressedFile *cf = (CompressedFile *)cookie;
+
+  if(cf->threaded)
+  {
+    pthread_mutex_lock(&(cf->mutex));
+    cf->stop = true;
+    pthread_cond_broadcast(&(cf->cond));
+    pthread_mutex_unlock(&(cf->mutex));
+    (void )pthread_join(cf->thread, NULL);
+  }
+  CompressedFileFree(cf);
+  return(0);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Frees a compressed file, closing the underlying file.
+* \param	cf			Compressed file.
+*/
+static void			CompressedFileFree(
+				  CompressedFile *cf)
+{
+  switch(cf->type)
+  {
+    case COMPRESSEDFILE_GZIP:
+      (void )gzclose(cf->gz);
+      break;
+#ifdef HAVE_LIBZSTD
+    case COMPRESSEDFILE_ZSTD:
+      (void )ZSTD_freeDCtx(cf->zCtx);
+      (void )fclose(cf->zFP);
+      free(cf->zInBuf);
+      break;
+#endif
+    default:
+      break;
+  }
+  pthread_cond_destroy(&(cf->cond));
+  pthread_mutex_destroy(&(cf->mutex));
+  free(cf->buf[0]);
+  free(cf->buf[1]);
+  free(cf);
+}
@@ -0,0 +1,50 @@
+#ifndef _COMPRESSEDFILE_H
+#define _COMPRESSEDFILE_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _CompressedFile_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         CompressedFile.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Reading of compressed files through stdio streams.
+* \ingroup	WlzIIPServer
+*/
+
+#include <stdio.h>
+#include <string>
+
+extern FILE			*CompressedFileOpen(
+				  const std::string &name);
+
+#endif
@@ -47,6 +47,8 @@ static char _Environment_h[] = "University of Edinburgh $Id$";
 #define LOGFILE 		"/tmp/iipsrv.log"
 #define LOGLEVEL 		"WARN"
 #define MAX_IMAGE_CACHE_SIZE 	10.0
+#define RESPONSE_CACHE_SIZE 	0.0
+#define CACHE_MAX_AGE 		3600 /* in seconds */
 #define MAX_VIEW_STRUCT_CACHE_COUNT 1024
 #define MAX_VIEW_STRUCT_CACHE_SIZE 1024
 #define MAX_WLZOBJ_CACHE_COUNT 	1024
@@ -54,9 +56,25 @@ static char _Environment_h[] = "University of Edinburgh $Id$";
 #define FILENAME_PATTERN 	"_pyr_"
 #define JPEG_QUALITY 		75
 #define MAX_CVT 		5000
+#define NUM_THREADS 		1
+#define SHM_TILE_CACHE_NAME	"/wlziipsrv"
+#define SHM_TILE_CACHE_SIZE	0
+#define SHM_TILE_CACHE_GENERATION 0
+#define CVT_DIRECT		1
+#define PREFETCH_THREADS	0
+#define PREFETCH_BUDGET		16
+#define WARM_MANIFEST		""
+#define WARM_THREADS		2
+#define WARM_TILES		64
 
 #define WLZ_TILE_HEIGHT		100
 #define WLZ_TILE_WIDTH 		100
+#define WLZ_MAX_RESOLUTIONS	1
+#define WLZ_MAX_PROXY		1
+#define WLZ_SECTION_CACHE	0
+#define WLZ_TILED_DIR		""
+#define WLZ_MAPPED_DIR		""
+#define WLZ_MAPPED_MAKE		0
 
 #include <string>
 #include "Log.h"
@@ -126,6 +144,25 @@ class Environment {
     return max_image_cache_size;
   }
 
+  static float getResponseCacheSize(){
+    float response_cache_size = RESPONSE_CACHE_SIZE;
+    char* envpara = getenv( "RESPONSE_CACHE_SIZE" );
+    if( envpara ){
+      response_cache_size = atof( envpara );
+    }
+    return response_cache_size;
+  }
+
+  static int getCacheMaxAge(){
+    int max_age = CACHE_MAX_AGE;
+    char* envpara = getenv( "CACHE_MAX_AGE" );
+    if( envpara ){
+      max_age = atoi( envpara );
+      if( max_age < 0 ) max_age = 0;
+    }
+    return max_age;
+  }
+
   static int getMaxViewStructCacheCount(){
     int max_viewstruct_cache_count = MAX_VIEW_STRUCT_CACHE_COUNT;
     char* envpara = getenv( "MAX_VIEW_STRUCT_CACHE_COUNT" );
@@ -191,6 +228,57 @@ class Environment {
     return tile_height ;
   }
 
+
+  static int getWlzMaxResolutions(){
+    int max_resolutions = WLZ_MAX_RESOLUTIONS;
+    char* envpara = getenv( "WLZ_MAX_RESOLUTIONS" );
+    if( envpara ){
+      max_resolutions = atoi( envpara );
+      if( max_resolutions < 1 ) max_resolutions = 1;
+    }
+    return max_resolutions;
+  }
+
+  static int getWlzMaxProxy(){
+    int max_proxy = WLZ_MAX_PROXY;
+    char* envpara = getenv( "WLZ_MAX_PROXY" );
+    if( envpara ){
+      max_proxy = atoi( envpara );
+      if( max_proxy < 1 ) max_proxy = 1;
+    }
+    return max_proxy;
+  }
+
+  static bool getWlzSectionCache(){
+    bool section_cache = WLZ_SECTION_CACHE;
+    char* envpara = getenv( "WLZ_SECTION_CACHE" );
+    if( envpara ){
+      section_cache = atoi( envpara ) != 0;
+    }
+    return section_cache;
+  }
+
+  static std::string getWlzTiledDir(){
+    char* envpara = getenv( "WLZ_TILED_DIR" );
+    if( envpara ) return std::string( envpara );
+    else return WLZ_TILED_DIR;
+  }
+
+  static std::string getWlzMappedDir(){
+    char* envpara = getenv( "WLZ_MAPPED_DIR" );
+    if( envpara ) return std::string( envpara );
+    else return WLZ_MAPPED_DIR;
+  }
+
+  static bool getWlzMappedMake(){
+    int mapped_make = WLZ_MAPPED_MAKE;
+    char* envpara = getenv( "WLZ_MAPPED_MAKE" );
+    if( envpara ){
+      mapped_make = atoi( envpara );
+    }
+    return mapped_make != 0;
+  }
+
   static int getJPEGQuality(){
     char* envpara = getenv( "JPEG_QUALITY" );
     int jpeg_quality;
@@ -219,6 +307,102 @@ class Environment {
   }
 
 
+  static int getNumThreads(){
+    int num_threads = NUM_THREADS;
+    char* envpara = getenv( "NUM_THREADS" );
+    if( envpara ){
+      num_threads = atoi( envpara );
+      if( num_threads < 1 ) num_threads = 1;
+    }
+    return num_threads;
+  }
+
+
+  static std::string getShmTileCacheName(){
+    char* envpara = getenv( "SHM_TILE_CACHE_NAME" );
+    if( envpara ) return std::string( envpara );
+    else return SHM_TILE_CACHE_NAME;
+  }
+
+
+  static float getShmTileCacheSize(){
+    float shm_tile_cache_size = SHM_TILE_CACHE_SIZE;
+    char* envpara = getenv( "SHM_TILE_CACHE_SIZE" );
+    if( envpara ){
+      shm_tile_cache_size = atof( envpara );
+    }
+    return shm_tile_cache_size;
+  }
+
+
+  static unsigned long getShmTileCacheGeneration(){
+    unsigned long shm_tile_cache_generation = SHM_TILE_CACHE_GENERATION;
+    char* envpara = getenv( "SHM_TILE_CACHE_GENERATION" );
+    if( envpara ){
+      shm_tile_cache_generation = strtoul( envpara, NULL, 10 );
+    }
+    return shm_tile_cache_generation;
+  }
+
+
+  static bool getCVTDirect(){
+    int cvt_direct = CVT_DIRECT;
+    char* envpara = getenv( "CVT_DIRECT" );
+    if( envpara ){
+      cvt_direct = atoi( envpara );
+    }
+    return cvt_direct != 0;
+  }
+
+
+  static int getPrefetchThreads(){
+    int prefetch_threads = PREFETCH_THREADS;
+    char* envpara = getenv( "PREFETCH_THREADS" );
+    if( envpara ){
+      prefetch_threads = atoi( envpara );
+      if( prefetch_threads < 0 ) prefetch_threads = 0;
+    }
+    return prefetch_threads;
+  }
+
+
+  static int getPrefetchBudget(){
+    int prefetch_budget = PREFETCH_BUDGET;
+    char* envpara = getenv( "PREFETCH_BUDGET" );
+    if( envpara ){
+      prefetch_budget = atoi( envpara );
+      if( prefetch_budget < 0 ) prefetch_budget = 0;
+    }
+    return prefetch_budget;
+  }
+
+  static std::string getWarmManifest(){
+    char* envpara = getenv( "WARM_MANIFEST" );
+    if( envpara ) return std::string( envpara );
+    else return WARM_MANIFEST;
+  }
+
+  static int getWarmThreads(){
+    int warm_threads = WARM_THREADS;
+    char* envpara = getenv( "WARM_THREADS" );
+    if( envpara ){
+      warm_threads = atoi( envpara );
+      if( warm_threads < 0 ) warm_threads = 0;
+    }
+    return warm_threads;
+  }
+
+  static int getWarmTiles(){
+    int warm_tiles = WARM_TILES;
+    char* envpara = getenv( "WARM_TILES" );
+    if( envpara ){
+      warm_tiles = atoi( envpara );
+      if( warm_tiles < 0 ) warm_tiles = 0;
+    }
+    return warm_tiles;
+  }
+
+
 };
 
 #endif
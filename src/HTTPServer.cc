@@ -0,0 +1,779 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _HTTPServer_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         HTTPServer.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Non-blocking HTTP/1.1 front end using epoll.
+* \ingroup	WlzIIPServer
+*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "Log.h"
+#include "HTTPServer.h"
+
+using namespace std;
+
+/*!
+* \def		HTTPSERVER_LISTEN_ID
+* \ingroup	WlzIIPServer
+* \brief	Epoll identifier of the listening socket.
+*/
+#define HTTPSERVER_LISTEN_ID	(0ULL)
+
+/*!
+* \def		HTTPSERVER_WAKE_ID
+* \ingroup	WlzIIPServer
+* \brief	Epoll identifier of the wake event, connection identifiers
+* 		follow it.
+*/
+#define HTTPSERVER_WAKE_ID	(1ULL)
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs a server which is not yet listening.
+*/
+HTTPServer::HTTPServer()
+{
+  listenFd = -1;
+  epollFd = -1;
+  wakeFd = -1;
+  lastConn = HTTPSERVER_WAKE_ID;
+  running = false;
+  stop = false;
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Stops the I/O thread, releases any workers waiting for
+* 		requests and closes all connections.
+*/
+HTTPServer::~HTTPServer()
+{
+  const unsigned long long one = 1;
+
+  pthread_mutex_lock(&mutex);
+  stop = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+  if(running)
+  {
+    (void )::write(wakeFd, &one, sizeof(one));
+    (void )pthread_join(thread, NULL);
+  }
+  while(!conns.empty())
+  {
+    closeConn(conns.begin()->first);
+  }
+  for(list<Request *>::iterator it = queue.begin(); it != queue.end(); ++it)
+  {
+    delete *it;
+  }
+  for(list<Request *>::iterator it = served.begin(); it != served.end(); ++it)
+  {
+    delete *it;
+  }
+  if(listenFd >= 0)
+  {
+    (void )::close(listenFd);
+  }
+  if(wakeFd >= 0)
+  {
+    (void )::close(wakeFd);
+  }
+  if(epollFd >= 0)
+  {
+    (void )::close(epollFd);
+  }
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+/*!
+* \return	True if the server is listening.
+* \ingroup	WlzIIPServer
+* \brief	Listens on the given port and starts the I/O thread.
+* \param	port			Port, optionally preceded by a host
+* 					address and a colon, eg ":8080" or
+* 					"127.0.0.1:8080".
+*/
+bool		HTTPServer::open(const string &port)
+{
+  int		one = 1;
+  struct addrinfo hints,
+  		*addrs = NULL;
+  struct epoll_event ev;
+  const size_t	sep = port.rfind(':');
+  const string	host = (sep == string::npos)? string(): port.substr(0, sep),
+  		service = (sep == string::npos)? port: port.substr(sep + 1);
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  if(service.empty() ||
+     (getaddrinfo((host.empty())? NULL: host.c_str(), service.c_str(),
+                  &hints, &addrs) != 0))
+  {
+    LOG_ERROR("HTTPServer :: Invalid port " << port);
+    return(false);
+  }
+  for(struct addrinfo *a = addrs; (listenFd < 0) && a; a = a->ai_next)
+  {
+    listenFd = socket(a->ai_family,
+                      a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		      a->ai_protocol);
+    if(listenFd >= 0)
+    {
+      (void )setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      if((bind(listenFd, a->ai_addr, a->ai_addrlen) != 0) ||
+         (listen(listenFd, SOMAXCONN) != 0))
+      {
+	(void )::close(listenFd);
+	listenFd = -1;
+      }
+    }
+  }
+  freeaddrinfo(addrs);
+  if(listenFd < 0)
+  {
+    LOG_ERROR("HTTPServer :: Unable to listen on " << port << ": " <<
+              strerror(errno));
+    return(false);
+  }
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if((epollFd < 0) || (wakeFd < 0))
+  {
+    LOG_ERROR("HTTPServer :: Unable to create epoll instance");
+    return(false);
+  }
+  ev.events = EPOLLIN;
+  ev.data.u64 = HTTPSERVER_LISTEN_ID;
+  (void )epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+  ev.data.u64 = HTTPSERVER_WAKE_ID;
+  (void )epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+  if(pthread_create(&thread, NULL, HTTPServer::run, this) != 0)
+  {
+    LOG_ERROR("HTTPServer :: Failed to create I/O thread");
+    return(false);
+  }
+  running = true;
+  return(true);
+}
+
+/*!
+* \return	Request to serve or NULL if the server is stopping.
+* \ingroup	WlzIIPServer
+* \brief	Waits for a request to serve. The request must be handed
+* 		back with done().
+*/
+HTTPServer::Request *HTTPServer::next()
+{
+  Request	*req = NULL;
+
+  pthread_mutex_lock(&mutex);
+  while(!stop && queue.empty())
+  {
+    pthread_cond_wait(&cond, &mutex);
+  }
+  if(!stop)
+  {
+    req = queue.front();
+    queue.pop_front();
+  }
+  pthread_mutex_unlock(&mutex);
+  return(req);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Hands back a served request, with the output of its
+* 		commands, to the I/O thread which responds to it and
+* 		deletes it.
+* \param	req			Request.
+*/
+void		HTTPServer::done(Request *req)
+{
+  const unsigned long long one = 1;
+
+  pthread_mutex_lock(&mutex);
+  served.push_back(req);
+  pthread_mutex_unlock(&mutex);
+  (void )::write(wakeFd, &one, sizeof(one));
+}
+
+/*!
+* \return	NULL.
+* \ingroup	WlzIIPServer
+* \brief	Entry point of the I/O thread.
+* \param	arg			The server.
+*/
+void		*HTTPServer::run(void *arg)
+{
+  ((HTTPServer *)arg)->loop();
+  return(NULL);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Polls the listening socket, the wake event and all the
+* 		connections until the server is stopped. Idle connections
+* 		are closed.
+*/
+void		HTTPServer::loop()
+{
+  time_t	swept = time(NULL);
+  struct epoll_event evs[64];
+
+  for(;;)
+  {
+    pthread_mutex_lock(&mutex);
+    const bool	stopping = stop;
+    pthread_mutex_unlock(&mutex);
+    if(stopping)
+    {
+      break;
+    }
+    const int	n = epoll_wait(epollFd, evs, 64, 1000);
+    if((n < 0) && (errno != EINTR))
+    {
+      LOG_ERROR("HTTPServer :: epoll_wait failed: " << strerror(errno));
+      break;
+    }
+    for(int i = 0; i < n; ++i)
+    {
+      const unsigned long long id = evs[i].data.u64;
+
+      if(id == HTTPSERVER_LISTEN_ID)
+      {
+        acceptConns();
+      }
+      else if(id == HTTPSERVER_WAKE_ID)
+      {
+	unsigned long long cnt;
+	list<Request *> fin;
+
+	(void )::read(wakeFd, &cnt, sizeof(cnt));
+	pthread_mutex_lock(&mutex);
+	fin.swap(served);
+	pthread_mutex_unlock(&mutex);
+	for(list<Request *>::iterator it = fin.begin(); it != fin.end(); ++it)
+	{
+	  // The connection may have been closed while being served.
+	  ConnectionMap::iterator cIt = conns.find((*it)->conn);
+	  if(cIt != conns.end())
+	  {
+	    respond(cIt->second, *it);
+	    progress(cIt->first, cIt->second);
+	  }
+	  delete *it;
+	}
+      }
+      else
+      {
+	ConnectionMap::iterator cIt = conns.find(id);
+	if(cIt == conns.end())
+	{
+	  continue;
+	}
+	Connection *conn = cIt->second;
+	if(((evs[i].events & EPOLLIN) && !readFrom(conn)) ||
+	   (evs[i].events & (EPOLLERR | EPOLLHUP)))
+	{
+	  closeConn(id);
+	}
+	else
+	{
+	  (void )progress(id, conn);
+	}
+      }
+    }
+    const time_t now = time(NULL);
+    if(now != swept)
+    {
+      vector<unsigned long long> idle;
+
+      swept = now;
+      for(ConnectionMap::iterator it = conns.begin(); it != conns.end(); ++it)
+      {
+        if(!it->second->busy &&
+	   (now - it->second->active > HTTPSERVER_IDLE_TIMEOUT))
+	{
+	  idle.push_back(it->first);
+	}
+      }
+      for(size_t i = 0; i < idle.size(); ++i)
+      {
+        closeConn(idle[i]);
+      }
+    }
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Accepts all pending connections.
+*/
+void		HTTPServer::acceptConns()
+{
+  for(;;)
+  {
+    int		fd,
+    		one = 1;
+    char	host[NI_MAXHOST];
+    struct sockaddr_storage addr;
+    socklen_t	len = sizeof(addr);
+    struct epoll_event ev;
+
+    fd = accept4(listenFd, (struct sockaddr *)&addr, &len,
+                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0)
+    {
+      if((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+      {
+        LOG_WARN("HTTPServer :: accept failed: " << strerror(errno));
+      }
+      if(errno != EINTR)
+      {
+	break;
+      }
+      continue;
+    }
+    (void )setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    Connection	*conn = new Connection;
+    conn->fd = fd;
+    if(getnameinfo((struct sockaddr *)&addr, len, host, NI_MAXHOST, NULL, 0,
+                   NI_NUMERICHOST) == 0)
+    {
+      conn->client = host;
+    }
+    conn->busy = false;
+    conn->closing = false;
+    conn->eof = false;
+    conn->events = EPOLLIN;
+    conn->active = time(NULL);
+    const unsigned long long id = ++lastConn;
+    ev.events = conn->events;
+    ev.data.u64 = id;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+      (void )::close(fd);
+      delete conn;
+    }
+    else
+    {
+      conns[id] = conn;
+    }
+  }
+}
+
+/*!
+* \return	False on a read error.
+* \ingroup	WlzIIPServer
+* \brief	Reads all available data from a connection, up to the
+* 		input limit. At the end of the data the connection is
+* 		closed once the complete requests read, which may have been
+* 		pipelined with the client's half close, have been
+* 		responded to.
+* \param	conn			Connection.
+*/
+bool		HTTPServer::readFrom(Connection *conn)
+{
+  char		buf[16384];
+
+  while(conn->input.size() < HTTPSERVER_MAX_INPUT)
+  {
+    const ssize_t n = ::read(conn->fd, buf, sizeof(buf));
+    if(n > 0)
+    {
+      conn->input.append(buf, n);
+      conn->active = time(NULL);
+    }
+    else if(n == 0)
+    {
+      conn->eof = true;
+      break;
+    }
+    else if(errno != EINTR)
+    {
+      return((errno == EAGAIN) || (errno == EWOULDBLOCK));
+    }
+  }
+  return(true);
+}
+
+/*!
+* \return	False on a write error.
+* \ingroup	WlzIIPServer
+* \brief	Writes as much of a connection's output as the socket will
+* 		take, gathering the buffers with writev().
+* \param	conn			Connection.
+*/
+bool		HTTPServer::writeTo(Connection *conn)
+{
+  while(!conn->output.empty())
+  {
+    int		cnt = 0;
+    struct iovec iov[16];
+
+    for(list<Output>::iterator it = conn->output.begin();
+        (it != conn->output.end()) && (cnt < 16); ++it)
+    {
+      iov[cnt].iov_base = (void *)(it->data.data() + it->off);
+      iov[cnt].iov_len = it->data.size() - it->off;
+      ++cnt;
+    }
+    ssize_t	n = writev(conn->fd, iov, cnt);
+    if(n < 0)
+    {
+      if(errno == EINTR)
+      {
+        continue;
+      }
+      return((errno == EAGAIN) || (errno == EWOULDBLOCK));
+    }
+    conn->active = time(NULL);
+    while((n > 0) && !conn->output.empty())
+    {
+      Output	&out = conn->output.front();
+      const size_t rem = out.data.size() - out.off;
+
+      if((size_t )n < rem)
+      {
+        out.off += n;
+	n = 0;
+      }
+      else
+      {
+        n -= rem;
+	conn->output.pop_front();
+      }
+    }
+  }
+  return(true);
+}
+
+/*!
+* \return	False if the connection was closed.
+* \ingroup	WlzIIPServer
+* \brief	Moves a connection on: queues its next pipelined request
+* 		if none is being served, writes its output and closes it
+* 		if it is finished with. After the client's half close it
+* 		is finished with once no complete request is left and all
+* 		the output has been written. Otherwise updates the events
+* 		it is polled for.
+* \param	id			Connection identifier.
+* \param	conn			Connection.
+*/
+bool		HTTPServer::progress(unsigned long long id, Connection *conn)
+{
+  if(!conn->busy && !conn->closing)
+  {
+    parse(id, conn);
+  }
+  if(!writeTo(conn) ||
+     ((conn->closing || conn->eof) && !conn->busy && conn->output.empty()))
+  {
+    closeConn(id);
+    return(false);
+  }
+  const unsigned int events =
+  	((!conn->closing && !conn->eof &&
+	  (conn->input.size() < HTTPSERVER_MAX_INPUT))?
+	 (unsigned int )EPOLLIN: 0u) |
+	((conn->output.empty())? 0u: (unsigned int )EPOLLOUT);
+  if(events != conn->events)
+  {
+    struct epoll_event ev;
+
+    ev.events = conn->events = events;
+    ev.data.u64 = id;
+    (void )epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+  }
+  return(true);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Parses the next complete request of a connection, if any,
+* 		and queues it to be served. Requests which can not be
+* 		served get an error response and the connection is closed.
+* 		Only GET and HEAD requests without a body are served.
+* \param	id			Connection identifier.
+* \param	conn			Connection.
+*/
+void		HTTPServer::parse(unsigned long long id, Connection *conn)
+{
+  const size_t	end = conn->input.find("\r\n\r\n");
+
+  if(end == string::npos)
+  {
+    if(conn->input.size() > HTTPSERVER_MAX_HEADER)
+    {
+      error(conn, "431 Request Header Fields Too Large");
+    }
+    return;
+  }
+  const string	head = conn->input.substr(0, end);
+  conn->input.erase(0, end + 4);
+  size_t	eol = head.find("\r\n");
+  const string	line = head.substr(0, eol);
+  const size_t	s0 = line.find(' '),
+  		s1 = (s0 == string::npos)? s0: line.find(' ', s0 + 1);
+  if(s1 == string::npos)
+  {
+    error(conn, "400 Bad Request");
+    return;
+  }
+  const string	method = line.substr(0, s0),
+  		target = line.substr(s0 + 1, s1 - s0 - 1),
+		version = line.substr(s1 + 1);
+  bool		keepAlive,
+  		body = false;
+  string	ifNoneMatch;
+  if(version == "HTTP/1.1")
+  {
+    keepAlive = true;
+  }
+  else if(version == "HTTP/1.0")
+  {
+    keepAlive = false;
+  }
+  else
+  {
+    error(conn, "505 HTTP Version Not Supported");
+    return;
+  }
+  while(eol != string::npos)
+  {
+    const size_t b = eol + 2;
+    eol = head.find("\r\n", b);
+    const string hdr = head.substr(b, (eol == string::npos)? eol: eol - b);
+    const size_t c = hdr.find(':');
+    if(c == string::npos)
+    {
+      continue;
+    }
+    string	name = hdr.substr(0, c),
+    		value = hdr.substr(c + 1);
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if(name == "if-none-match")
+    {
+      // Entity tags are case sensitive.
+      ifNoneMatch = value;
+      continue;
+    }
+    transform(value.begin(), value.end(), value.begin(), ::tolower);
+    if(name == "connection")
+    {
+      if(value.find("close") != string::npos)
+      {
+        keepAlive = false;
+      }
+      else if(value.find("keep-alive") != string::npos)
+      {
+        keepAlive = true;
+      }
+    }
+    else if(((name == "content-length") && (atoll(value.c_str()) > 0)) ||
+            (name == "transfer-encoding"))
+    {
+      body = true;
+    }
+  }
+  if((method != "GET") && (method != "HEAD"))
+  {
+    error(conn, "501 Not Implemented");
+    return;
+  }
+  if(body)
+  {
+    error(conn, "413 Payload Too Large");
+    return;
+  }
+  const size_t	q = target.find('?'),
+  		f = target.find('#');
+  Request	*req = new Request;
+  req->conn = id;
+  req->query = (q == string::npos)? string():
+               target.substr(q + 1, (f == string::npos)? f: f - q - 1);
+  req->client = conn->client;
+  req->ifNoneMatch = ifNoneMatch;
+  req->head = method == "HEAD";
+  req->close = !keepAlive;
+  conn->busy = true;
+  pthread_mutex_lock(&mutex);
+  queue.push_back(req);
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Queues the response to a served request on its connection.
+* 		The commands' output is CGI style: headers, which may
+* 		include a Status header, a blank line and the body. The
+* 		body is written from the output buffer without copying.
+* 		Responses with a 204 or 304 status have no body.
+* \param	conn			Connection.
+* \param	req			Served request.
+*/
+void		HTTPServer::respond(Connection *conn, Request *req)
+{
+  char		buf[64];
+  size_t	end = req->output.find("\r\n\r\n"),
+  		off = end + 4;
+  string	status = "200 OK",
+  		hdrs;
+  Output	head;
+
+  if(end == string::npos)
+  {
+    end = off = 0;
+    hdrs = "Content-Type: text/plain\r\n";
+  }
+  for(size_t b = 0; b < end; )
+  {
+    size_t	eol = req->output.find("\r\n", b);
+
+    if((eol == string::npos) || (eol > end))
+    {
+      eol = end;
+    }
+    const string hdr = req->output.substr(b, eol - b);
+    const size_t c = hdr.find(':');
+    string	name = hdr.substr(0, c);
+
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    if(name == "status")
+    {
+      const size_t v = hdr.find_first_not_of(' ', c + 1);
+      status = (v == string::npos)? status: hdr.substr(v);
+    }
+    else if((c != string::npos) && (name != "content-length") &&
+            (name != "connection"))
+    {
+      hdrs += hdr + "\r\n";
+    }
+    b = eol + 2;
+  }
+  if((status.compare(0, 3, "204") == 0) || (status.compare(0, 3, "304") == 0))
+  {
+    off = req->output.size();
+    buf[0] = '\0';
+  }
+  else
+  {
+    snprintf(buf, 64, "Content-Length: %lu\r\n",
+	     (unsigned long )(req->output.size() - off));
+  }
+  head.data = "HTTP/1.1 " + status + "\r\n" + hdrs + buf +
+              ((req->close)? "Connection: close\r\n\r\n":
+	                     "Connection: keep-alive\r\n\r\n");
+  head.off = 0;
+  conn->output.push_back(head);
+  if(!req->head && (off < req->output.size()))
+  {
+    Output	body;
+
+    conn->output.push_back(body);
+    conn->output.back().data.swap(req->output);
+    conn->output.back().off = off;
+  }
+  conn->busy = false;
+  conn->closing = conn->closing || req->close;
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Queues an error response on a connection, which is then
+* 		closed.
+* \param	conn			Connection.
+* \param	status			Status code and reason.
+*/
+void		HTTPServer::error(Connection *conn, const char *status)
+{
+  char		buf[256];
+  Output	out;
+
+  snprintf(buf, 256, "HTTP/1.1 %s\r\n"
+           "Content-Type: text/plain\r\n"
+	   "Content-Length: %d\r\n"
+	   "Connection: close\r\n\r\n%s\n",
+	   status, (int )strlen(status) + 1, status);
+  out.data = buf;
+  out.off = 0;
+  conn->output.push_back(out);
+  conn->input.clear();
+  conn->closing = true;
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Closes a connection. Any request of the connection being
+* 		served is dropped when it is handed back.
+* \param	id			Connection identifier.
+*/
+void		HTTPServer::closeConn(unsigned long long id)
+{
+  ConnectionMap::iterator it = conns.find(id);
+
+  if(it != conns.end())
+  {
+    (void )epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second->fd, NULL);
+    (void )::close(it->second->fd);
+    delete it->second;
+    conns.erase(it);
+  }
+}
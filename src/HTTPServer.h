@@ -0,0 +1,176 @@
+#ifndef _HTTPSERVER_H
+#define _HTTPSERVER_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _HTTPServer_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         HTTPServer.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Non-blocking HTTP/1.1 front end using epoll.
+* \ingroup	WlzIIPServer
+*/
+
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <string>
+
+/*!
+* \def		HTTPSERVER_MAX_HEADER
+* \ingroup	WlzIIPServer
+* \brief	Maximum size of a request's line and headers.
+*/
+#define HTTPSERVER_MAX_HEADER	(16384)
+
+/*!
+* \def		HTTPSERVER_MAX_INPUT
+* \ingroup	WlzIIPServer
+* \brief	Maximum size of the pipelined requests buffered for a
+* 		connection, beyond which it is not read until the
+* 		requests have been served.
+*/
+#define HTTPSERVER_MAX_INPUT	(65536)
+
+/*!
+* \def		HTTPSERVER_IDLE_TIMEOUT
+* \ingroup	WlzIIPServer
+* \brief	Time in seconds after which idle connections are closed.
+*/
+#define HTTPSERVER_IDLE_TIMEOUT	(30)
+
+/*!
+* \brief	A native HTTP/1.1 server through which viewers may talk to
+* 		the server directly, or through a plain reverse proxy,
+* 		rather than through FCGI. A single thread accepts, reads
+* 		and writes all connections using epoll, with keep-alive
+* 		and pipelining. The query string of each request is served
+* 		by a request worker, which takes it with next() and hands
+* 		back the (CGI style) output of the commands with done().
+* 		A connection's pipelined requests are served in turn so
+* 		that the responses are in order. Responses are written
+* 		using writev() directly from the header and the buffer
+* 		into which the commands wrote.
+* \ingroup	WlzIIPServer
+*/
+class HTTPServer
+{
+  public:
+    /*!
+    * \brief	A request to be served by a worker.
+    * \ingroup	WlzIIPServer
+    */
+    struct Request
+    {
+      unsigned long long conn;			/*!< Connection identifier. */
+      std::string	query;			/*!< Query string. */
+      std::string	client;			/*!< Client address. */
+      std::string	ifNoneMatch;		/*!< If-None-Match header,
+      						     may be empty. */
+      bool		head;			/*!< HEAD request. */
+      bool		close;			/*!< Close the connection
+      						     after the response. */
+      std::string	output;			/*!< Output of the commands,
+      						     set by the worker. */
+    };
+
+  private:
+    /*!
+    * \brief	A buffer being written to a connection.
+    * \ingroup	WlzIIPServer
+    */
+    struct Output
+    {
+      std::string	data;			/*!< Data. */
+      size_t		off;			/*!< Offset of the data not
+      						     yet written. */
+    };
+    /*!
+    * \brief	State of a connection.
+    * \ingroup	WlzIIPServer
+    */
+    struct Connection
+    {
+      int		fd;			/*!< Socket. */
+      std::string	client;			/*!< Client address. */
+      std::string	input;			/*!< Data read but not yet
+      						     parsed. */
+      std::list<Output>	output;			/*!< Data to be written. */
+      bool		busy;			/*!< A request is being
+      						     served. */
+      bool		closing;		/*!< Close once the output
+      						     has been written. */
+      bool		eof;			/*!< The client has sent all
+      						     its data, close once its
+						     complete requests have
+						     been responded to. */
+      unsigned int	events;			/*!< Events polled for. */
+      time_t		active;			/*!< Time of last activity. */
+    };
+    typedef std::map<unsigned long long, Connection *> ConnectionMap;
+
+    int			listenFd;		/*!< Listening socket. */
+    int			epollFd;		/*!< Epoll instance. */
+    int			wakeFd;			/*!< Event to wake the I/O
+    						     thread. */
+    unsigned long long	lastConn;		/*!< Last connection
+    						     identifier. */
+    pthread_t		thread;			/*!< I/O thread. */
+    bool		running;		/*!< I/O thread started. */
+    pthread_mutex_t	mutex;			/*!< Protects the following. */
+    pthread_cond_t	cond;			/*!< Signals queued requests. */
+    bool		stop;			/*!< Set to stop. */
+    std::list<Request *> queue;			/*!< Requests to be served. */
+    std::list<Request *> served;		/*!< Requests served. */
+    ConnectionMap	conns;			/*!< Open connections, only
+    						     used by the I/O thread. */
+    static void		*run(void *arg);
+    void		loop();
+    void		acceptConns();
+    bool		readFrom(Connection *conn);
+    bool		writeTo(Connection *conn);
+    bool		progress(unsigned long long id, Connection *conn);
+    void		parse(unsigned long long id, Connection *conn);
+    void		respond(Connection *conn, Request *req);
+    void		error(Connection *conn, const char *status);
+    void		closeConn(unsigned long long id);
+
+  public:
+    HTTPServer();
+    ~HTTPServer();
+    bool		open(const std::string &port);
+    Request		*next();
+    void		done(Request *req);
+};
+
+#endif
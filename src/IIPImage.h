@@ -225,6 +225,31 @@ class IIPImage {
   virtual RawTile getTile( int h, int v, unsigned int r, unsigned int t ) { return RawTile(); };
 
 
+  /// Return whether a tile is known to contain only the background
+  /** Empty tiles of the same size and background are identical, so they need
+      not be rendered or cached. Overloaded by child class.
+      \param h horizontal angle
+      \param v vertical angle
+      \param r resolution
+      \param t tile number
+      \param empty set to the size and channels of an empty tile, without data
+      \param background set to the background of each channel of an empty tile
+   */
+  virtual bool isEmptyTile( int, int, unsigned int, unsigned int, RawTile&, unsigned char* ) { return false; };
+
+
+  /// Return a tile of the image's values in their own type, without conversion to RGB
+  /** Only images with grey values support this: Overloaded by child class.
+      \param h horizontal angle
+      \param v vertical angle
+      \param r resolution
+      \param t tile number
+   */
+  virtual RawTile getValueTile( int, int, unsigned int, unsigned int ) {
+    throw std::string( "grey value tiles are not supported for this image" );
+  };
+
+
   /// Assignment operator
   const IIPImage& operator = ( const IIPImage& );
 
@@ -239,7 +264,7 @@ class IIPImage {
 
   /// Forces channel no update to alpha value 
   /// add by Zsolt Husz 12/05/2009
-  virtual void recomputeChannel(bool alpha) { };
+  virtual void recomputeChannel(bool) { };
 };
 
 #endif
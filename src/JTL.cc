@@ -63,6 +63,16 @@ void JTL::run( Session* session, std::string argument ){
   delimitter = argument.find( "," );
   tile = atoi( argument.substr( delimitter + 1, argument.length() ).c_str() );
 
+  // Answer revalidation before rendering anything
+  char params[128];
+  snprintf( params, 128, "JTL,%d,%d,%d,%d,%d", resolution, tile,
+	    session->view->xangle, session->view->yangle,
+	    session->jpeg->getQuality() );
+  string etag = makeETag( session, params );
+  if( sendNotModified( session, etag ) ){
+    LOG_INFO("JTL :: Total command time " << command_timer.getTime() << "us");
+    return;
+  }
 
   TileManager tilemanager( session->tileCache, *session->image, session->jpeg, session->png);
   RawTile rawtile = tilemanager.getTile( resolution, tile, session->view->xangle,
@@ -78,11 +88,11 @@ void JTL::run( Session* session, std::string argument ){
 
 #ifndef DEBUG
   char buf[1024];
-  snprintf(buf, 1024, "Pragma: no-cache\r\n"
+  snprintf(buf, 1024, "%s"
 	   "Content-length: %d\r\n"
 	   "Content-type: image/jpeg\r\n"
 	   "Content-disposition: inline;filename=\"jtl.jpg\""
-	   "\r\n\r\n", len);
+	   "\r\n\r\n", cacheHeaders( etag ).c_str(), len);
 
   session->out->printf((const char*) buf);
 #endif
@@ -101,6 +111,17 @@ void JTL::run( Session* session, std::string argument ){
   // Inform our response object that we have sent something to the client
   session->response->setImageSent();
 
+  // Queue the tiles the viewer is likely to want next
+  WlzImage *wlzImage = dynamic_cast<WlzImage *>(*session->image);
+  if(session->prefetcher && wlzImage)
+  {
+    session->prefetcher->prefetch(session->client, wlzImage,
+                                  session->viewParams, resolution, tile,
+				  session->view->xangle,
+				  session->view->yangle, JPEG,
+				  session->jpeg->getQuality());
+  }
+
   // Total JTLS response time
   LOG_INFO("JTL :: Total command time " << command_timer.getTime() << "us");
 }
@@ -0,0 +1,201 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _JTLB_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         JTLB.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+* 
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	IIP JTLB and PTLB batch tile command handler.
+* \ingroup    	WlzIIPServer
+*/
+
+
+#include "Log.h"
+#include "Task.h"
+#include "Tokenizer.h"
+#include "JPEGCompressor.h"
+#include "PNGCompressor.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define JTLB_MAX_TILES	1024
+#define JTLB_BOUNDARY	"WlzIIPServer-JTLB-boundary"
+
+using namespace std;
+
+
+/**
+ * Sends the requested tiles of a resolution as the parts of a
+ * multipart/mixed response. Each part has an X-Tile header giving its
+ * resolution and tile number, in the order requested. A tile which can not
+ * be rendered is sent as a text/plain part holding the error.
+ * @param session 
+ * @param argument 
+ */
+void JTLB::run( Session* session, std::string argument ){
+  /* The argument should consist of comma separated values:
+     1) resolution
+     2) ... tile numbers or inclusive ranges of tile numbers, eg 3,0-4,8
+  */
+  const char* name = (type == PNG)? "PTLB": "JTLB";
+  LOG_INFO(name << " handler reached");
+  this->session = session;
+  this->argument = argument;
+  checkImage();
+  LOG_COND_INFO(command_timer.start());
+
+  // Parse the argument list
+  Tokenizer izer( argument, "," );
+  if( !izer.hasMoreTokens() ){
+    throw string( "JTLB :: No resolution given" );
+  }
+  int resolution = atoi( izer.nextToken().c_str() );
+  vector<int> tiles;
+  while( izer.hasMoreTokens() && (tiles.size() < JTLB_MAX_TILES) ){
+    string token = izer.nextToken();
+    int first = atoi( token.c_str() ), last = first;
+    size_t dash = token.find( '-', 1 );
+    if( dash != string::npos ) last = atoi( token.substr( dash + 1 ).c_str() );
+    for( int t = first; (t <= last) && (tiles.size() < JTLB_MAX_TILES); t++ ){
+      tiles.push_back( t );
+    }
+  }
+  if( tiles.empty() ){
+    throw string( "JTLB :: No tiles requested" );
+  }
+  LOG_INFO(name << " :: " << tiles.size() << " tiles at resolution " <<
+	   resolution);
+
+  if( type == PNG ) session->viewParams->setAlpha( true );
+
+  // Answer revalidation before rendering anything
+  char params[128];
+  snprintf( params, 128, "%s,%d,%d,%d,%d,", name, resolution,
+	    session->view->xangle, session->view->yangle,
+	    session->jpeg->getQuality() );
+  string etag = makeETag( session, params + argument );
+  if( sendNotModified( session, etag ) ){
+    LOG_INFO(name << " :: Total command time " << command_timer.getTime() << "us");
+    return;
+  }
+
+  // Make sure the image information and hash are up to date before
+  // any tiles are rendered concurrently
+  (*session->image)->loadImageInfo( session->view->xangle, session->view->yangle );
+  (void) (*session->image)->getHash();
+
+#ifndef DEBUG
+  session->out->putS( ( cacheHeaders( etag ) +
+			"Content-type: multipart/mixed; boundary="
+			JTLB_BOUNDARY "\r\n\r\n" ).c_str() );
+#endif
+
+  // Tiles are rendered by a team of threads, each with its own compressors,
+  // but sent in the order requested as soon as each is ready
+  const int ntiles = tiles.size();
+  const int quality = session->jpeg->getQuality();
+#ifdef _OPENMP
+#pragma omp parallel for ordered schedule(dynamic)
+#endif
+  for( int k = 0; k < ntiles; k++ ){
+    RawTile* rawtile = NULL;
+    string error;
+    try{
+      JPEGCompressor jpeg( quality );
+      PNGCompressor png;
+      TileManager tilemanager( session->tileCache, *session->image, &jpeg, &png );
+      rawtile = new RawTile( tilemanager.getTile( resolution, tiles[k],
+						  session->view->xangle,
+						  session->view->yangle,
+						  type ) );
+    }
+    catch( const string& e ){
+      error = e;
+    }
+    catch( ... ){
+      error = "tile rendering failed";
+    }
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+    this->sendPart( resolution, tiles[k], rawtile, error );
+    delete rawtile;
+  }
+
+  session->out->putS( "--" JTLB_BOUNDARY "--\r\n" );
+  if( session->out->flush() == -1 ) {
+    LOG_ERROR(name << " :: Error flushing tiles");
+  }
+
+  // Inform our response object that we have sent something to the client
+  session->response->setImageSent();
+
+  LOG_INFO(name << " :: Total command time " << command_timer.getTime() << "us");
+}
+
+
+
+/**
+ * Sends a tile as a part of the multipart response.
+ * @param resolution resolution number
+ * @param tile tile number
+ * @param rawtile compressed tile, NULL if it could not be rendered
+ * @param error reason the tile could not be rendered
+ */
+void JTLB::sendPart( int resolution, int tile, const RawTile* rawtile,
+		     const std::string& error ){
+  char buf[256];
+  const char* data = error.c_str();
+  int len = error.length();
+  const char* mime = "text/plain";
+
+  if( rawtile ){
+    data = (const char*) rawtile->data;
+    len = rawtile->dataLength;
+    mime = (type == PNG)? "image/png": "image/jpeg";
+  }
+  else{
+    LOG_WARN("JTLB :: Tile " << tile << " failed: " << error);
+  }
+  snprintf( buf, 256, "--" JTLB_BOUNDARY "\r\n"
+	    "Content-type: %s\r\n"
+	    "Content-length: %d\r\n"
+	    "X-Tile: %d,%d\r\n"
+	    "\r\n", mime, len, resolution, tile );
+  session->out->putS( buf );
+  if( session->out->putStr( data, len ) != len ){
+    LOG_ERROR("JTLB :: Error writing tile " << tile);
+  }
+  session->out->putS( "\r\n" );
+}
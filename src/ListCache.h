@@ -0,0 +1,298 @@
+#ifndef _LISTCACHE_H
+#define _LISTCACHE_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _ListCache_h[] = "University of Edinburgh $Id$";
+#endif
+
+// Tile Cache Class, as it was before the cache was sharded (see Cache.h)
+// and kept only as the baseline for WlzCacheBench
+
+/*  IIP Image Server
+
+    Copyright (C) 2005-2006 Ruven Pillay.
+    Based on an LRU cache by Patrick Audley <http://blackcat.ca/lifeline/query.php/tag=LRU_CACHE>
+    Copyright (C) 2004 by Patrick Audley
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+
+// Use the hashmap extensions if we are using >= gcc 3.1
+#ifdef __GNUC__
+
+#if (__GNUC__ == 3 && __GNUC_MINOR__ >= 1) || (__GNUC__ >= 4)
+#define USE_HASHMAP 1
+#include <ext/hash_map>
+#endif
+
+// And the high performance memory pool allocator if >= gcc 3.4
+#if (__GNUC__ == 3 && __GNUC_MINOR__ >= 4) || (__GNUC__ >= 4)
+#define POOL_ALLOCATOR 1
+#include <ext/pool_allocator.h>
+#endif
+
+#endif
+
+
+#ifndef USE_HASHMAP
+#include <map>
+#endif
+
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <string>
+#include <pthread.h>
+#include "RawTile.h"
+#include "Cache.h"
+
+
+
+/// Cache to store raw tile data
+/** All public methods are serialised by a mutex so that a single cache
+ *  may be shared by all of the request worker threads. Tiles are kept in
+ *  a single list in LRU order indexed by a hash_map keyed by a string.
+ */
+
+class ListCache {
+
+
+ private:
+
+  /// Max memory size in bytes
+  unsigned long maxSize;
+
+  /// Basic object storage size
+  int tileSize;
+
+  /// Current memory running total
+  unsigned long currentSize;
+
+  /// Mutex protecting the list, index and size counters
+  pthread_mutex_t mutex;
+
+  /// Main cache storage typedef
+#ifdef POOL_ALLOCATOR
+  typedef std::list < std::pair<const std::string,RawTile>,
+    __gnu_cxx::__pool_alloc< std::pair<const std::string,RawTile> > > TileList;
+#else
+  typedef std::list < std::pair<const std::string,RawTile> > TileList;
+#endif
+
+  /// Main cache list iterator typedef
+  typedef std::list < std::pair<const std::string,RawTile> >::iterator List_Iter;
+
+  /// Index typedef
+#ifdef USE_HASHMAP
+#ifdef POOL_ALLOCATOR
+  typedef __gnu_cxx::hash_map < const std::string, List_Iter,
+    __gnu_cxx::hash< const std::string >,
+    std::equal_to< const std::string >,
+    __gnu_cxx::__pool_alloc< std::pair<const std::string, List_Iter> >
+    > TileMap;
+#else
+  typedef __gnu_cxx::hash_map < const std::string,List_Iter > TileMap;
+#endif
+#else
+  typedef std::map < const std::string,List_Iter > TileMap;
+#endif
+
+  /// Main cache storage object
+  TileList tileList;
+
+  /// Main Cache storage index object
+  TileMap tileMap;
+
+
+  /// Internal touch function
+  /** Touches a key in the Cache and makes it the most recently used
+   *  @param key to be touched
+   *  @return a Map_Iter pointing to the key that was touched.
+   */
+  TileMap::iterator _touch( const std::string &key ) {
+    TileMap::iterator miter = tileMap.find( key );
+    if( miter == tileMap.end() ) return miter;
+    // Move the found node to the head of the list.
+    tileList.splice( tileList.begin(), tileList, miter->second );
+    return miter;
+  }
+
+
+  /// Interal remove function
+  /**
+   *  @param miter Map_Iter that points to the key to remove
+   *  @warning miter is now longer usable after being passed to this function.
+   */
+  void _remove( const TileMap::iterator &miter ) {
+    // Reduce our current size counter
+    currentSize -= ( (miter->second->second).dataLength + (miter->second->second).filename.length()*sizeof(char) + tileSize );
+    tileList.erase( miter->second );
+    tileMap.erase( miter );
+  }
+
+
+  /// Interal remove function
+  /** @param key to remove */
+  void _remove( const std::string &key ) {
+    TileMap::iterator miter = tileMap.find( key );
+    this->_remove( miter );
+  }
+
+
+
+ public:
+
+  /// Constructor
+  /** @param max Maximum cache size in MB */
+  ListCache( float max ) {
+    maxSize = (unsigned long)(max*1024000) ; currentSize = 0;
+    pthread_mutex_init( &mutex, NULL );
+    // 128 added at the end represents 2*average strings lengths
+    tileSize = sizeof( RawTile ) + sizeof( std::pair<const std::string,RawTile> ) +
+      sizeof( std::pair<const std::string, List_Iter> ) + 128;
+  };
+
+
+  /// Destructor
+  ~ListCache() {
+    tileList.clear();
+    tileMap.clear();
+    pthread_mutex_destroy( &mutex );
+  }
+
+
+  /// Insert a tile
+  /** @param r Tile to be inserted */
+  void insert( const RawTile& r ) {
+
+    if( maxSize == 0 ) return;
+
+    std::string key = this->getIndex( r.filename, r.resolution, r.tileNum,
+				      r.hSequence, r.vSequence, r.compressionType, r.quality );
+
+    pthread_mutex_lock( &mutex );
+
+    // Touch the key, if it exists
+    TileMap::iterator miter = this->_touch( key );
+
+    // If this index already exists, do nothing
+    if( miter != tileMap.end() ){
+      pthread_mutex_unlock( &mutex );
+      return;
+    }
+
+    // Store the key if it doesn't already exist in our cache
+    // Ok, do the actual insert at the head of the list
+    tileList.push_front( std::make_pair(key,r) );
+
+    // And store this in our map
+    List_Iter liter = tileList.begin();
+    tileMap[ key ] = liter;
+
+    // Update our total current size variable
+    currentSize += (r.dataLength + r.filename.length()*sizeof(char) + tileSize);
+
+    // Check to see if we need to remove an element due to exceeding max_size
+    while( currentSize > maxSize ) {
+      // Remove the last element.
+      liter = tileList.end();
+      --liter;
+      this->_remove( liter->first );
+    }
+
+    pthread_mutex_unlock( &mutex );
+  }
+
+
+  /// Return the number of tiles in the cache
+  unsigned int getNumElements() {
+    pthread_mutex_lock( &mutex );
+    unsigned int n = tileList.size();
+    pthread_mutex_unlock( &mutex );
+    return n;
+  }
+
+
+  /// Return the number of MB stored
+  float getMemorySize() {
+    pthread_mutex_lock( &mutex );
+    float sz = (float) ( currentSize / 1024000.0 );
+    pthread_mutex_unlock( &mutex );
+    return sz;
+  }
+
+
+  /// Get a tile from the cache
+  /** The cached tile is copied into the given tile while the cache is
+   *  locked, so the copy remains valid even if another thread evicts
+   *  the cached tile.
+   *  @param f filename
+   *  @param r resolution number
+   *  @param t tile number
+   *  @param h horizontal sequence number
+   *  @param v vertical sequence number
+   *  @param c compression type
+   *  @param q compression quality
+   *  @param dst default constructed tile into which the cached tile is
+   *         copied
+   *  @return dst or NULL if the tile is not in the cache
+   */
+  RawTile* getTile( std::string f, int r, int t, int h, int v, CompressionType c, int q,
+		    RawTile* dst ) {
+
+    if( maxSize == 0 ) return NULL;
+
+    std::string key = this->getIndex( f, r, t, h, v, c, q );
+
+    pthread_mutex_lock( &mutex );
+    TileMap::iterator miter = this->_touch( key );
+    if( miter == tileMap.end() ){
+      pthread_mutex_unlock( &mutex );
+      return NULL;
+    }
+    *dst = miter->second->second;
+    pthread_mutex_unlock( &mutex );
+
+    return dst;
+  }
+
+
+  /// Create a hash index
+  /** 
+   *  @param f filename
+   *  @param r resolution number
+   *  @param t tile number
+   *  @param h horizontal sequence number
+   *  @param v vertical sequence number
+   *  @param c compression type
+   *  @param q compression quality
+   *  @return string
+   */
+  std::string getIndex( std::string f, int r, int t, int h, int v, CompressionType c, int q ) {
+    char tmp[100];
+    snprintf( tmp, 100, ":%d:%d:%d:%d:%d:%d", r, t, h, v, c, q );
+    return f+std::string( tmp );
+  }
+
+
+
+};
+
+
+
+#endif
@@ -54,6 +54,7 @@ static char _Main_cc[] = "University of Edinburgh $Id$";
 #include <utility>
 #include <map>
 #include <sys/time.h>
+#include <pthread.h>
 
 
 #include <fcgiapp.h>
@@ -69,6 +70,10 @@ static char _Main_cc[] = "University of Edinburgh $Id$";
 #include "Timer.h"
 #include "TileManager.h"
 #include "Task.h"
+#include "TilePrefetcher.h"
+#include "CacheWarmer.h"
+#include "HTTPServer.h"
+#include "ResponseCache.h"
 #include "Environment.h"
 #include "Writer.h"
 #include "WlzImage.h"
@@ -82,7 +87,48 @@ static char _Main_cc[] = "University of Edinburgh $Id$";
 
 using namespace std;
 
+#ifdef DEBUG
+typedef FileWriter	IIPWriter;
+#else
+typedef FCGIWriter	IIPWriter;
+#endif
+
+/*!
+* \struct	_IIPWorker
+* \ingroup	WlzIIPServer
+* \brief	Per thread state of a request worker. Each worker accepts
+* 		and serves requests using its own FCGI request, compressors,
+* 		view and view parameters, while the tile cache (and the
+* 		static Woolz object cache) are shared by all workers.
+*		Typedef: IIPWorker.
+*/
+typedef struct _IIPWorker
+{
+  int			id;		/*!< Worker index. */
+  pthread_t		thread;		/*!< Worker thread. */
+#ifndef DEBUG
+  FCGX_Request		request;	/*!< FCGI request of this worker. */
+#endif
+  Cache			*tileCache;	/*!< Shared tile cache. */
+  TilePrefetcher	*prefetcher;	/*!< Shared tile prefetcher, may be
+  					     NULL. */
+  HTTPServer		*httpServer;	/*!< HTTP server from which requests
+  					     are taken, NULL in FCGI mode. */
+  ResponseCache		*responseCache;	/*!< Shared response cache, may be
+  					     NULL. */
+  imageCacheMapType	imageCache;	/*!< Per worker IIPImage cache. */
+  int			jpegQuality;	/*!< Default JPEG quality. */
+  int			maxCVT;		/*!< Maximum CVT size or -1. */
+  string		version;	/*!< Server version string. */
+} IIPWorker;
+
 unsigned long accessCount;
+static pthread_mutex_t accessMutex = PTHREAD_MUTEX_INITIALIZER;
+#ifndef DEBUG
+static pthread_mutex_t acceptMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
 
 /* Handle a signal - print out some stats and exit
  */
@@ -98,6 +144,318 @@ void		IIPSignalHandler(int signal)
   exit(1);
 }
 
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Counts a served request and logs the time taken.
+* \param	worker			The worker which served the request.
+* \param	timer			Timer started with the request.
+*/
+static void	IIPRequestDone(IIPWorker *worker, Timer &timer)
+{
+  pthread_mutex_lock(&accessMutex);
+  unsigned long count = ++accessCount;
+  pthread_mutex_unlock(&accessMutex);
+
+  // How long did this request take?
+  LOG_INFO("[" << worker->id << "] Total Request Time: " <<
+           timer.getTime() << "us");
+  LOG_INFO("Image closed and deleted" << endl << "Server count is " <<
+            count);
+}
+
+/*!
+* \return	The entity tag of the response, empty if it has none.
+* \ingroup	WlzIIPServer
+* \brief	Finds the ETag header of a CGI style response.
+* \param	output			Response headers and body.
+*/
+static string	IIPResponseETag(const string &output)
+{
+  string	etag;
+  const size_t	end = output.find("\r\n\r\n");
+  size_t	b = output.find("ETag: ");
+
+  if((end != string::npos) && (b != string::npos) && (b < end) &&
+     ((b == 0) || (output[b - 1] == '\n')))
+  {
+    b += 6;
+    etag = output.substr(b, output.find("\r\n", b) - b);
+  }
+  return(etag);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Parses and runs a single request, sending the response using
+* 		the given writer. All exceptions are handled here.
+* 		Successful responses are kept in the response cache, if
+* 		any, from which identical requests are then served without
+* 		running their commands.
+* \param	worker			The worker serving the request.
+* \param	query			The query string, may be NULL.
+* \param	client			The client's address, may be NULL.
+* \param	ifNoneMatch		The request's If-None-Match header,
+* 					may be NULL.
+* \param	out			Writer for the response.
+*/
+static void	IIPProcessRequest(IIPWorker *worker, const char *query,
+				  const char *client, const char *ifNoneMatch,
+				  Writer &out)
+{
+  Timer request_timer;
+  Task* task = NULL;
+  string cacheKey;
+
+  LOG_COND_INFO(request_timer.start());
+
+  // Serve identical requests straight from the response cache
+  if(worker->responseCache && query &&
+     !(cacheKey = ResponseCache::key(query)).empty())
+  {
+    string cached;
+    if(worker->responseCache->get(cacheKey, cached))
+    {
+      LOG_INFO("[" << worker->id << "] Response cache hit for " << cacheKey);
+      // The client may already have the cached response
+      string etag = IIPResponseETag(cached);
+      if(ifNoneMatch && !etag.empty() && Task::matchETag(ifNoneMatch, etag))
+      {
+        cached = "Status: 304 Not Modified\r\n" + Task::cacheHeaders(etag) +
+	         "\r\n";
+      }
+      if((out.putStr(cached.data(), cached.size()) != (int )cached.size()) ||
+         (out.flush() == -1))
+      {
+	LOG_ERROR("Error sending cached response");
+      }
+      IIPRequestDone(worker, request_timer);
+      return;
+    }
+  }
+  // Keep a copy of the response for the response cache
+  RecordingWriter writer(&out, (cacheKey.empty())? 0: RESPONSECACHE_MAX_ENTRY);
+  // Declare our image pointer here outside of the try scope
+  //  so that we can close the image on exceptions
+  IIPImage *image = NULL;
+  JPEGCompressor jpeg( worker->jpegQuality );
+  PNGCompressor png;
+
+  // View object for use with the CVT command etc
+  View view;
+  if(worker->maxCVT != -1)
+  {
+    view.setMaxSize(worker->maxCVT);
+    LOG_INFO("CVT maximum viewport size set to " << worker->maxCVT);
+  }
+
+  // Create an IIPResponse object - we use this for the OBJ requests.
+  // As the commands return images etc, they handle their own responses.
+  IIPResponse response;
+  ViewParameters viewParams;
+  try
+  {
+
+    // Get the query into a string
+    string request_string = (query)? string(query): string();
+
+    // Check that we actually have a request string
+    if(request_string.length() == 0)
+    {
+      throw string( "QUERY_STRING not set" );
+    }
+    LOG_INFO("[" << worker->id << "] Full Request is " << request_string);
+
+    // Set up our session data object
+    Session session;
+    session.image = &image;
+    session.response = &response;
+    session.view = &view;
+    session.viewParams = &viewParams;
+    session.jpeg = &jpeg;
+    session.png = &png;
+    session.imageCache = &(worker->imageCache);
+    session.tileCache = worker->tileCache;
+    session.prefetcher = worker->prefetcher;
+    session.client = (client)? string(client): string();
+    session.ifNoneMatch = (ifNoneMatch)? string(ifNoneMatch): string();
+    session.notModified = false;
+    session.out = &writer;
+
+    // Parse up the command list
+    list < pair<string,string> > requests;
+    list < pair<string,string> > :: const_iterator commands;
+    Tokenizer izer(request_string, "&");
+    while(izer.hasMoreTokens())
+    {
+      pair <string,string> p;
+      string token = izer.nextToken();
+      int n = token.find_first_of("=");
+      p.first = token.substr(0, n);
+      p.second = token.substr(n + 1, token.length());
+      if(p.first.length() && p.second.length())
+      {
+	requests.push_back(p);
+      }
+    }
+    int i = 0;
+    for(commands = requests.begin(); commands != requests.end(); commands++)
+    {
+      string command = (*commands).first;
+      string argument = (*commands).second;
+
+#ifdef WLZ_IIP_LOG
+      ++i;
+      LOG_INFO("[" << i << "/" << requests.size() <<
+	       "]: Command / Argument is " << command << " : " << argument);
+#endif
+      task = Task::factory( command );
+      if(task)
+      {
+	task->run(&session, argument);
+	delete task;
+	task = NULL;
+      }
+      else
+      {
+	LOG_WARN("Unsupported command: " << command);
+	// Unsupported command error code is 2 2
+	response.setError("2 2", command);
+      }
+    }
+
+    ////////// Send out our Errors if necessary ////////////
+
+    // Make sure something has actually been sent to the client
+    // If no response has been sent by now, we must have a malformed
+    // command.
+    if((!response.imageSent()) && (!response.isSet()))
+    {
+      // Malformed command syntax error code is 2 1
+      response.setError( "2 1", request_string );
+    }
+
+    // Once we have finished parsing all our OBJ and COMMAND requests
+    // send out our response.
+    if(response.isSet())
+    {
+      LOG_INFO("---" << endl << response.formatResponse() << endl << "---");
+      if(writer.putS(response.formatResponse().c_str()) == -1)
+      {
+	LOG_ERROR("Error sending IIPResponse");
+      }
+    }
+
+    // Only complete, successful responses are cached
+    if(!cacheKey.empty() && !response.errorIsSet() && !session.notModified &&
+       writer.isComplete())
+    {
+      worker->responseCache->insert(cacheKey, writer.getRecord());
+    }
+
+    //////////////// End of try block ////////////////////
+  }
+  catch( const string& error )
+  {
+    LOG_ERROR("Error " << error);
+    if(response.errorIsSet())
+    {
+      LOG_INFO("---" << endl << response.formatResponse() << endl << "---");
+      if(writer.putS(response.formatResponse().c_str()) == -1)
+      {
+	LOG_ERROR("Error sending IIPResponse");
+      }
+    }
+    else
+    {
+      // Display our advertising banner ;-)
+      writer.putS(response.getAdvert(worker->version).c_str());
+    }
+  }
+  catch( ... ) /* Default catch */
+  {
+    LOG_ERROR("Error: Default Catch: ");
+    // Display our advertising banner ;-)
+    writer.putS( response.getAdvert( worker->version ).c_str() );
+
+  }
+  // Do some cleaning up etc. here after all the potential exceptions
+  // have been handled
+  if(task)
+  {
+    delete task;
+    task = NULL;
+  }
+  if(image)
+  {
+    delete image;
+    image = NULL;
+  }
+  IIPRequestDone(worker, request_timer);
+}
+
+#ifndef DEBUG
+/*!
+* \return	Always NULL.
+* \ingroup	WlzIIPServer
+* \brief	Main FCGI loop of a request worker thread. Calls to
+* 		FCGX_Accept_r() are serialised, requests are then served
+* 		concurrently.
+* \param	arg			The worker.
+*/
+static void	*IIPWorkerRun(void *arg)
+{
+  int		rc;
+  IIPWorker	*worker = (IIPWorker *)arg;
+
+  LOG_INFO("Worker " << worker->id << " started");
+  for(;;)
+  {
+    pthread_mutex_lock(&acceptMutex);
+    rc = FCGX_Accept_r(&(worker->request));
+    pthread_mutex_unlock(&acceptMutex);
+    if(rc < 0)
+    {
+      break;
+    }
+    IIPWriter writer( worker->request.out );
+    IIPProcessRequest(worker,
+                      FCGX_GetParam("QUERY_STRING", worker->request.envp),
+                      FCGX_GetParam("REMOTE_ADDR", worker->request.envp),
+                      FCGX_GetParam("HTTP_IF_NONE_MATCH", worker->request.envp),
+		      writer);
+    FCGX_Finish_r(&(worker->request));
+  }
+  LOG_INFO("Worker " << worker->id << " terminating");
+  return(NULL);
+}
+
+/*!
+* \return	Always NULL.
+* \ingroup	WlzIIPServer
+* \brief	Main loop of a request worker thread in HTTP mode. Requests
+* 		are taken from the HTTP server and their responses are
+* 		handed back to it to be sent.
+* \param	arg			The worker.
+*/
+static void	*IIPHTTPWorkerRun(void *arg)
+{
+  IIPWorker	*worker = (IIPWorker *)arg;
+  HTTPServer::Request *req;
+
+  LOG_INFO("Worker " << worker->id << " started");
+  while((req = worker->httpServer->next()) != NULL)
+  {
+    BufferWriter writer;
+    IIPProcessRequest(worker, req->query.c_str(), req->client.c_str(),
+                      req->ifNoneMatch.c_str(), writer);
+    req->output.swap(writer.getBuffer());
+    worker->httpServer->done(req);
+  }
+  LOG_INFO("Worker " << worker->id << " terminating");
+  return(NULL);
+}
+#endif
+
 int main( int argc, char *argv[] )
 {
 
@@ -128,10 +486,16 @@ int main( int argc, char *argv[] )
 
   // Set up some FCGI items and make sure we are in FCGI mode
 #ifndef DEBUG
-  FCGX_Request request;
   int listen_socket = 0;
   int usePort = 0;
+  int useHTTP = 0;
+  HTTPServer httpServer;
 
+  if(FCGX_Init())
+  {
+    LOG_FATAL("FCGI library initialisation failed.");
+    exit(1);
+  }
   if(argv[1] && (string(argv[1]) == "--standalone"))
   {
     string socket = argv[2];
@@ -167,13 +531,24 @@ int main( int argc, char *argv[] )
     }
     LOG_NOTICE("Server started on port '" << port << "'");
     usePort = 1;
-  }
-  if(FCGX_InitRequest(&request, listen_socket, 0))
+  } else
+  if(argv[1] && (string(argv[1]) == "--http"))
   {
-    LOG_FATAL("FCGI initialisation failed.");
-    exit(1);
+    string port = (argc > 2)? argv[2]: "";
+    if(!port.length())
+    {
+      LOG_FATAL("No port is specified");
+      exit(1);
+    }
+    if(!httpServer.open(port))
+    {
+      LOG_FATAL("Unable to open HTTP port '" << port << "'");
+      exit(1);
+    }
+    LOG_NOTICE("HTTP server started on port '" << port << "'");
+    useHTTP = 1;
   }
-  if(FCGX_IsCGI() && (usePort == 0))
+  if(FCGX_IsCGI() && (usePort == 0) && (useHTTP == 0))
   {
     LOG_FATAL("CGI-only mode detected.");
     exit(1);
@@ -181,7 +556,11 @@ int main( int argc, char *argv[] )
   else
   {
 #ifdef WLZ_IIP_LOG
-    if(usePort)
+    if(useHTTP)
+    {
+      LOG_INFO("Running in HTTP mode");
+    }
+    else if(usePort)
     {
       LOG_INFO("Running in independent server mode");
     }
@@ -194,13 +573,23 @@ int main( int argc, char *argv[] )
 #endif
   // Set maximum image cache size
   float max_image_cache_size = Environment::getMaxImageCacheSize();
-  imageCacheMapType imageCache;
   // Get our image pattern variable
   string filename_pattern = Environment::getFileNamePattern();
   //  Get our default quality variable
   int jpeg_quality = Environment::getJPEGQuality();
   //  Get our max CVT size (not respected by Woolz objects)
   int max_CVT = Environment::getMaxCVT();
+  //  Get the number of request worker threads
+#ifdef DEBUG
+  int num_threads = 1;
+  int prefetch_threads = 0;
+  int warm_threads = 0;
+#else
+  int num_threads = Environment::getNumThreads();
+  int prefetch_threads = Environment::getPrefetchThreads();
+  int warm_threads = Environment::getWarmThreads();
+#endif
+  string warm_manifest = Environment::getWarmManifest();
   LOG_INFO("Setting maximum image cache size to " <<
            max_image_cache_size << "MB");
   LOG_INFO("Setting 3D file sequence name pattern to " <<
@@ -214,6 +603,21 @@ int main( int argc, char *argv[] )
 	   Environment::getMaxWlzObjCacheSize() << "MB");
   LOG_INFO("Tile size " << Environment::getWlzTileWidth() << " x " <<
 	   Environment::getWlzTileHeight());
+  LOG_INFO("Setting number of request worker threads to " << num_threads);
+  LOG_INFO("Setting response cache size to " <<
+           Environment::getResponseCacheSize() << "MB");
+  LOG_INFO("Setting shared tile cache size to " <<
+           Environment::getShmTileCacheSize() << "MB, generation " <<
+	   Environment::getShmTileCacheGeneration());
+  LOG_INFO("Setting number of tile prefetch threads to " <<
+           prefetch_threads << " with a budget of " <<
+	   Environment::getPrefetchBudget() << " tiles per session");
+  if(!warm_manifest.empty())
+  {
+    LOG_INFO("Setting cache warming manifest to " << warm_manifest <<
+             " with " << warm_threads << " threads and up to " <<
+	     Environment::getWarmTiles() << " tiles per entry");
+  }
 
   // Check for loadable modules, but only if enabled by configure
 #ifdef ENABLE_DL
@@ -258,182 +662,81 @@ int main( int argc, char *argv[] )
 #endif
   signal(SIGTERM, IIPSignalHandler);
 
-  LOG_INFO("Initialisation Complete.");
-
-  // Set up some timers and create our tile cache
-  Timer request_timer;
+  // Create our tile cache which is shared by all the workers and
+  // attach it to the tile cache shared by all processes on this host.
+  // Shared cache slots are big enough for an uncompressed RGBA tile.
   Cache tileCache(max_image_cache_size);
-  Task* task = NULL;
-
-  // Main FCGI loop
-#ifdef DEBUG
-  int status = true;
-  while(status)
+  SharedTileCache sharedTileCache(Environment::getShmTileCacheName(),
+                                  Environment::getShmTileCacheSize(),
+				  Environment::getWlzTileWidth() *
+				  Environment::getWlzTileHeight() * 4,
+				  Environment::getShmTileCacheGeneration());
+  tileCache.setSharedCache(&sharedTileCache);
+
+  // Create the response cache shared by all the workers
+  ResponseCache responseCache(Environment::getResponseCacheSize());
+
+  // Create the tile prefetcher, which renders the tiles around those
+  // served into the tile cache on low priority background threads.
+  TilePrefetcher prefetcher(&tileCache, prefetch_threads,
+                            Environment::getPrefetchBudget());
+
+  // Set up the request workers
+  IIPWorker *workers = new IIPWorker[num_threads];
+  for(int i = 0; i < num_threads; ++i)
   {
-    status = false;
+    workers[i].id = i;
+    workers[i].tileCache = &tileCache;
+    workers[i].prefetcher = (prefetcher.isValid())? &prefetcher: NULL;
+    workers[i].responseCache = (responseCache.isValid())? &responseCache: NULL;
+    workers[i].jpegQuality = jpeg_quality;
+    workers[i].maxCVT = max_CVT;
+    workers[i].version = version;
+#ifdef DEBUG
+    workers[i].httpServer = NULL;
 #else
-  while( FCGX_Accept_r( &request ) >= 0 )
-  {
-    FCGIWriter writer( request.out );
-#endif
-    LOG_COND_INFO(request_timer.start());
-    // Declare our image pointer here outside of the try scope
-    //  so that we can close the image on exceptions
-    IIPImage *image = NULL;
-    JPEGCompressor jpeg( jpeg_quality );
-    PNGCompressor png;
-
-    // View object for use with the CVT command etc
-    View view;
-    if(max_CVT != -1)
+    workers[i].httpServer = (useHTTP)? &httpServer: NULL;
+    if(!useHTTP &&
+       FCGX_InitRequest(&(workers[i].request), listen_socket, 0))
     {
-      view.setMaxSize(max_CVT);
-      LOG_INFO("CVT maximum viewport size set to " << max_CVT);
+      LOG_FATAL("FCGI initialisation failed.");
+      exit(1);
     }
-
-    // Create an IIPResponse object - we use this for the OBJ requests.
-    // As the commands return images etc, they handle their own responses.
-    IIPResponse response;
-    ViewParameters viewParams;
-    try
-    {
-
-      // Get the query into a string
-#ifdef DEBUG
-      string request_string = argv[1];
-#else
-      string request_string = FCGX_GetParam( "QUERY_STRING", request.envp );
 #endif
+  }
 
-      // Check that we actually have a request string
-      if(request_string.length() == 0)
-      {
-	throw string( "QUERY_STRING not set" );
-      }
-      LOG_INFO("Full Request is " << request_string);
-
-      // Set up our session data object
-      Session session;
-      session.image = &image;
-      session.response = &response;
-      session.view = &view;
-      session.viewParams = &viewParams;
-      session.jpeg = &jpeg;
-      session.png = &png;
-      session.imageCache = &imageCache;
-      session.tileCache = &tileCache;
-      session.out = &writer;
-
-      // Parse up the command list
-      list < pair<string,string> > requests;
-      list < pair<string,string> > :: const_iterator commands;
-      Tokenizer izer(request_string, "&");
-      while(izer.hasMoreTokens())
-      {
-	pair <string,string> p;
-	string token = izer.nextToken();
-	int n = token.find_first_of("=");
-	p.first = token.substr(0, n);
-	p.second = token.substr(n + 1, token.length());
-	if(p.first.length() && p.second.length())
-	{
-	  requests.push_back(p);
-        }
-      }
-      int i = 0;
-      for(commands = requests.begin(); commands != requests.end(); commands++)
-      {
-	string command = (*commands).first;
-	string argument = (*commands).second;
-
-#ifdef WLZ_IIP_LOG
-	++i;
-	LOG_INFO("[" << i << "/" << requests.size() <<
-	         "]: Command / Argument is " << command << " : " << argument);
-#endif
-	task = Task::factory( command );
-	if(task)
-	{
-	  task->run(&session, argument);
-	  delete task;
-	  task = NULL;
-	}
-	else
-	{
-	  LOG_WARN("Unsupported command: " << command);
-	  // Unsupported command error code is 2 2
-	  response.setError("2 2", command);
-	}
-      }
-
-      ////////// Send out our Errors if necessary ////////////
-
-      // Make sure something has actually been sent to the client
-      // If no response has been sent by now, we must have a malformed
-      // command.
-      if((!response.imageSent()) && (!response.isSet()))
-      {
-	// Malformed command syntax error code is 2 1
-	response.setError( "2 1", request_string );
-      }
-
-      // Once we have finished parsing all our OBJ and COMMAND requests
-      // send out our response.
-      if(response.isSet())
-      {
-	LOG_INFO("---" << endl << response.formatResponse() << endl << "---");
-	if(writer.putS(response.formatResponse().c_str()) == -1)
-	{
-	  LOG_ERROR("Error sending IIPResponse");
-	}
-      }
+  LOG_INFO("Initialisation Complete.");
 
-      //////////////// End of try block ////////////////////
-    }
-    catch( const string& error )
-    {
-      LOG_ERROR("Error " << error);
-      if(response.errorIsSet())
-      {
-	LOG_INFO("---" << endl << response.formatResponse() << endl << "---");
-	if(writer.putS(response.formatResponse().c_str()) == -1)
-	{
-	  LOG_ERROR("Error sending IIPResponse");
-	}
-      }
-      else
-      {
-	// Display our advertising banner ;-)
-	writer.putS(response.getAdvert(version).c_str());
-      }
-    }
-    catch( ... ) /* Default catch */
-    {
-      LOG_ERROR("Error: Default Catch: ");
-      // Display our advertising banner ;-)
-      writer.putS( response.getAdvert( version ).c_str() );
+  // Warm the caches from the manifest, if any, on low priority background
+  // threads while requests are served.
+  CacheWarmer warmer(&tileCache, warm_manifest, warm_threads,
+                     Environment::getWarmTiles(), jpeg_quality);
 
-    }
-    // Do some cleaning up etc. here after all the potential exceptions
-    // have been handled
-    if(task)
-    {
-      delete task;
-      task = NULL;
-    }
-    if(image)
+#ifdef DEBUG
+  // Serve the single request given on the command line
+  {
+    IIPWriter writer( stdout );
+    IIPProcessRequest(&(workers[0]), argv[1], NULL, NULL, writer);
+  }
+#else
+  // Worker 0 runs in the main thread, the rest in their own threads
+  void *(*workerRun)(void *) = (useHTTP)? IIPHTTPWorkerRun: IIPWorkerRun;
+  for(int i = 1; i < num_threads; ++i)
+  {
+    if(pthread_create(&(workers[i].thread), NULL, workerRun,
+                      &(workers[i])))
     {
-      delete image;
-      image = NULL;
+      LOG_FATAL("Failed to create request worker thread " << i);
+      exit(1);
     }
-    ++accessCount;
-
-    // How long did this request take?
-    LOG_INFO("Total Request Time: " << request_timer.getTime() << "us");
-    LOG_INFO("Image closed and deleted" << endl << "Server count is " <<
-              accessCount);
-    ///////// End of FCGI_ACCEPT while loop or for loop in debug mode //////////
   }
+  (void )workerRun(&(workers[0]));
+  for(int i = 1; i < num_threads; ++i)
+  {
+    (void )pthread_join(workers[i].thread, NULL);
+  }
+#endif
+  delete[] workers;
   LOG_NOTICE("Terminating after " << accessCount << " iterations");
 #ifdef WLZ_IIP_LOG
   log4cpp::Category::shutdown();
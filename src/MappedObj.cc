@@ -0,0 +1,804 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _MappedObj_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         MappedObj.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Flat, memory mappable files of 3D Woolz domain objects.
+* 		A mapped object file holds a header, a table of planes and,
+* 		for each plane, the number of intervals on each line, the
+* 		intervals and a rectangular array of grey values covering
+* 		the plane's bounding box. All arrays are aligned so that
+* 		the file may be mapped and wrapped as a Woolz object
+* 		without any parsing. The files are in the native byte
+* 		order and are not meant to be portable.
+* \ingroup	WlzIIPServer
+*/
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <list>
+#include <vector>
+#include "CacheKey.h"
+#include "MappedObj.h"
+
+using namespace std;
+
+/*!
+* \def		MAPPEDOBJ_MAGIC
+* \ingroup	WlzIIPServer
+* \brief	Magic string at the start of a mapped object file.
+*/
+#define MAPPEDOBJ_MAGIC		"WLZIIPM"
+
+/*!
+* \def		MAPPEDOBJ_VERSION
+* \ingroup	WlzIIPServer
+* \brief	Version of the mapped object file format.
+*/
+#define MAPPEDOBJ_VERSION	(1)
+
+/*!
+* \def		MAPPEDOBJ_ALIGN
+* \ingroup	WlzIIPServer
+* \brief	Alignment of the arrays in a mapped object file.
+*/
+#define MAPPEDOBJ_ALIGN		(64)
+
+/*!
+* \struct	_MappedObjHead
+* \ingroup	WlzIIPServer
+* \brief	Header of a mapped object file.
+*/
+typedef struct _MappedObjHead
+{
+  char		magic[8];		/*!< MAPPEDOBJ_MAGIC. */
+  unsigned int	version;		/*!< MAPPEDOBJ_VERSION. */
+  unsigned int	byteOrder;		/*!< 0x01020304 in the writer's
+  					     byte order. */
+  int		gType;			/*!< Grey type, or -1 if the
+  					     object has no values. */
+  int		plane1;			/*!< First plane. */
+  int		lastpl;			/*!< Last plane. */
+  int		line1;			/*!< First line. */
+  int		lastln;			/*!< Last line. */
+  int		kol1;			/*!< First column. */
+  int		lastkl;			/*!< Last column. */
+  float		voxelSz[3];		/*!< Voxel size. */
+  WlzPixelV	bgd;			/*!< Background value. */
+  unsigned long long planeOff;		/*!< Offset of the plane table. */
+} MappedObjHead;
+
+/*!
+* \struct	_MappedObjPlane
+* \ingroup	WlzIIPServer
+* \brief	Plane table entry of a mapped object file. The plane is
+* 		empty if lastln < line1.
+*/
+typedef struct _MappedObjPlane
+{
+  int		line1;			/*!< First line. */
+  int		lastln;			/*!< Last line. */
+  int		kol1;			/*!< First column. */
+  int		lastkl;			/*!< Last column. */
+  unsigned long long nIntv;		/*!< Total number of intervals. */
+  unsigned long long lineOff;		/*!< Offset of the number of
+  					     intervals (int) on each line. */
+  unsigned long long intvOff;		/*!< Offset of the intervals,
+  					     relative to kol1. */
+  unsigned long long valOff;		/*!< Offset of the grey values,
+  					     zero if none. */
+} MappedObjPlane;
+
+/*!
+* \struct	_MappedObjMap
+* \ingroup	WlzIIPServer
+* \brief	A mapped file and the object wrapping it.
+*/
+typedef struct _MappedObjMap
+{
+  WlzObject	*obj;			/*!< Object, to which the table
+  					     holds a link. */
+  char		*base;			/*!< Base of the mapping. */
+  size_t	size;			/*!< Size of the mapping. */
+} MappedObjMap;
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Table of the files which are mapped, see
+* 		MappedObjRelease().
+*/
+static list<MappedObjMap> MappedObjMaps;
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Protects MappedObjMaps.
+*/
+static pthread_mutex_t MappedObjMapsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool			MappedObjInUse(
+				  WlzObject *obj);
+static unsigned long long	MappedObjAlign(
+				  unsigned long long off);
+static WlzErrorNum		MappedObjWriteAt(
+				  FILE *fP,
+				  unsigned long long *off,
+				  const void *data,
+				  size_t size);
+
+/*!
+* \return	Woolz object or NULL on error.
+* \ingroup	WlzIIPServer
+* \brief	Maps a mapped object file and wraps it as a 3D domain
+* 		object. The intervals and grey values of the object are
+* 		those of the (privately) mapped file, so only the pages
+* 		which are used are read and the page cache is shared by
+* 		all processes mapping the file. Only the domain and value
+* 		table structures are allocated. The mapping is writable
+* 		since Woolz takes non const pointers to the intervals and
+* 		values, but any write is private to the process. Woolz
+* 		does not free data it did not allocate, so the object and
+* 		mapping are recorded in a table which holds a link to the
+* 		object and MappedObjRelease() unmaps the file once nothing
+* 		else uses it.
+* \param	name			File name.
+* \param	dstErr			Destination error pointer, may be NULL.
+*/
+WlzObject			*MappedObjRead(
+				  const char *name,
+				  WlzErrorNum *dstErr)
+{
+  int		fd,
+		idx,
+		nPl = 0;
+  size_t	size = 0;
+  char		*base = NULL;
+  struct stat	st;
+  WlzDomain	dom;
+  WlzValues	val;
+  WlzObjectType	tType = WLZ_GREY_TAB_RECT;
+  const MappedObjHead *head = NULL;
+  const MappedObjPlane *planes = NULL;
+  WlzObject	*obj = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  MappedObjRelease();
+  dom.core = NULL;
+  val.core = NULL;
+  if((fd = open(name, O_RDONLY)) < 0)
+  {
+    errNum = WLZ_ERR_FILE_OPEN;
+  }
+  else
+  {
+    if((fstat(fd, &st) != 0) || (st.st_size < (off_t )sizeof(MappedObjHead)))
+    {
+      errNum = WLZ_ERR_READ_INCOMPLETE;
+    }
+    else
+    {
+      size = st.st_size;
+      base = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                          fd, 0);
+      if(base == MAP_FAILED)
+      {
+        base = NULL;
+	errNum = WLZ_ERR_MEM_ALLOC;
+      }
+    }
+    (void )close(fd);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    head = (const MappedObjHead *)base;
+    nPl = head->lastpl - head->plane1 + 1;
+    if((strncmp(head->magic, MAPPEDOBJ_MAGIC, 8) != 0) ||
+       (head->version != MAPPEDOBJ_VERSION) ||
+       (head->byteOrder != 0x01020304) || (nPl < 1) ||
+       (head->planeOff + (nPl * sizeof(MappedObjPlane)) > size))
+    {
+      errNum = WLZ_ERR_FILE_FORMAT;
+    }
+    else
+    {
+      planes = (const MappedObjPlane *)(base + head->planeOff);
+    }
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    dom.p = WlzMakePlaneDomain(WLZ_PLANEDOMAIN_DOMAIN,
+			       head->plane1, head->lastpl,
+			       head->line1, head->lastln,
+			       head->kol1, head->lastkl, &errNum);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    for(idx = 0; idx < 3; ++idx)
+    {
+      dom.p->voxel_size[idx] = head->voxelSz[idx];
+    }
+    if(head->gType >= 0)
+    {
+      tType = WlzGreyTableType(WLZ_GREY_TAB_RECT, (WlzGreyType )head->gType,
+                               &errNum);
+      if(errNum == WLZ_ERR_NONE)
+      {
+	val.vox = WlzMakeVoxelValueTb(WLZ_VOXELVALUETABLE_GREY,
+				      head->plane1, head->lastpl,
+				      head->bgd, NULL, &errNum);
+      }
+    }
+  }
+  for(idx = 0; (errNum == WLZ_ERR_NONE) && (idx < nPl); ++idx)
+  {
+    const MappedObjPlane *pl = planes + idx;
+    const unsigned long long nLn = pl->lastln - pl->line1 + 1,
+    		width = pl->lastkl - pl->kol1 + 1;
+
+    if(pl->lastln < pl->line1)
+    {
+      continue;
+    }
+    if((pl->lastkl < pl->kol1) ||
+       (pl->lineOff + (nLn * sizeof(int)) > size) ||
+       (pl->intvOff + (pl->nIntv * sizeof(WlzInterval)) > size) ||
+       (val.core && ((pl->valOff == 0) ||
+                     (pl->valOff + (nLn * width *
+		      WlzGreySize((WlzGreyType )head->gType)) > size))))
+    {
+      errNum = WLZ_ERR_FILE_FORMAT;
+      break;
+    }
+    WlzDomain	pDom;
+    const int	*nIntv = (const int *)(base + pl->lineOff);
+    WlzInterval	*intv = (WlzInterval *)(base + pl->intvOff);
+    unsigned long long cnt = 0;
+
+    pDom.i = WlzMakeIntervalDomain(WLZ_INTERVALDOMAIN_INTVL,
+                                   pl->line1, pl->lastln,
+				   pl->kol1, pl->lastkl, &errNum);
+    for(unsigned long long ln = 0; (errNum == WLZ_ERR_NONE) && (ln < nLn);
+        ++ln)
+    {
+      if((nIntv[ln] < 0) || ((cnt += nIntv[ln]) > pl->nIntv))
+      {
+        errNum = WLZ_ERR_FILE_FORMAT;
+      }
+      // The intervals must be ordered and lie within the plane's columns.
+      for(int i = 0; (errNum == WLZ_ERR_NONE) && (i < nIntv[ln]); ++i)
+      {
+	if((intv[i].ileft < ((i > 0)? intv[i - 1].iright + 1: 0)) ||
+	   (intv[i].iright < intv[i].ileft) ||
+	   ((unsigned long long )(intv[i].iright) >= width))
+	{
+	  errNum = WLZ_ERR_FILE_FORMAT;
+	}
+      }
+      if(errNum == WLZ_ERR_NONE)
+      {
+	errNum = WlzMakeInterval(pl->line1 + ln, pDom.i, nIntv[ln], intv);
+	intv += nIntv[ln];
+      }
+    }
+    if(errNum == WLZ_ERR_NONE)
+    {
+      dom.p->domains[idx] = WlzAssignDomain(pDom, NULL);
+    }
+    else if(pDom.i)
+    {
+      (void )WlzFreeIntervalDomain(pDom.i);
+    }
+    if((errNum == WLZ_ERR_NONE) && val.core)
+    {
+      WlzValues	pVal;
+
+      pVal.r = WlzMakeRectValueTb(tType, pl->line1, pl->lastln, pl->kol1,
+				  width, head->bgd,
+				  (int *)(base + pl->valOff), &errNum);
+      if(errNum == WLZ_ERR_NONE)
+      {
+        val.vox->values[idx] = WlzAssignValues(pVal, NULL);
+      }
+    }
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    obj = WlzMakeMain(WLZ_3D_DOMAINOBJ, dom, val, NULL, NULL, &errNum);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    MappedObjMap map;
+
+    map.obj = WlzAssignObject(obj, NULL);
+    map.base = base;
+    map.size = size;
+    pthread_mutex_lock(&MappedObjMapsMutex);
+    MappedObjMaps.push_back(map);
+    pthread_mutex_unlock(&MappedObjMapsMutex);
+  }
+  if(errNum != WLZ_ERR_NONE)
+  {
+    if(val.vox)
+    {
+      (void )WlzFreeVoxelValueTb(val.vox);
+    }
+    if(dom.p)
+    {
+      (void )WlzFreePlaneDomain(dom.p);
+    }
+    if(base)
+    {
+      (void )munmap(base, size);
+    }
+  }
+  if(dstErr)
+  {
+    *dstErr = errNum;
+  }
+  return(obj);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Frees the objects read by MappedObjRead() which are no
+* 		longer used and unmaps their files. An object is unused
+* 		once the table holds the only link to it and to each of
+* 		its domains and value tables, after which no other link
+* 		can be made. This is called by MappedObjRead() and should
+* 		be called after freeing a mapped object.
+*/
+void				MappedObjRelease(void)
+{
+  pthread_mutex_lock(&MappedObjMapsMutex);
+  list<MappedObjMap>::iterator it = MappedObjMaps.begin();
+  while(it != MappedObjMaps.end())
+  {
+    if(MappedObjInUse(it->obj))
+    {
+      ++it;
+    }
+    else
+    {
+      (void )WlzFreeObj(it->obj);
+      (void )munmap(it->base, it->size);
+      it = MappedObjMaps.erase(it);
+    }
+  }
+  pthread_mutex_unlock(&MappedObjMapsMutex);
+}
+
+/*!
+* \return	True if anything other than the mapped object table holds
+* 		a link to the object, its domains or its value tables.
+* \ingroup	WlzIIPServer
+* \brief	Checks whether a mapped object is in use.
+* \param	obj			Object made by MappedObjRead().
+*/
+static bool			MappedObjInUse(
+				  WlzObject *obj)
+{
+  int		idx,
+  		nPl;
+  WlzPlaneDomain *pDom = obj->domain.p;
+  WlzVoxelValues *vox = obj->values.vox;
+
+  if((obj->linkcount > 1) || (pDom->linkcount > 1) ||
+     (vox && (vox->linkcount > 1)))
+  {
+    return(true);
+  }
+  nPl = pDom->lastpl - pDom->plane1 + 1;
+  for(idx = 0; idx < nPl; ++idx)
+  {
+    if((pDom->domains[idx].core &&
+        (pDom->domains[idx].core->linkcount > 1)) ||
+       (vox && vox->values[idx].core &&
+        (vox->values[idx].core->linkcount > 1)))
+    {
+      return(true);
+    }
+  }
+  return(false);
+}
+
+/*!
+* \return	Woolz error code.
+* \ingroup	WlzIIPServer
+* \brief	Writes a 3D domain object as a mapped object file. The
+* 		object must have a plane domain of interval domains and
+* 		either no values, a voxel value table or tiled values.
+* \param	name			File name.
+* \param	obj			Object to write.
+*/
+WlzErrorNum			MappedObjWrite(
+				  const char *name,
+				  WlzObject *obj)
+{
+  int		idx,
+  		nPl = 0,
+		gSz = 0;
+  bool		tiled = false;
+  unsigned long long off = 0;
+  FILE		*fP = NULL;
+  WlzPlaneDomain *pDom = NULL;
+  WlzPixelV	bgdV;
+  MappedObjHead	head;
+  vector<MappedObjPlane> planes;
+  WlzGreyValueWSpace *gVWSp = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  (void )memset(&head, 0, sizeof(MappedObjHead));
+  if(obj == NULL)
+  {
+    errNum = WLZ_ERR_OBJECT_NULL;
+  }
+  else if(obj->type != WLZ_3D_DOMAINOBJ)
+  {
+    errNum = WLZ_ERR_OBJECT_TYPE;
+  }
+  else if((pDom = obj->domain.p) == NULL)
+  {
+    errNum = WLZ_ERR_DOMAIN_NULL;
+  }
+  else if(pDom->type != WLZ_PLANEDOMAIN_DOMAIN)
+  {
+    errNum = WLZ_ERR_DOMAIN_TYPE;
+  }
+  else
+  {
+    head.gType = -1;
+    if(obj->values.core)
+    {
+      tiled = WlzGreyTableIsTiled(obj->values.core->type) != 0;
+      if(!tiled && (obj->values.core->type != WLZ_VOXELVALUETABLE_GREY))
+      {
+        errNum = WLZ_ERR_VALUES_TYPE;
+      }
+      else
+      {
+	head.gType = WlzGreyTypeFromObj(obj, &errNum);
+      }
+      if(errNum == WLZ_ERR_NONE)
+      {
+	gSz = WlzGreySize((WlzGreyType )head.gType);
+	head.bgd = WlzGetBackground(obj, &errNum);
+      }
+      if(errNum == WLZ_ERR_NONE)
+      {
+        bgdV = head.bgd;
+	errNum = WlzValueConvertPixel(&bgdV, head.bgd,
+	                              (WlzGreyType )head.gType);
+      }
+      if((errNum == WLZ_ERR_NONE) && tiled)
+      {
+        gVWSp = WlzGreyValueMakeWSp(obj, &errNum);
+      }
+    }
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    (void )strncpy(head.magic, MAPPEDOBJ_MAGIC, 8);
+    head.version = MAPPEDOBJ_VERSION;
+    head.byteOrder = 0x01020304;
+    head.plane1 = pDom->plane1;
+    head.lastpl = pDom->lastpl;
+    head.line1 = pDom->line1;
+    head.lastln = pDom->lastln;
+    head.kol1 = pDom->kol1;
+    head.lastkl = pDom->lastkl;
+    for(idx = 0; idx < 3; ++idx)
+    {
+      head.voxelSz[idx] = pDom->voxel_size[idx];
+    }
+    nPl = pDom->lastpl - pDom->plane1 + 1;
+    head.planeOff = MappedObjAlign(sizeof(MappedObjHead));
+    planes.resize(nPl);
+    (void )memset(&(planes[0]), 0, nPl * sizeof(MappedObjPlane));
+    if((fP = fopen(name, "wb")) == NULL)
+    {
+      errNum = WLZ_ERR_FILE_OPEN;
+    }
+    else
+    {
+      off = MappedObjAlign(head.planeOff + (nPl * sizeof(MappedObjPlane)));
+    }
+  }
+  for(idx = 0; (errNum == WLZ_ERR_NONE) && (idx < nPl); ++idx)
+  {
+    MappedObjPlane *pl = &(planes[idx]);
+    WlzDomain	dom2;
+    WlzValues	val2;
+    WlzObject	*obj2 = NULL;
+    WlzIntervalWSpace iWSp;
+    WlzGreyWSpace gWSp;
+
+    pl->line1 = 0;
+    pl->lastln = -1;
+    if((dom2 = pDom->domains[idx]).core == NULL)
+    {
+      continue;
+    }
+    val2.core = (obj->values.core && !tiled)?
+                obj->values.vox->values[idx].core: NULL;
+    pl->line1 = dom2.i->line1;
+    pl->lastln = dom2.i->lastln;
+    pl->kol1 = dom2.i->kol1;
+    pl->lastkl = dom2.i->lastkl;
+    const size_t nLn = pl->lastln - pl->line1 + 1,
+    		 width = pl->lastkl - pl->kol1 + 1;
+    vector<int>	nIntv(nLn, 0);
+    vector<WlzInterval> intv;
+    vector<char> grey;
+
+    if(gSz > 0)
+    {
+      // Fill the values with the background outside of the domain.
+      grey.resize(nLn * width * gSz);
+      for(size_t i = 0; i < nLn * width; ++i)
+      {
+        (void )memcpy(&(grey[i * gSz]), &(bgdV.v), gSz);
+      }
+    }
+    obj2 = WlzAssignObject(
+           WlzMakeMain(WLZ_2D_DOMAINOBJ, dom2, val2, NULL, NULL, &errNum),
+	   NULL);
+    if(errNum == WLZ_ERR_NONE)
+    {
+      errNum = (val2.core)? WlzInitGreyScan(obj2, &iWSp, &gWSp):
+                            WlzInitRasterScan(obj2, &iWSp, WLZ_RASTERDIR_ILIC);
+    }
+    while((errNum == WLZ_ERR_NONE) &&
+          ((errNum = (val2.core)? WlzNextGreyInterval(&iWSp):
+	                          WlzNextInterval(&iWSp)) == WLZ_ERR_NONE))
+    {
+      WlzInterval itv;
+      const int	ln = iWSp.linpos - pl->line1,
+      		len = iWSp.rgtpos - iWSp.lftpos + 1;
+      char	*g = (gSz > 0)?
+                     &(grey[((ln * width) + iWSp.lftpos - pl->kol1) * gSz]):
+		     NULL;
+
+      ++(nIntv[ln]);
+      itv.ileft = iWSp.lftpos - pl->kol1;
+      itv.iright = iWSp.rgtpos - pl->kol1;
+      intv.push_back(itv);
+      if(val2.core)
+      {
+        (void )memcpy(g, gWSp.u_grintptr.v, len * gSz);
+      }
+      else if(gVWSp)
+      {
+        for(int k = 0; k < len; ++k)
+	{
+	  WlzGreyValueGet(gVWSp, pDom->plane1 + idx, iWSp.linpos,
+	                  iWSp.lftpos + k);
+	  (void )memcpy(g + (k * gSz), &(gVWSp->gVal[0]), gSz);
+	}
+      }
+    }
+    if(errNum == WLZ_ERR_EOO)
+    {
+      errNum = WLZ_ERR_NONE;
+    }
+    if(val2.core)
+    {
+      (void )WlzEndGreyScan(&iWSp, &gWSp);
+    }
+    (void )WlzFreeObj(obj2);
+    pl->nIntv = intv.size();
+    if(errNum == WLZ_ERR_NONE)
+    {
+      pl->lineOff = off;
+      errNum = MappedObjWriteAt(fP, &off, &(nIntv[0]), nLn * sizeof(int));
+    }
+    if((errNum == WLZ_ERR_NONE) && !intv.empty())
+    {
+      pl->intvOff = off;
+      errNum = MappedObjWriteAt(fP, &off, &(intv[0]),
+                                intv.size() * sizeof(WlzInterval));
+    }
+    if((errNum == WLZ_ERR_NONE) && (gSz > 0))
+    {
+      pl->valOff = off;
+      errNum = MappedObjWriteAt(fP, &off, &(grey[0]), grey.size());
+    }
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    off = 0;
+    errNum = MappedObjWriteAt(fP, &off, &head, sizeof(MappedObjHead));
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    off = head.planeOff;
+    errNum = MappedObjWriteAt(fP, &off, &(planes[0]),
+                              nPl * sizeof(MappedObjPlane));
+  }
+  if(gVWSp)
+  {
+    WlzGreyValueFreeWSp(gVWSp);
+  }
+  if(fP && (fclose(fP) != 0) && (errNum == WLZ_ERR_NONE))
+  {
+    errNum = WLZ_ERR_WRITE_INCOMPLETE;
+  }
+  return(errNum);
+}
+
+/*!
+* \return	Woolz error code.
+* \ingroup	WlzIIPServer
+* \brief	Writes a 3D domain object with its grey values in tiles.
+* 		Woolz maps tiled values when it reads them, so only the
+* 		tiles which are used become resident and they are shared
+* 		by all processes reading the file.
+* \param	name			File name.
+* \param	obj			Object to write, a 3D domain object
+* 					with grey values which are not
+* 					already tiled.
+*/
+WlzErrorNum			MappedObjWriteTiled(
+				  const char *name,
+				  WlzObject *obj)
+{
+  FILE		*fP = NULL;
+  WlzObject	*domObj = NULL,
+  		*outObj = NULL;
+  WlzGreyType	gType = WLZ_GREY_ERROR;
+  WlzPixelV	bgdV;
+  const size_t	tlSz = 4096;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  if(obj == NULL)
+  {
+    errNum = WLZ_ERR_OBJECT_NULL;
+  }
+  else if(obj->type != WLZ_3D_DOMAINOBJ)
+  {
+    errNum = WLZ_ERR_OBJECT_TYPE;
+  }
+  else if(obj->values.core == NULL)
+  {
+    errNum = WLZ_ERR_VALUES_NULL;
+  }
+  else if(WlzGreyTableIsTiled(obj->values.core->type))
+  {
+    errNum = WLZ_ERR_VALUES_TYPE;
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    gType = WlzGreyTypeFromObj(obj, &errNum);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    bgdV = WlzGetBackground(obj, &errNum);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    domObj = WlzMakeMain(obj->type, obj->domain, obj->values,
+			 NULL, NULL, &errNum);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    outObj = WlzMakeTiledValuesFromObj(domObj, tlSz, 1, gType, bgdV,
+				       &errNum);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    if((fP = fopen(name, "w")) == NULL)
+    {
+      errNum = WLZ_ERR_FILE_OPEN;
+    }
+    else
+    {
+      errNum = WlzWriteObj(fP, outObj);
+      if((fclose(fP) != 0) && (errNum == WLZ_ERR_NONE))
+      {
+	errNum = WLZ_ERR_WRITE_INCOMPLETE;
+      }
+    }
+  }
+  (void )WlzFreeObj(outObj);
+  (void )WlzFreeObj(domObj);
+  return(errNum);
+}
+
+/*!
+* \return	File name of the copy.
+* \ingroup	WlzIIPServer
+* \brief	Makes the name of a preprocessed copy of an object file,
+* 		which is named by a hash of the file name as it is opened
+* 		by the server. Used for both the mapped and tiled copies.
+* \param	dir			Directory of the copies.
+* \param	filename		Object file name.
+* \param	ext			File name extension of the copy.
+*/
+string				MappedObjCopyName(
+				  const string &dir,
+				  const string &filename,
+				  const char *ext)
+{
+  char		hStr[40];
+  unsigned long long h[2];
+
+  hash128(filename.data(), filename.length(), h);
+  (void )snprintf(hStr, 40, "%016llx%016llx", h[0], h[1]);
+  return(dir + "/" + hStr + ext);
+}
+
+/*!
+* \return	Offset rounded up to MAPPEDOBJ_ALIGN.
+* \ingroup	WlzIIPServer
+* \brief	Aligns a file offset.
+* \param	off			File offset.
+*/
+static unsigned long long	MappedObjAlign(
+				  unsigned long long off)
+{
+  return(((off + MAPPEDOBJ_ALIGN - 1) / MAPPEDOBJ_ALIGN) * MAPPEDOBJ_ALIGN);
+}
+
+/*!
+* \return	Woolz error code.
+* \ingroup	WlzIIPServer
+* \brief	Writes data at the given offset and sets the offset to the
+* 		aligned offset following the data.
+* \param	fP			File.
+* \param	off			Offset, updated on return.
+* \param	data			Data to write.
+* \param	size			Size of the data.
+*/
+static WlzErrorNum		MappedObjWriteAt(
+				  FILE *fP,
+				  unsigned long long *off,
+				  const void *data,
+				  size_t size)
+{
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  if((fseeko(fP, *off, SEEK_SET) != 0) ||
+     ((size > 0) && (fwrite(data, 1, size, fP) != size)))
+  {
+    errNum = WLZ_ERR_WRITE_INCOMPLETE;
+  }
+  *off = MappedObjAlign(*off + size);
+  return(errNum);
+}
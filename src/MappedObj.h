@@ -0,0 +1,76 @@
+#ifndef _MAPPEDOBJ_H
+#define _MAPPEDOBJ_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _MappedObj_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         MappedObj.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Flat, memory mappable files of 3D Woolz domain objects.
+* \ingroup	WlzIIPServer
+*/
+
+#include <string>
+#include <Wlz.h>
+
+/*!
+* \def		MAPPEDOBJ_EXT
+* \ingroup	WlzIIPServer
+* \brief	Extension of mapped object files.
+*/
+#define MAPPEDOBJ_EXT		".wlzm"
+
+/*!
+* \def		MAPPEDOBJ_TILED_EXT
+* \ingroup	WlzIIPServer
+* \brief	Extension of tiled object files, see MappedObjWriteTiled().
+*/
+#define MAPPEDOBJ_TILED_EXT	".wlz"
+
+extern WlzObject		*MappedObjRead(
+				  const char *name,
+				  WlzErrorNum *dstErr);
+extern WlzErrorNum		MappedObjWrite(
+				  const char *name,
+				  WlzObject *obj);
+extern WlzErrorNum		MappedObjWriteTiled(
+				  const char *name,
+				  WlzObject *obj);
+extern void			MappedObjRelease(void);
+extern std::string		MappedObjCopyName(
+				  const std::string &dir,
+				  const std::string &filename,
+				  const char *ext);
+
+#endif
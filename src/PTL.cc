@@ -61,6 +61,16 @@ void PTL::run( Session* session, std::string argument)
   delimitter = argument.find( "," );
   tile = atoi( argument.substr( delimitter + 1, argument.length() ).c_str() );
   session->viewParams->setAlpha(true);
+  // Answer revalidation before rendering anything
+  char params[128];
+  snprintf(params, 128, "PTL,%d,%d,%d,%d", resolution, tile,
+           session->view->xangle, session->view->yangle);
+  string etag = makeETag(session, params);
+  if(sendNotModified(session, etag))
+  {
+    LOG_INFO("PNG :: Total command time " << command_timer.getTime() << "us");
+    return;
+  }
   TileManager tilemanager(session->tileCache, *session->image, session->jpeg,
                           session->png);
   RawTile rawtile = tilemanager.getTile(resolution, tile,
@@ -74,11 +84,11 @@ void PTL::run( Session* session, std::string argument)
 
 #ifndef INFO
   char buf[1024];
-  snprintf( buf, 1024, "Pragma: no-cache\r\n"
+  snprintf( buf, 1024, "%s"
 	    "Content-length: %d\r\n"
 	    "Content-type: image/png\r\n"
 	    "Content-disposition: inline;filename=\"ptl.png\""
-	    "\r\n\r\n", len );
+	    "\r\n\r\n", cacheHeaders( etag ).c_str(), len );
   session->out->printf( (const char*) buf );
 #endif
   if(session->out->putStr((const char* )rawtile.data, len) != len){
@@ -91,6 +101,17 @@ void PTL::run( Session* session, std::string argument)
   }
   // Inform our response object that we have sent something to the client
   session->response->setImageSent();
+
+  // Queue the tiles the viewer is likely to want next
+  WlzImage *wlzImage = dynamic_cast<WlzImage *>(*session->image);
+  if(session->prefetcher && wlzImage)
+  {
+    session->prefetcher->prefetch(session->client, wlzImage,
+                                  session->viewParams, resolution, tile,
+				  session->view->xangle,
+				  session->view->yangle, PNG,
+				  session->jpeg->getQuality());
+  }
   // Total JTLS response time
   LOG_INFO("PNG :: Total command time " << command_timer.getTime() << "us");
 }
@@ -0,0 +1,367 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _ResponseCache_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         ResponseCache.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Cache of whole responses keyed by normalised query strings.
+* \ingroup	WlzIIPServer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+#include "ResponseCache.h"
+#include "Tokenizer.h"
+
+using namespace std;
+
+static bool			ResponseCacheIsSetter(
+				  const string &command);
+static bool			ResponseCacheLessCommand(
+				  const pair<string, string> &c0,
+				  const pair<string, string> &c1);
+static string			ResponseCacheNumbers(
+				  const string &argument);
+static string			ResponseCacheDecode(
+				  const string &argument);
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs an empty cache.
+* \param	maxMB			Maximum size in megabytes, the cache
+* 					is disabled if not positive.
+*/
+ResponseCache::ResponseCache(float maxMB)
+{
+  maxSize = (maxMB > 0.0f)? (size_t )(maxMB * 1024.0f * 1024.0f): 0;
+  size = 0;
+  pthread_mutex_init(&mutex, NULL);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Destroys the cache.
+*/
+ResponseCache::~ResponseCache()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+/*!
+* \return	Normalised query string or an empty string if the query
+* 		has no commands.
+* \ingroup	WlzIIPServer
+* \brief	Normalises a query string so that queries which give the
+* 		same response have the same key. Command names are made
+* 		lower case, as Task::factory() does, and arguments which
+* 		are comma separated lists of numbers are reformatted.
+* 		Runs of consecutive commands which only set parameters
+* 		(see ResponseCacheIsSetter()) are sorted by name, keeping
+* 		the order of repeated commands, since their order does not
+* 		matter. Other commands, such as those which open an object,
+* 		select compound object components or send a response, are
+* 		left in place.
+* \param	query			Query string.
+*/
+string		ResponseCache::normalise(const string &query)
+{
+  string	key;
+  vector<pair<string, string> > cmds;
+  Tokenizer	izer(query, "&");
+
+  while(izer.hasMoreTokens())
+  {
+    const string token = izer.nextToken();
+    const size_t n = token.find('=');
+
+    if((n == string::npos) || (n == 0) || (n + 1 == token.length()))
+    {
+      continue;
+    }
+    string	command = token.substr(0, n);
+
+    transform(command.begin(), command.end(), command.begin(), ::tolower);
+    cmds.push_back(make_pair(command,
+                             ResponseCacheNumbers(token.substr(n + 1))));
+  }
+  for(size_t i = 0; i < cmds.size(); )
+  {
+    size_t	j = i;
+
+    while((j < cmds.size()) && ResponseCacheIsSetter(cmds[j].first))
+    {
+      ++j;
+    }
+    if(j > i)
+    {
+      // Only the names are compared so repeated commands keep their order.
+      stable_sort(cmds.begin() + i, cmds.begin() + j,
+                  ResponseCacheLessCommand);
+      i = j;
+    }
+    else
+    {
+      ++i;
+    }
+  }
+  for(size_t i = 0; i < cmds.size(); ++i)
+  {
+    key += ((i == 0)? "": "&") + cmds[i].first + "=" + cmds[i].second;
+  }
+  return(key);
+}
+
+/*!
+* \return	Cache key or an empty string if the response can not be
+* 		cached.
+* \ingroup	WlzIIPServer
+* \brief	Makes the cache key of a query: its normalised form
+* 		followed by the modification time and size of each file
+* 		opened by its WLZ and FIF commands, so that a response is
+* 		not served once a file it was made from has changed. If a
+* 		file can not be found the query has no key.
+* \param	query			Query string.
+*/
+string		ResponseCache::key(const string &query)
+{
+  const string	norm = normalise(query);
+  string	key = norm;
+  size_t	b = 0;
+
+  while(!norm.empty() && (b < norm.size()))
+  {
+    size_t	e = norm.find('&', b);
+
+    if(e == string::npos)
+    {
+      e = norm.size();
+    }
+    if((norm.compare(b, 4, "wlz=") == 0) || (norm.compare(b, 4, "fif=") == 0))
+    {
+      char	buf[64];
+      struct stat st;
+      const string path = ResponseCacheDecode(norm.substr(b + 4, e - b - 4));
+
+      if(stat(path.c_str(), &st) != 0)
+      {
+	return(string());
+      }
+      snprintf(buf, 64, "\n%ld,%lld", (long )st.st_mtime,
+               (long long )st.st_size);
+      key += buf;
+    }
+    b = e + 1;
+  }
+  return(key);
+}
+
+/*!
+* \return	True if the response was found.
+* \ingroup	WlzIIPServer
+* \brief	Gets a copy of a cached response, which becomes the most
+* 		recently used.
+* \param	key			Normalised query string.
+* \param	data			Destination for the response.
+*/
+bool		ResponseCache::get(const string &key, string &data)
+{
+  bool		found = false;
+
+  pthread_mutex_lock(&mutex);
+  EntryMap::iterator it = index.find(key);
+  if(it != index.end())
+  {
+    entries.splice(entries.begin(), entries, it->second);
+    data = it->second->second;
+    found = true;
+  }
+  pthread_mutex_unlock(&mutex);
+  return(found);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Inserts a response, evicting the least recently used
+* 		responses to make room for it. Responses larger than
+* 		RESPONSECACHE_MAX_ENTRY or the cache are not inserted.
+* \param	key			Normalised query string.
+* \param	data			Response.
+*/
+void		ResponseCache::insert(const string &key, const string &data)
+{
+  const size_t	sz = key.size() + data.size();
+
+  if(key.empty() || (data.size() > RESPONSECACHE_MAX_ENTRY) ||
+     (sz > maxSize))
+  {
+    return;
+  }
+  pthread_mutex_lock(&mutex);
+  if(index.find(key) == index.end())
+  {
+    while(!entries.empty() && (size + sz > maxSize))
+    {
+      size -= entries.back().first.size() + entries.back().second.size();
+      index.erase(entries.back().first);
+      entries.pop_back();
+    }
+    entries.push_front(make_pair(key, data));
+    index[key] = entries.begin();
+    size += sz;
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \return	True if the command only sets a parameter.
+* \ingroup	WlzIIPServer
+* \brief	Checks whether a command only sets a view, rendering or
+* 		compression parameter, so that its order relative to other
+* 		such commands does not change the response. Each of these
+* 		commands sets state which no other command sets. PRL and
+* 		PAB are not included as both set the query point, the last
+* 		one given winning.
+* \param	command			Lower case command name.
+*/
+static bool	ResponseCacheIsSetter(const string &command)
+{
+  static const char *setters[] = {"cnt", "dst", "fxp", "fxt", "hei",
+  				  "map", "mod", "pit", "qlt", "rgn",
+				  "rmd", "rol", "scl", "sds", "shd",
+				  "upv", "wid", "yaw"};
+  const int	n = sizeof(setters) / sizeof(setters[0]);
+
+  for(int i = 0; i < n; ++i)
+  {
+    if(command == setters[i])
+    {
+      return(true);
+    }
+  }
+  return(false);
+}
+
+/*!
+* \return	True if the first command's name sorts before the second's.
+* \ingroup	WlzIIPServer
+* \brief	Orders commands by name.
+* \param	c0			First command and argument.
+* \param	c1			Second command and argument.
+*/
+static bool	ResponseCacheLessCommand(const pair<string, string> &c0,
+					 const pair<string, string> &c1)
+{
+  return(c0.first < c1.first);
+}
+
+/*!
+* \return	Normalised argument.
+* \ingroup	WlzIIPServer
+* \brief	Reformats an argument which is a comma separated list of
+* 		numbers, eg "0.50,+1,2.0" becomes "0.5,1,2". Numbers are
+* 		printed with 17 significant digits so that distinct
+* 		doubles are never given the same text. Other arguments,
+* 		including numbers with exponents which atoi() would parse
+* 		differently, are returned unchanged.
+* \param	argument		Argument.
+*/
+static string	ResponseCacheNumbers(const string &argument)
+{
+  size_t	b = 0;
+  string	norm;
+
+  if(argument.find_first_not_of("0123456789+-.,") != string::npos)
+  {
+    return(argument);
+  }
+  for(;;)
+  {
+    char	buf[64];
+    char	*end = NULL;
+    const size_t e = argument.find(',', b);
+    const string token = argument.substr(b, (e == string::npos)? e: e - b);
+    const double v = strtod(token.c_str(), &end);
+
+    if(token.empty() || (end == NULL) || (*end != '\0'))
+    {
+      return(argument);
+    }
+    // Avoid "-0".
+    snprintf(buf, 64, "%.17g", (v == 0.0)? 0.0: v);
+    norm += buf;
+    if(e == string::npos)
+    {
+      break;
+    }
+    norm += ",";
+    b = e + 1;
+  }
+  return(norm);
+}
+
+/*!
+* \return	Decoded argument.
+* \ingroup	WlzIIPServer
+* \brief	Decodes a URL encoded argument, eg a file path, as the WLZ
+* 		command does: '+' becomes a space and "%xx" the character
+* 		with hexadecimal code xx.
+* \param	argument		Argument.
+*/
+static string	ResponseCacheDecode(const string &argument)
+{
+  string	dec;
+
+  for(size_t i = 0; i < argument.size(); ++i)
+  {
+    if(argument[i] == '+')
+    {
+      dec += ' ';
+    }
+    else if(argument[i] == '%')
+    {
+      const string hex = argument.substr(i + 1, 2);
+
+      dec += (char )strtol(hex.c_str(), NULL, 16);
+      i += hex.size();
+    }
+    else
+    {
+      dec += argument[i];
+    }
+  }
+  return(dec);
+}
@@ -0,0 +1,89 @@
+#ifndef _RESPONSECACHE_H
+#define _RESPONSECACHE_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _ResponseCache_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         ResponseCache.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Cache of whole responses keyed by normalised query strings.
+* \ingroup	WlzIIPServer
+*/
+
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <string>
+
+/*!
+* \def		RESPONSECACHE_MAX_ENTRY
+* \ingroup	WlzIIPServer
+* \brief	Maximum size of a cached response.
+*/
+#define RESPONSECACHE_MAX_ENTRY	(1024 * 1024)
+
+/*!
+* \brief	A least recently used cache of the complete output of
+* 		successful requests (the CGI headers and body), keyed by
+* 		the normalised query string and the identity of the files
+* 		it opens, so that repeated requests are served without
+* 		parsing their commands or touching Woolz, but never from
+* 		a file which has since changed.
+* \ingroup	WlzIIPServer
+*/
+class ResponseCache
+{
+  private:
+    typedef std::list<std::pair<std::string, std::string> > EntryList;
+    typedef std::map<std::string, EntryList::iterator> EntryMap;
+
+    size_t		maxSize;		/*!< Maximum size in bytes. */
+    size_t		size;			/*!< Current size in bytes. */
+    EntryList		entries;		/*!< Keys and responses, most
+    						     recently used first. */
+    EntryMap		index;			/*!< Entries by key. */
+    pthread_mutex_t	mutex;			/*!< Protects the above. */
+
+  public:
+    ResponseCache(float maxMB);
+    ~ResponseCache();
+    bool		isValid() const {return(maxSize > 0);}
+    static std::string	normalise(const std::string &query);
+    static std::string	key(const std::string &query);
+    bool		get(const std::string &key, std::string &data);
+    void		insert(const std::string &key,
+    			       const std::string &data);
+};
+
+#endif
@@ -0,0 +1,463 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _SharedTileCache_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         SharedTileCache.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	A tile cache in POSIX shared memory which may be shared
+* 		by all the server processes on a host.
+* \ingroup	WlzIIPServer
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdlib>
+#include "Log.h"
+#include "SharedTileCache.h"
+
+/*!
+* \def		SHARED_TILE_CACHE_MAGIC
+* \ingroup	WlzIIPServer
+* \brief	Magic number set in the header once the shared memory has
+* 		been initialised.
+*/
+#define SHARED_TILE_CACHE_MAGIC		(0x57495443)
+
+/*!
+* \def		SHARED_TILE_CACHE_ALIGN
+* \ingroup	WlzIIPServer
+* \brief	Rounds the given size up to a multiple of 64 bytes.
+*/
+#define SHARED_TILE_CACHE_ALIGN(S)	(((S) + 63) & ~((size_t )63))
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructor for SharedTileCache. Attaches to the named
+* 		shared memory object, creating and initialising it if
+* 		it does not yet exist. If the shared memory can not be
+* 		used then the cache is left invalid and all calls to
+* 		insert() and getTile() do nothing.
+* \param	name			Name of the shared memory object,
+* 					eg "/wlziipsrv".
+* \param	maxSz			Size of the cache in MB, zero
+* 					disables the cache.
+* \param	slotSz			Maximum size in bytes of the data
+* 					of a tile held in the cache.
+* \param	generation		Generation of the tiles. If the cache
+* 					exists with another generation it is
+* 					emptied, so all the processes which
+* 					share a cache should be given the
+* 					same generation.
+*/
+SharedTileCache::
+SharedTileCache(const std::string &name, float maxSz, size_t slotSz,
+		unsigned long generation)
+{
+  int		fd = -1,
+		creator = 0;
+  unsigned int	i,
+		nSet = 0;
+  size_t	hdrSz,
+  		stripeSz,
+		totalSz = 0;
+
+  this->name = name;
+  mem = NULL;
+  header = NULL;
+  stripes = NULL;
+  slots = NULL;
+  slotStride = SHARED_TILE_CACHE_ALIGN(sizeof(SharedTileCacheSlot) + slotSz);
+  hdrSz = SHARED_TILE_CACHE_ALIGN(sizeof(SharedTileCacheHeader));
+  stripeSz = SHARED_TILE_CACHE_ALIGN(SHARED_TILE_CACHE_STRIPES *
+                                     sizeof(pthread_mutex_t));
+  if((maxSz > 0.0) && (slotSz > 0))
+  {
+    nSet = (unsigned int )((maxSz * 1024.0 * 1024.0) /
+                           (slotStride * SHARED_TILE_CACHE_WAYS));
+  }
+  if(nSet > 0)
+  {
+    totalSz = hdrSz + stripeSz + (nSet * SHARED_TILE_CACHE_WAYS * slotStride);
+    if((fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)) >= 0)
+    {
+      creator = 1;
+      if(ftruncate(fd, totalSz) != 0)
+      {
+	LOG_WARN("SharedTileCache failed to size shared memory " << name);
+	(void )close(fd);
+	(void )shm_unlink(name.c_str());
+        fd = -1;
+      }
+    }
+    else if(errno == EEXIST)
+    {
+      fd = shm_open(name.c_str(), O_RDWR, 0);
+    }
+  }
+  if(fd >= 0)
+  {
+    struct stat	st;
+
+    st.st_size = 0;
+    /* Another process may have created but not yet sized the shared
+     * memory. */
+    for(i = 0; i < 1000; ++i)
+    {
+      if((fstat(fd, &st) != 0) || (st.st_size != 0))
+      {
+        break;
+      }
+      (void )usleep(1000);
+    }
+    if((size_t )(st.st_size) == totalSz)
+    {
+      mem = mmap(NULL, totalSz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if(mem == MAP_FAILED)
+      {
+        mem = NULL;
+      }
+    }
+    (void )close(fd);
+  }
+  if(mem)
+  {
+    header = (SharedTileCacheHeader *)mem;
+    stripes = (pthread_mutex_t *)((char *)mem + hdrSz);
+    slots = (char *)mem + hdrSz + stripeSz;
+    if(creator)
+    {
+      pthread_mutexattr_t attr;
+
+      (void )pthread_mutexattr_init(&attr);
+      (void )pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+      (void )pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+      for(i = 0; i < SHARED_TILE_CACHE_STRIPES; ++i)
+      {
+        (void )pthread_mutex_init(stripes + i, &attr);
+      }
+      (void )pthread_mutexattr_destroy(&attr);
+      header->nSet = nSet;
+      header->nWay = SHARED_TILE_CACHE_WAYS;
+      header->nStripe = SHARED_TILE_CACHE_STRIPES;
+      header->slotSz = slotSz;
+      header->totalSz = totalSz;
+      header->generation = generation;
+      header->stamp = 0;
+      __sync_synchronize();
+      header->magic = SHARED_TILE_CACHE_MAGIC;
+    }
+    else
+    {
+      for(i = 0; i < 1000; ++i)
+      {
+	__sync_synchronize();
+        if(header->magic == SHARED_TILE_CACHE_MAGIC)
+	{
+	  break;
+	}
+	(void )usleep(1000);
+      }
+    }
+    if((header->magic != SHARED_TILE_CACHE_MAGIC) ||
+       (header->nSet != nSet) ||
+       (header->nWay != SHARED_TILE_CACHE_WAYS) ||
+       (header->nStripe != SHARED_TILE_CACHE_STRIPES) ||
+       (header->slotSz != slotSz) ||
+       (header->totalSz != totalSz))
+    {
+      (void )munmap(mem, totalSz);
+      mem = NULL;
+      header = NULL;
+    }
+    else if(header->generation != generation)
+    {
+      LOG_NOTICE("SharedTileCache emptying " << name << " of generation " <<
+                 header->generation << " for generation " << generation);
+      clear();
+      header->generation = generation;
+    }
+  }
+  if(mem)
+  {
+    LOG_NOTICE("SharedTileCache " << ((creator)? "created": "attached to") <<
+               " " << name << " with " << nSet * SHARED_TILE_CACHE_WAYS <<
+	       " slots of " << slotSz << " bytes");
+  }
+  else if(nSet > 0)
+  {
+    LOG_WARN("SharedTileCache unable to use shared memory " << name <<
+             ", a stale object with different parameters may need to be" <<
+	     " removed");
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Destructor for SharedTileCache. The shared memory is
+* 		unmapped but not unlinked as it may be in use by other
+* 		processes.
+*/
+SharedTileCache::
+~SharedTileCache()
+{
+  if(mem)
+  {
+    (void )munmap(mem, header->totalSz);
+  }
+}
+
+/*!
+* \return	Non zero if the shared memory is mapped and usable.
+* \ingroup	WlzIIPServer
+* \brief	Checks whether the cache may be used.
+*/
+bool		SharedTileCache::
+		isValid()
+{
+  return(mem != NULL);
+}
+
+/*!
+* \return	Pointer to the slot.
+* \ingroup	WlzIIPServer
+* \brief	Gets a slot of a set.
+* \param	set			Set index.
+* \param	way			Slot index within the set.
+*/
+SharedTileCacheSlot *SharedTileCache::
+		getSlot(unsigned int set, unsigned int way)
+{
+  return((SharedTileCacheSlot *)
+         (slots + (((size_t )set * header->nWay) + way) * slotStride));
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Locks the stripe of the given set. If a process died
+* 		while holding the lock all sets of the stripe are
+* 		emptied since they may be inconsistent.
+* \param	set			Set index.
+*/
+void		SharedTileCache::
+		lockSet(unsigned int set)
+{
+  unsigned int	stripe = set % header->nStripe;
+
+  if(pthread_mutex_lock(stripes + stripe) == EOWNERDEAD)
+  {
+    unsigned int s,
+    		 w;
+
+    LOG_WARN("SharedTileCache recovering lock " << stripe <<
+             " of a dead process");
+    for(s = stripe; s < header->nSet; s += header->nStripe)
+    {
+      for(w = 0; w < header->nWay; ++w)
+      {
+        getSlot(s, w)->used = 0;
+      }
+    }
+    (void )pthread_mutex_consistent(stripes + stripe);
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Empties every set of the cache, locking one stripe at
+* 		a time.
+*/
+void		SharedTileCache::
+		clear()
+{
+  unsigned int	s,
+		stripe,
+		w;
+
+  for(stripe = 0; stripe < header->nStripe; ++stripe)
+  {
+    lockSet(stripe);
+    for(s = stripe; s < header->nSet; s += header->nStripe)
+    {
+      for(w = 0; w < header->nWay; ++w)
+      {
+        getSlot(s, w)->used = 0;
+      }
+    }
+    unlockSet(stripe);
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Unlocks the stripe of the given set.
+* \param	set			Set index.
+*/
+void		SharedTileCache::
+		unlockSet(unsigned int set)
+{
+  (void )pthread_mutex_unlock(stripes + (set % header->nStripe));
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Inserts a copy of the given tile into the cache replacing
+* 		the least recently used slot of its set. Tiles with data
+* 		which is too large for a slot are not inserted.
+* \param	key			Key built by Cache::getIndex().
+* \param	tile			Given tile.
+*/
+void		SharedTileCache::
+		insert(const CacheKey &key, const RawTile &tile)
+{
+  if(mem && tile.data && (tile.dataLength > 0) &&
+     ((size_t )(tile.dataLength) <= header->slotSz))
+  {
+    unsigned int w,
+    		 set;
+    SharedTileCacheSlot *slot,
+    		 *victim = NULL;
+
+    set = (unsigned int )(key.hash() % header->nSet);
+    lockSet(set);
+    for(w = 0; w < header->nWay; ++w)
+    {
+      slot = getSlot(set, w);
+      if(slot->used == 0)
+      {
+        if((victim == NULL) || victim->used)
+	{
+	  victim = slot;
+	}
+      }
+      else if(slot->key == key)
+      {
+	/* Already in the cache. */
+	slot->stamp = __sync_add_and_fetch(&(header->stamp), 1);
+	victim = NULL;
+	break;
+      }
+      else if((victim == NULL) ||
+              (victim->used && (slot->stamp < victim->stamp)))
+      {
+        victim = slot;
+      }
+    }
+    if(victim)
+    {
+      victim->used = 0;
+      victim->key = key;
+      victim->tileNum = tile.tileNum;
+      victim->resolution = tile.resolution;
+      victim->hSequence = tile.hSequence;
+      victim->vSequence = tile.vSequence;
+      victim->compressionType = tile.compressionType;
+      victim->quality = tile.quality;
+      victim->dataLength = tile.dataLength;
+      victim->width = tile.width;
+      victim->height = tile.height;
+      victim->channels = tile.channels;
+      victim->bpc = tile.bpc;
+      victim->widthPadding = tile.width_padding;
+      (void )memcpy(victim + 1, tile.data, tile.dataLength);
+      victim->stamp = __sync_add_and_fetch(&(header->stamp), 1);
+      victim->used = 1;
+    }
+    unlockSet(set);
+  }
+}
+
+/*!
+* \return	The given tile or NULL if the key is not in the cache.
+* \ingroup	WlzIIPServer
+* \brief	Copies a cached tile into the given tile. The filename of
+* 		the tile is not set.
+* \param	key			Key built by Cache::getIndex().
+* \param	dst			Default constructed tile to hold
+* 					the copy.
+*/
+RawTile		*SharedTileCache::
+		getTile(const CacheKey &key, RawTile *dst)
+{
+  RawTile	*tile = NULL;
+
+  if(mem)
+  {
+    unsigned int w,
+    		 set;
+    SharedTileCacheSlot *slot;
+
+    set = (unsigned int )(key.hash() % header->nSet);
+    lockSet(set);
+    for(w = 0; w < header->nWay; ++w)
+    {
+      slot = getSlot(set, w);
+      if(slot->used && (slot->key == key))
+      {
+	void	*data;
+
+	if((data = malloc(slot->dataLength)) != NULL)
+	{
+	  (void )memcpy(data, slot + 1, slot->dataLength);
+	  if(dst->data && dst->localData)
+	  {
+	    free(dst->data);
+	  }
+	  dst->data = data;
+	  dst->localData = 1;
+	  dst->dataLength = slot->dataLength;
+	  dst->tileNum = slot->tileNum;
+	  dst->resolution = slot->resolution;
+	  dst->hSequence = slot->hSequence;
+	  dst->vSequence = slot->vSequence;
+	  dst->compressionType = (CompressionType )(slot->compressionType);
+	  dst->quality = slot->quality;
+	  dst->width = slot->width;
+	  dst->height = slot->height;
+	  dst->channels = slot->channels;
+	  dst->bpc = slot->bpc;
+	  dst->width_padding = slot->widthPadding;
+	  slot->stamp = __sync_add_and_fetch(&(header->stamp), 1);
+	  tile = dst;
+	}
+	break;
+      }
+    }
+    unlockSet(set);
+  }
+  return(tile);
+}
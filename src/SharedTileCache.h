@@ -0,0 +1,155 @@
+#ifndef _SHAREDTILECACHE_H
+#define _SHAREDTILECACHE_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _SharedTileCache_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         SharedTileCache.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	A tile cache in POSIX shared memory which may be shared
+* 		by all the server processes on a host.
+* \ingroup	WlzIIPServer
+*/
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <string>
+#include "RawTile.h"
+#include "CacheKey.h"
+
+/*!
+* \def		SHARED_TILE_CACHE_WAYS
+* \ingroup	WlzIIPServer
+* \brief	Number of slots in each set of the shared tile cache.
+*/
+#define SHARED_TILE_CACHE_WAYS		(4)
+
+/*!
+* \def		SHARED_TILE_CACHE_STRIPES
+* \ingroup	WlzIIPServer
+* \brief	Number of mutexes used to lock the sets of the shared
+* 		tile cache.
+*/
+#define SHARED_TILE_CACHE_STRIPES	(64)
+
+/*!
+* \struct	_SharedTileCacheHeader
+* \ingroup	WlzIIPServer
+* \brief	Header at the start of the shared tile cache memory.
+* 		Typedef: SharedTileCacheHeader.
+*/
+typedef struct _SharedTileCacheHeader
+{
+  unsigned int		magic;		/*!< Set once the cache has been
+  					     initialised. */
+  unsigned int		nSet;		/*!< Number of sets. */
+  unsigned int		nWay;		/*!< Number of slots per set. */
+  unsigned int		nStripe;	/*!< Number of lock stripes. */
+  size_t		slotSz;		/*!< Maximum tile data size. */
+  size_t		totalSz;	/*!< Total size of the mapped memory. */
+  volatile unsigned long generation;	/*!< Generation of the tiles, the
+  					     cache is emptied when a process
+					     with another generation
+					     attaches. */
+  volatile unsigned long stamp;		/*!< Access stamp, incremented on
+  					     every access. */
+} SharedTileCacheHeader;
+
+/*!
+* \struct	_SharedTileCacheSlot
+* \ingroup	WlzIIPServer
+* \brief	A single tile slot within the shared tile cache, the tile
+* 		data immediately follows the slot.
+* 		Typedef: SharedTileCacheSlot.
+*/
+typedef struct _SharedTileCacheSlot
+{
+  CacheKey		key;		/*!< The key. */
+  unsigned long		stamp;		/*!< Access stamp of last use. */
+  int			used;		/*!< Non zero if slot holds a tile. */
+  int			tileNum;	/*!< Tile number. */
+  int			resolution;	/*!< Resolution number. */
+  int			hSequence;	/*!< Horizontal sequence number. */
+  int			vSequence;	/*!< Vertical sequence number. */
+  int			compressionType; /*!< Compression type. */
+  int			quality;	/*!< Compression quality. */
+  int			dataLength;	/*!< Length of the tile data. */
+  unsigned int		width;		/*!< Tile width. */
+  unsigned int		height;		/*!< Tile height. */
+  int			channels;	/*!< Number of channels. */
+  int			bpc;		/*!< Bits per channel. */
+  unsigned int		widthPadding;	/*!< Ignored width padding. */
+} SharedTileCacheSlot;
+
+/*!
+* \brief        Set associative tile cache held in a POSIX shared memory
+* 		object so that tiles rendered by one server process may
+* 		be served by any other on the same host. Tiles are keyed
+* 		by the CacheKey built by Cache::getIndex(). Each set is
+* 		guarded by one of a small number of process shared, robust
+* 		mutexes and the least recently used slot of a set is
+* 		replaced on insertion. The shared memory outlives the
+* 		server processes, but tiles are not served from a
+* 		previous generation: the image hashes in the keys change
+* 		with the modification time and size of the image files
+* 		and the whole cache is emptied when a process with a new
+* 		generation attaches.
+* \ingroup      WlzIIPServer
+*/
+class SharedTileCache
+{
+  private:
+    std::string		name;			/*!< Shared memory object
+    						     name. */
+    void		*mem;			/*!< Mapped shared memory. */
+    SharedTileCacheHeader *header;		/*!< Cache header. */
+    pthread_mutex_t	*stripes;		/*!< Set lock stripes. */
+    char		*slots;			/*!< Base of the slots. */
+    size_t		slotStride;		/*!< Bytes per slot including
+    						     the tile data. */
+    SharedTileCacheSlot	*getSlot(unsigned int set, unsigned int way);
+    void		lockSet(unsigned int set);
+    void		unlockSet(unsigned int set);
+    void		clear();
+
+  public:
+    SharedTileCache(const std::string &name, float maxSz, size_t slotSz,
+    		    unsigned long generation = 0);
+    ~SharedTileCache();
+    bool		isValid();
+    void		insert(const CacheKey &key, const RawTile &tile);
+    RawTile		*getTile(const CacheKey &key, RawTile *dst);
+};
+
+#endif
@@ -0,0 +1,172 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _SingleFlight_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         SingleFlight.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Coalescing of concurrent loads and renders of the same item.
+* \ingroup	WlzIIPServer
+*/
+
+#include "SingleFlight.h"
+
+using namespace std;
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs an empty table of flights.
+*/
+SingleFlight::SingleFlight()
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Destroys the table. There must be no flights.
+*/
+SingleFlight::~SingleFlight()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+/*!
+* \return	True if the caller must make the item, false if another
+* 		thread was making it and it has now landed.
+* \ingroup	WlzIIPServer
+* \brief	Begins a flight for the given key unless one is already in
+* 		flight, in which case the caller waits for it to land.
+* 		A caller which begins a flight must end it.
+* \param	key			Key of the item.
+*/
+bool		SingleFlight::begin(const string &key)
+{
+  bool		leader = false;
+
+  pthread_mutex_lock(&mutex);
+  FlightMap::iterator it = flights.find(key);
+  if(it == flights.end())
+  {
+    Flight	*flight = new Flight;
+
+    pthread_cond_init(&(flight->cond), NULL);
+    flight->waiters = 0;
+    flight->landed = false;
+    flights.insert(make_pair(key, flight));
+    leader = true;
+  }
+  else
+  {
+    Flight	*flight = it->second;
+
+    ++(flight->waiters);
+    while(!flight->landed)
+    {
+      pthread_cond_wait(&(flight->cond), &mutex);
+    }
+    --(flight->waiters);
+    release(flight);
+  }
+  pthread_mutex_unlock(&mutex);
+  return(leader);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Ends the flight for the given key, waking the threads which
+* 		are waiting for it.
+* \param	key			Key of the item.
+*/
+void		SingleFlight::end(const string &key)
+{
+  pthread_mutex_lock(&mutex);
+  FlightMap::iterator it = flights.find(key);
+  if(it != flights.end())
+  {
+    Flight	*flight = it->second;
+
+    flights.erase(it);
+    flight->landed = true;
+    pthread_cond_broadcast(&(flight->cond));
+    release(flight);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Frees a landed flight once no thread is waiting for it.
+* 		The mutex must be locked.
+* \param	flight			Flight.
+*/
+void		SingleFlight::release(Flight *flight)
+{
+  if(flight->landed && (flight->waiters == 0))
+  {
+    pthread_cond_destroy(&(flight->cond));
+    delete flight;
+  }
+}
+
+/*!
+* \return	True if the caller must make the item, false if another
+* 		thread was making it and it has now landed.
+* \ingroup	WlzIIPServer
+* \brief	Begins a flight as SingleFlight::begin(), ending any flight
+* 		previously begun through the guard.
+* \param	key			Key of the item.
+*/
+bool		SingleFlight::Guard::begin(const string &key)
+{
+  end();
+  if(table.begin(key))
+  {
+    this->key = key;
+    leader = true;
+  }
+  return(leader);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Ends the flight begun through the guard, if any.
+*/
+void		SingleFlight::Guard::end()
+{
+  if(leader)
+  {
+    leader = false;
+    table.end(key);
+  }
+}
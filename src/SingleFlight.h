@@ -0,0 +1,118 @@
+#ifndef _SINGLEFLIGHT_H
+#define _SINGLEFLIGHT_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _SingleFlight_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         SingleFlight.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Coalescing of concurrent loads and renders of the same item.
+* \ingroup	WlzIIPServer
+*/
+
+#include <pthread.h>
+#include <map>
+#include <string>
+
+/*!
+* \brief	A table of the keys of items which are being loaded or
+* 		rendered, so that only one thread loads or renders an
+* 		item at a time. A thread which finds the item it wants
+* 		in flight waits for it to land and then looks for it in
+* 		the cache again, rather than making its own copy.
+* 		Typical use is:
+* \verbatim
+  SingleFlight::Guard flight(flights);
+  while(((item = cache.get(key)) == NULL) && !flight.begin(key))
+  {
+  }
+  if(item == NULL)
+  {
+    // Make the item and insert it into the cache. The flight ends when
+    // the guard is destroyed.
+  }
+\endverbatim
+* 		If the item could not be cached the waiting threads take
+* 		turns to make it.
+* \ingroup	WlzIIPServer
+*/
+class SingleFlight
+{
+  private:
+    /*!
+    * \brief	An item in flight.
+    * \ingroup	WlzIIPServer
+    */
+    struct Flight
+    {
+      pthread_cond_t	cond;			/*!< Signalled on landing. */
+      int		waiters;		/*!< Number of threads
+      						     waiting. */
+      bool		landed;			/*!< Set on landing. */
+    };
+    typedef std::map<std::string, Flight *> FlightMap;
+
+    FlightMap		flights;		/*!< Items in flight. */
+    pthread_mutex_t	mutex;			/*!< Protects the flights. */
+    void		release(Flight *flight);
+
+  public:
+    /*!
+    * \brief	Ends the flight it began, if any, when destroyed so that
+    * 		waiting threads are released even if an exception is
+    * 		thrown.
+    * \ingroup	WlzIIPServer
+    */
+    class Guard
+    {
+      private:
+        SingleFlight	&table;			/*!< Table of flights. */
+	std::string	key;			/*!< Key of the flight begun. */
+	bool		leader;			/*!< True if a flight was
+						     begun. */
+
+      public:
+        Guard(SingleFlight &table): table(table), leader(false) {}
+	~Guard() {end();}
+	bool		begin(const std::string &key);
+	void		end();
+    };
+
+    SingleFlight();
+    ~SingleFlight();
+    bool		begin(const std::string &key);
+    void		end(const std::string &key);
+};
+
+#endif
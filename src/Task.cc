@@ -44,6 +44,9 @@ static char _Task_cc[] = "University of Edinburgh $Id$";
 #include "Log.h"
 #include "Task.h"
 #include "Tokenizer.h"
+#include "Environment.h"
+#include "CacheKey.h"
+#include <sys/stat.h>
 #include <iostream>
 #include <algorithm>
 
@@ -86,6 +89,9 @@ Task* Task::factory(std::string type)
   else if( type == "pab" ) return new PAB; // Sets a 3D point
   else if( type == "scl" ) return new SCL; // Sets scale
   else if( type == "ptl" ) return new PTL; // PNG tile request, equivalent to JTL
+  else if( type == "jtlb" ) return new JTLB; // Batch JPEG tile request
+  else if( type == "ptlb" ) return new PTLB; // Batch PNG tile request
+  else if( type == "vtl" ) return new VTL; // Grey value tile request
   else if( type == "sel" ) return new SEL; // Selection command for compound objects
   else if( type == "map" ) return new MAP; // Map image values
   else return NULL;
@@ -115,6 +121,57 @@ void Task::openIfWoolz(){
   }
 }
 
+std::string Task::makeETag( Session* session, const std::string& params ){
+  char tag[40];
+  unsigned long long h[2];
+  struct stat st;
+  IIPImage* image = *session->image;
+  string id = image->getHash() + "\n" + params;
+
+  // The object's identity, so that the tag changes when its file does
+  if( stat( image->getImagePath().c_str(), &st ) == 0 ){
+    char buf[64];
+    snprintf( buf, 64, "\n%ld,%lld", (long) st.st_mtime,
+	      (long long) st.st_size );
+    id += buf;
+  }
+  hash128( id.data(), id.length(), h );
+  snprintf( tag, 40, "\"%016llx%016llx\"", h[0], h[1] );
+  return string( tag );
+}
+
+
+bool Task::matchETag( const std::string& ifNoneMatch, const std::string& etag ){
+  // Weak comparison, so W/ prefixes are ignored
+  if( ifNoneMatch.find_first_not_of( " \t" ) == string::npos ) return false;
+  if( ifNoneMatch.find( '*' ) != string::npos ) return true;
+  return ifNoneMatch.find( etag ) != string::npos;
+}
+
+
+std::string Task::cacheHeaders( const std::string& etag ){
+  char buf[128];
+  snprintf( buf, 128, "ETag: %s\r\n"
+	    "Cache-Control: public, max-age=%d\r\n",
+	    etag.c_str(), Environment::getCacheMaxAge() );
+  return string( buf );
+}
+
+
+bool Task::sendNotModified( Session* session, const std::string& etag ){
+  if( !matchETag( session->ifNoneMatch, etag ) ) return false;
+  LOG_INFO("Task :: Not modified " << etag);
+  string hdr = "Status: 304 Not Modified\r\n" + cacheHeaders( etag ) + "\r\n";
+  session->out->putS( hdr.c_str() );
+  if( session->out->flush() == -1 ){
+    LOG_ERROR("Task :: Error flushing not modified response");
+  }
+  session->response->setImageSent();
+  session->notModified = true;
+  return true;
+}
+
+
 void QLT::run( Session* session, std::string argument ){
   if( argument.length() ){
 
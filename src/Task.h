@@ -44,7 +44,9 @@ static char _Task_h[] = "University of Edinburgh $Id$";
 */
 
 #include <string>
+#include <vector>
 #include <fstream>
+#include <pthread.h>
 #include "IIPImage.h"
 #include "IIPResponse.h"
 #include "JPEGCompressor.h"
@@ -53,6 +55,7 @@ static char _Task_h[] = "University of Edinburgh $Id$";
 #include "Timer.h"
 #include "Writer.h"
 #include "Cache.h"
+#include "TilePrefetcher.h"
 
 #include "ViewParameters.h"
 #include "WlzImage.h"
@@ -106,14 +109,22 @@ struct Session {
   imageCacheMapType *imageCache;
   Cache* tileCache;
 
+  /// optional background tile prefetcher, may be NULL
+  TilePrefetcher* prefetcher;
+
+  /// client address used to identify prefetching sessions
+  std::string client;
+
+  /// entity tags from the request's If-None-Match header, may be empty
+  std::string ifNoneMatch;
+
+  /// set if a 304 Not Modified response was sent, which must not be cached
+  bool notModified;
+
   /// sectioning parameters for a Woolz object
   ViewParameters *viewParams;
 
-#ifdef DEBUG
-  FileWriter* out;
-#else
-  FCGIWriter* out;
-#endif
+  Writer* out;
 
 };
 
@@ -141,7 +152,7 @@ class Task {
   virtual ~Task() {;};   
 
   /// Main public function
-  virtual void run( Session* session, std::string argument ) {;};
+  virtual void run( Session*, std::string ) {;};
 
   /// Factory function
   /** @param type command type */
@@ -156,6 +167,35 @@ class Task {
 
   /// Open if the object is Woolz
   void openIfWoolz();
+
+  /// Make a strong entity tag for a response rendered from the session's image
+  /** The tag is a hash of the image's file name, modification time and size,
+      its hash (which identifies the view and selection) and the given
+      description of everything else the response depends on.
+      @param session session of the request
+      @param params response parameters, eg the command, tile and quality
+      @return quoted entity tag
+   */
+  static std::string makeETag( Session* session, const std::string& params );
+
+  /// Send a 304 Not Modified response if the client already has the response
+  /** @param session session of the request
+      @param etag entity tag of the response
+      @return true if the response was sent
+   */
+  static bool sendNotModified( Session* session, const std::string& etag );
+
+  /// Get the ETag and Cache-Control headers for a response
+  /** @param etag entity tag of the response
+      @return header lines
+   */
+  static std::string cacheHeaders( const std::string& etag );
+
+  /// Check whether an If-None-Match header matches an entity tag
+  /** @param ifNoneMatch If-None-Match header value
+      @param etag entity tag
+   */
+  static bool matchETag( const std::string& ifNoneMatch, const std::string& etag );
 };
 
 
@@ -295,6 +335,42 @@ class JTL : public Task {
 };
 
 
+/// Batch JPEG Tile Command
+/** Sends many tiles of one resolution in a single multipart/mixed
+    response, rendering them in parallel where OpenMP is available.
+ */
+class JTLB : public Task {
+ protected:
+  /// compression type of the tiles
+  CompressionType type;
+
+  /// Send a tile, or the reason it could not be rendered, as a part
+  void sendPart( int resolution, int tile, const RawTile* rawtile,
+		 const std::string& error );
+
+ public:
+  JTLB() : type( JPEG ) {};
+  void run( Session* session, std::string argument );
+};
+
+
+/// Batch PNG Tile Command, equivalent to JTLB
+class PTLB : public JTLB {
+ public:
+  PTLB() { type = PNG; };
+};
+
+
+/// Grey Value Tile Command
+/** Sends the values of a tile in their own type, without conversion to RGB,
+    for clients which apply their own colour maps.
+ */
+class VTL : public Task {
+ public:
+  void run( Session* session, std::string argument );
+};
+
+
 /// JPEG Tile Sequence Command
 class JTLS : public Task {
  public:
@@ -311,6 +387,42 @@ class TIL : public Task {
 
 /// CVT Command
 class CVT : public Task {
+
+ private:
+
+  /// Requested resolution and tile layout of the view port
+  int resolution;
+  unsigned int ntlx, startx, endx, starty, endy, xoffset, yoffset;
+  unsigned int view_left, view_top, view_width, view_height;
+  unsigned int basic_tile_width, channels;
+  CompressionType requestType;
+
+  /// Rendered tiles of the view port in raster order
+  std::vector<RawTile*> tiles;
+
+  /// Number of rendered tiles in each strip
+  std::vector<unsigned int> stripDone;
+
+  /// Lock and condition for tiles and stripDone
+  pthread_mutex_t stripMutex;
+  pthread_cond_t stripCond;
+
+  /// First error thrown while rendering a tile
+  std::string error;
+
+  /// Render a single tile of the view port
+  void renderTile( unsigned int k );
+
+  /// Compress and send the strips of the view port in order
+  void sendStrips( bool wait, RawTile& complete_image, unsigned char* bufDest );
+
+  /// Render the strips of a Woolz view port straight into the strip buffer,
+  /// then compress and send them in order
+  void sendRegionStrips( WlzImage* image, RawTile& complete_image, unsigned char* bufDest );
+
+  /// Compress and send a single strip
+  void sendStrip( RawTile& complete_image, unsigned char* bufDest, unsigned int height );
+
  public:
   void run( Session* session, std::string argument );
 };
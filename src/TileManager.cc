@@ -41,11 +41,21 @@ static char _TileManager_cc[] = "University of Edinburgh $Id$";
 * \ingroup	WlzIIPServer
 */
 
+#include <zlib.h>
 #include "Log.h"
 #include "TileManager.h"
+#include "ValueTile.h"
 
 using namespace std;
 
+/// Maximum number of distinct empty tiles kept
+#define MAX_EMPTY_TILES 64
+
+map<string, RawTile> TileManager::emptyTiles;
+list<string> TileManager::emptyTileKeys;
+pthread_mutex_t TileManager::emptyTilesMutex = PTHREAD_MUTEX_INITIALIZER;
+SingleFlight TileManager::renderFlights;
+
 RawTile TileManager::getNewTile(int resolution, int tile,
                                 int xangle, int yangle, CompressionType c){
   LOG_INFO("TileManager :: Cache Miss for resolution: " << resolution <<
@@ -55,8 +65,17 @@ RawTile TileManager::getNewTile(int resolution, int tile,
 	    tileCache->getMemorySize() << "MB");
 
   RawTile ttt;
+  unsigned char bg[4] = { 0, 0, 0, 0 };
   int len = 0;
 
+  // Tiles which only contain the background don't need to be rendered,
+  // compressed or cached
+  if( (c == JPEG || c == PNG) &&
+      image->isEmptyTile( xangle, yangle, resolution, tile, ttt, bg ) ){
+    this->getEmptyTile( ttt, bg, c );
+    return ttt;
+  }
+
   // Get our raw tile
   ttt = image->getTile( xangle, yangle, resolution, tile);
 
@@ -124,6 +143,70 @@ RawTile TileManager::getNewTile(int resolution, int tile,
 
 
 
+void TileManager::getEmptyTile( RawTile& ttt, const unsigned char *bg,
+				CompressionType c ){
+
+  char key[128];
+  snprintf( key, 128, "%dx%dx%d:%02x%02x%02x%02x:%d:%d",
+	    ttt.width, ttt.height, ttt.channels,
+	    bg[0], (ttt.channels > 1)? bg[1]: 0, (ttt.channels > 2)? bg[2]: 0,
+	    (ttt.channels > 3)? bg[3]: 0,
+	    (int) c, (c == JPEG)? jpeg->getQuality(): 0 );
+
+  pthread_mutex_lock( &emptyTilesMutex );
+  map<string, RawTile>::iterator it = emptyTiles.find( key );
+  if( it != emptyTiles.end() ){
+    const RawTile &empty = it->second;
+    ttt.data = malloc( empty.dataLength );
+    if( ttt.data ) memcpy( ttt.data, empty.data, empty.dataLength );
+    ttt.dataLength = ttt.data? empty.dataLength: 0;
+    ttt.localData = 1;
+    ttt.compressionType = empty.compressionType;
+    ttt.quality = empty.quality;
+    pthread_mutex_unlock( &emptyTilesMutex );
+    LOG_INFO("TileManager :: Empty tile: " << key);
+    return;
+  }
+  pthread_mutex_unlock( &emptyTilesMutex );
+
+  // Fill the tile with the background and compress it
+  int n = ttt.width * ttt.height;
+  ttt.data = malloc( n * ttt.channels );
+  if( ttt.data == NULL ){
+    throw string( "TileManager :: Unable to allocate empty tile" );
+  }
+  ttt.localData = 1;
+  ttt.dataLength = n * ttt.channels;
+  for( int i = 0; i < n; i++ ){
+    memcpy( (unsigned char*) ttt.data + i * ttt.channels, bg, ttt.channels );
+  }
+  LOG_COND_INFO(compression_timer.start());
+  if( c == JPEG ){
+    jpeg->Compress( ttt );
+    ttt.compressionType = JPEG;
+  }
+  else{
+    png->Compress( ttt );
+    ttt.compressionType = PNG;
+  }
+  LOG_INFO("TileManager :: Empty tile compression time: " <<
+	    compression_timer.getTime() << "us");
+
+  // Replace the oldest empty tile once the table is full
+  pthread_mutex_lock( &emptyTilesMutex );
+  if( emptyTiles.find( key ) == emptyTiles.end() ){
+    if( emptyTiles.size() >= MAX_EMPTY_TILES ){
+      emptyTiles.erase( emptyTileKeys.front() );
+      emptyTileKeys.pop_front();
+    }
+    emptyTiles.insert( make_pair( string( key ), ttt ) );
+    emptyTileKeys.push_back( key );
+  }
+  pthread_mutex_unlock( &emptyTilesMutex );
+}
+
+
+
 void TileManager::crop( RawTile *ttt ){
 
   //Wlz the data has already the correct length, crop is not needed
@@ -165,6 +248,7 @@ void TileManager::crop( RawTile *ttt ){
 RawTile TileManager::getTile( int resolution, int tile, int xangle, int yangle, CompressionType c ){
 
   RawTile* rawtile = NULL;
+  RawTile cachedTile;
   string tileCompression;
   string compName;
 
@@ -180,35 +264,44 @@ RawTile TileManager::getTile( int resolution, int tile, int xangle, int yangle,
 
     case JPEG:
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					  xangle, yangle, JPEG, jpeg->getQuality() )) ) break;
+					  xangle, yangle, JPEG, jpeg->getQuality(),
+					 &cachedTile )) ) break;
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, DEFLATE, 0 )) ) break;
+					 xangle, yangle, DEFLATE, 0,
+					 &cachedTile )) ) break;
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, UNCOMPRESSED, 0 )) ) break;
+					 xangle, yangle, UNCOMPRESSED, 0,
+					 &cachedTile )) ) break;
       break;
 
     case PNG:
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					  xangle, yangle, PNG, 100 )) ) break;
+					  xangle, yangle, PNG, 100,
+					 &cachedTile )) ) break;
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, DEFLATE, 0 )) ) break;
+					 xangle, yangle, DEFLATE, 0,
+					 &cachedTile )) ) break;
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, UNCOMPRESSED, 0 )) ) break;
+					 xangle, yangle, UNCOMPRESSED, 0,
+					 &cachedTile )) ) break;
       break;
 
     case DEFLATE:
 
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, DEFLATE, 0 )) ) break;
+					 xangle, yangle, DEFLATE, 0,
+					 &cachedTile )) ) break;
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, UNCOMPRESSED, 0 )) ) break;
+					 xangle, yangle, UNCOMPRESSED, 0,
+					 &cachedTile )) ) break;
       break;
 
 
     case UNCOMPRESSED:
 
       if( (rawtile = tileCache->getTile( image->getHash(), resolution, tile,
-					 xangle, yangle, UNCOMPRESSED, 0 )) ) break;
+					 xangle, yangle, UNCOMPRESSED, 0,
+					 &cachedTile )) ) break;
       break;
 
 
@@ -218,8 +311,16 @@ RawTile TileManager::getTile( int resolution, int tile, int xangle, int yangle,
     }
 
 
-  // If we haven't been able to get a tile, get a raw one
+  // If we haven't been able to get a tile, get a raw one unless another
+  // request is already rendering it, in which case wait for it and look again
   if( !rawtile ){
+    char key[64];
+    snprintf( key, 64, ":%d:%d:%d:%d:%d:%d", resolution, tile, xangle, yangle,
+	      (int) c, (c == JPEG) ? jpeg->getQuality() : 0 );
+    SingleFlight::Guard flight( renderFlights );
+    if( !flight.begin( image->getHash() + key ) ){
+      return this->getTile( resolution, tile, xangle, yangle, c );
+    }
     RawTile newtile = this->getNewTile( resolution, tile, xangle, yangle, c );
     LOG_INFO("TileManager :: Total Tile Access Time: " <<
 	      tile_timer.getTime() << "us");
@@ -248,7 +349,7 @@ RawTile TileManager::getTile( int resolution, int tile, int xangle, int yangle,
 
   if( c == JPEG && rawtile->compressionType == UNCOMPRESSED ){
 
-    // Rawtile is a pointer to the cache data, so we need to create a copy of it in case we compress it
+    // Rawtile is a copy of the cache data, but keep it unmodified in case we compress it
     RawTile ttt( *rawtile );
 
     // Do our JPEG compression iff we have an 8 bit per channel image
@@ -282,7 +383,7 @@ RawTile TileManager::getTile( int resolution, int tile, int xangle, int yangle,
 
   if( c == PNG && rawtile->compressionType == UNCOMPRESSED ){
 
-    // Rawtile is a pointer to the cache data, so we need to create a copy of it in case we compress it
+    // Rawtile is a copy of the cache data, but keep it unmodified in case we compress it
     RawTile ttt( *rawtile );
 
     // Do our PNG compression iff we have an 8 bit per channel image
@@ -317,3 +418,65 @@ RawTile TileManager::getTile( int resolution, int tile, int xangle, int yangle,
             tile_timer.getTime() << " microseconds");
   return RawTile( *rawtile );
 }
+
+
+
+RawTile TileManager::getValueTile( int resolution, int tile, int xangle, int yangle, CompressionType c ){
+
+  RawTile cachedTile;
+  string hash = image->getHash() + VALUETILE_HASH;
+
+  LOG_COND_INFO(tile_timer.start());
+  if( c != DEFLATE ) c = UNCOMPRESSED;
+
+  if( tileCache->getTile( hash, resolution, tile, xangle, yangle, c, 0,
+			  &cachedTile ) ){
+    LOG_INFO("TileManager :: Cache Hit for grey value tile, resolution: " <<
+	      resolution << ", tile: " << tile);
+    return cachedTile;
+  }
+
+  // Render the tile unless another request is already rendering it
+  char key[64];
+  snprintf( key, 64, ":%d:%d:%d:%d:%d", resolution, tile, xangle, yangle,
+	    (int) c );
+  SingleFlight::Guard flight( renderFlights );
+  if( !flight.begin( hash + key ) ){
+    return this->getValueTile( resolution, tile, xangle, yangle, c );
+  }
+  LOG_INFO("TileManager :: Cache Miss for grey value tile, resolution: " <<
+	    resolution << ", tile: " << tile);
+
+  RawTile ttt = image->getValueTile( xangle, yangle, resolution, tile );
+
+  if( c == DEFLATE && ttt.dataLength > VALUETILE_HEADER_SZ ){
+    // Deflate the values, keeping them uncompressed if that is no smaller
+    LOG_COND_INFO(compression_timer.start());
+    uLong len = ttt.dataLength - VALUETILE_HEADER_SZ;
+    uLongf zlen = compressBound( len );
+    unsigned char *buf = (unsigned char*) malloc( VALUETILE_HEADER_SZ + zlen );
+    if( buf &&
+	compress2( buf + VALUETILE_HEADER_SZ, &zlen,
+		   (const unsigned char*) ttt.data + VALUETILE_HEADER_SZ,
+		   len, Z_BEST_SPEED ) == Z_OK && zlen < len ){
+      memcpy( buf, ttt.data, VALUETILE_HEADER_SZ );
+      buf[6] = VALUETILE_DEFLATE;
+      if( ttt.localData ) free( ttt.data );
+      ttt.data = buf;
+      ttt.localData = 1;
+      ttt.dataLength = VALUETILE_HEADER_SZ + zlen;
+    }
+    else free( buf );
+    LOG_INFO("TileManager :: Deflate Compression Time: " <<
+	      compression_timer.getTime() << "us");
+  }
+  ttt.compressionType = c;
+
+  LOG_COND_INFO(insert_timer.start());
+  tileCache->insert( ttt );
+  LOG_INFO("TileManager :: Tile cache insertion time: " <<
+	    insert_timer.getTime() << "us");
+  LOG_INFO("TileManager :: Total Tile Access Time: " <<
+	    tile_timer.getTime() << "us");
+  return ttt;
+}
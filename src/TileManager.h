@@ -48,12 +48,16 @@ static char _TileManager_h[] = "University of Edinburgh $Id$";
 */
 
 #include <fstream>
+#include <list>
+#include <map>
+#include <pthread.h>
 
 #include "RawTile.h"
 #include "IIPImage.h"
 #include "JPEGCompressor.h"
 #include "PNGCompressor.h"
 #include "Cache.h"
+#include "SingleFlight.h"
 #include "Timer.h"
 
 
@@ -86,6 +90,31 @@ class TileManager{
   RawTile getNewTile( int resolution, int tile, int xangle, int yangle, CompressionType c );
 
 
+  /// Set the data of an empty tile, compressing it only if no identical tile has been
+  /**
+   *  Empty tiles are the same for all images with the same tile size, number
+   *  of channels and background, so they are kept compressed in a small
+   *  table of their own rather than in the tile cache.
+   *  @param ttt header of the empty tile, as set by IIPImage::isEmptyTile()
+   *  @param bg background value of each channel
+   *  @param c CompressionType, JPEG or PNG
+   */
+  void getEmptyTile( RawTile& ttt, const unsigned char *bg, CompressionType c );
+
+
+  /// Compressed empty tiles keyed by size, channels, background and compression
+  static std::map<std::string, RawTile> emptyTiles;
+
+  /// Keys of emptyTiles, oldest first
+  static std::list<std::string> emptyTileKeys;
+
+  /// Protects emptyTiles
+  static pthread_mutex_t emptyTilesMutex;
+
+
+  /// Tiles being rendered, so that concurrent requests for a tile wait for one render
+  static SingleFlight renderFlights;
+
   /// Crop a tile to remove padding
   /** @param t pointer to tile to crop
    */
@@ -126,6 +155,21 @@ class TileManager{
   RawTile getTile( int resolution, int tile, int xangle, int yangle, CompressionType c );
 
 
+  /// Get a tile of the image's grey values from the cache
+  /**
+   *  Grey value tiles are cached like other tiles, under the image hash with
+   *  VALUETILE_HASH appended. If the tile is not in the cache it is rendered
+   *  by the image and, if requested, its values are deflated.
+   *  @param resolution resolution number
+   *  @param tile tile number
+   *  @param xangle horizontal sequence number
+   *  @param yangle vertical sequence number
+   *  @param c CompressionType, UNCOMPRESSED or DEFLATE
+   *  @return RawTile with a ValueTile.h header and the values
+   */
+  RawTile getValueTile( int resolution, int tile, int xangle, int yangle, CompressionType c );
+
+
 };
 
 
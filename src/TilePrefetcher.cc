@@ -0,0 +1,428 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _TilePrefetcher_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         TilePrefetcher.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Background prefetching of the tiles around those served.
+* \ingroup	WlzIIPServer
+*/
+
+#include <sched.h>
+#include "Log.h"
+#include "TilePrefetcher.h"
+#include "TileManager.h"
+#include "JPEGCompressor.h"
+#include "PNGCompressor.h"
+#include "WlzImage.h"
+
+using namespace std;
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Constructs the prefetcher and starts its threads. If no
+* 		threads are requested, or none can be started, the
+* 		prefetcher is not valid and prefetch() does nothing.
+* \param	tileCache		Tile cache into which prefetched
+* 					tiles are inserted.
+* \param	nThreads		Number of prefetch threads.
+* \param	budget			Maximum number of tiles which may be
+* 					queued for a session.
+*/
+TilePrefetcher::TilePrefetcher(Cache *tileCache, int nThreads, int budget)
+{
+  this->tileCache = tileCache;
+  this->budget = budget;
+  this->nThreads = 0;
+  threads = NULL;
+  stop = false;
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+  if((tileCache != NULL) && (nThreads > 0) && (budget > 0))
+  {
+    threads = new pthread_t[nThreads];
+    for(int i = 0; i < nThreads; ++i)
+    {
+      if(pthread_create(&(threads[this->nThreads]), NULL,
+                        TilePrefetcher::run, this) != 0)
+      {
+	LOG_ERROR("TilePrefetcher :: Failed to create prefetch thread " << i);
+      }
+      else
+      {
+        ++(this->nThreads);
+      }
+    }
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Cancels all queued tiles and waits for the threads to
+* 		finish the tiles they are rendering.
+*/
+TilePrefetcher::~TilePrefetcher()
+{
+  pthread_mutex_lock(&mutex);
+  stop = true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+  for(int i = 0; i < nThreads; ++i)
+  {
+    (void )pthread_join(threads[i], NULL);
+  }
+  delete[] threads;
+  for(list<Job *>::iterator it = queue.begin(); it != queue.end(); ++it)
+  {
+    delete *it;
+  }
+  queue.clear();
+  sessions.clear();
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Queues a job to find the tiles which are likely to be
+* 		requested after the given tile has been served. The image
+* 		size is only needed to find these tiles, so it is computed
+* 		by a prefetch thread rather than on the request thread.
+* 		If the session's view has changed since its last call its
+* 		queued tiles are cancelled. No more than the budget of
+* 		jobs are queued for a session.
+* \param	client			Client identifier, eg the remote
+* 					address, may be empty.
+* \param	image			Image for which a tile was served.
+* \param	view			View parameters of the image.
+* \param	resolution		Resolution number.
+* \param	tile			Tile number.
+* \param	xAngle			Horizontal sequence number.
+* \param	yAngle			Vertical sequence number.
+* \param	compression		Compression type.
+* \param	quality			Compression quality.
+*/
+void		TilePrefetcher::prefetch(const string &client, WlzImage *image,
+				 const ViewParameters *view,
+				 int resolution, int tile,
+				 int xAngle, int yAngle,
+				 CompressionType compression, int quality)
+{
+  if((nThreads < 1) || (image == NULL) || (view == NULL) ||
+     (resolution < 0) || (tile < 0))
+  {
+    return;
+  }
+  const string	hash = image->getHash(),
+  		key = client + "\n" + image->getImagePath();
+
+  pthread_mutex_lock(&mutex);
+  SessionMap::iterator sIt = sessions.find(key);
+  if(sIt == sessions.end())
+  {
+    SessionState state;
+
+    state.generation = 0;
+    state.pending = 0;
+    sIt = sessions.insert(make_pair(key, state)).first;
+  }
+  SessionState &state = sIt->second;
+  if(state.view != hash)
+  {
+    // The view has changed so the session's queued tiles are stale.
+    state.view = hash;
+    ++(state.generation);
+    list<Job *>::iterator it = queue.begin();
+    while(it != queue.end())
+    {
+      if((*it)->session == key)
+      {
+        delete *it;
+	it = queue.erase(it);
+	--(state.pending);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+  if(state.pending < budget)
+  {
+    Job *job = new Job;
+    job->session = key;
+    job->generation = state.generation;
+    job->path = image->getImagePath();
+    job->view = *view;
+    job->view.map = view->map;
+    job->resolution = resolution;
+    job->tile = tile;
+    job->neighbours = true;
+    job->xAngle = xAngle;
+    job->yAngle = yAngle;
+    job->compression = compression;
+    job->quality = quality;
+    push(job, state);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Queues the tiles which are likely to be requested after a
+* 		job's tile has been served: the tiles surrounding it in the
+* 		same view and, for sections, the same tile at the section
+* 		distances either side of the view's. No more than the
+* 		budget of tiles are queued for the job's session. Called
+* 		by a prefetch thread without the mutex locked.
+* \param	job			Job for the tile served.
+*/
+void		TilePrefetcher::expand(const Job *job)
+{
+  int		ntlx,
+		ntly;
+  unsigned int	width,
+		height;
+
+  try
+  {
+    WlzImage	image(job->path);
+
+    image.Initialise();
+    image.setView(&(job->view));
+    image.loadImageInfo(0, 0);
+    if(job->resolution >= image.getNumResolutions())
+    {
+      return;
+    }
+    image.getLevelSize(image.getNumResolutions() - 1 - job->resolution,
+			width, height);
+    ntlx = (width + image.getTileWidth() - 1) / image.getTileWidth();
+    ntly = (height + image.getTileHeight() - 1) / image.getTileHeight();
+  }
+  catch(const string &error)
+  {
+    LOG_DEBUG("TilePrefetcher :: " << error);
+    return;
+  }
+  if(job->tile >= ntlx * ntly)
+  {
+    return;
+  }
+  // Tiles in the order in which they are most likely to be wanted: the
+  // same tile on the adjacent sections, then the edge and corner
+  // neighbours.
+  const int	tX = job->tile % ntlx,
+  		tY = job->tile / ntlx;
+  const int	nbr[10][3] = {{0, 0, 1}, {0, 0, -1},
+			      {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0},
+			      {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0}};
+
+  pthread_mutex_lock(&mutex);
+  SessionMap::iterator sIt = sessions.find(job->session);
+  if(current(job))
+  {
+    SessionState &state = sIt->second;
+
+    for(int i = 0; (i < 10) && (state.pending < budget); ++i)
+    {
+      const int	x = tX + nbr[i][0],
+		y = tY + nbr[i][1],
+		d = nbr[i][2];
+
+      if((x < 0) || (x >= ntlx) || (y < 0) || (y >= ntly) ||
+	 ((d != 0) && (job->view.rmd != RENDERMODE_SECT)))
+      {
+	continue;
+      }
+      Job *nJob = new Job(*job);
+      nJob->view.map = job->view.map;
+      nJob->view.dist += d;
+      nJob->tile = (d == 0)? (y * ntlx) + x: job->tile;
+      nJob->neighbours = false;
+      push(nJob, state);
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Queues a job unless an identical one is already queued.
+* 		The mutex must be locked.
+* \param	job			Job, which is deleted if not queued.
+* \param	state			State of the job's session.
+*/
+void		TilePrefetcher::push(Job *job, SessionState &state)
+{
+  for(list<Job *>::iterator it = queue.begin(); it != queue.end(); ++it)
+  {
+    const Job	*q = *it;
+
+    if((q->tile == job->tile) && (q->view.dist == job->view.dist) &&
+       (q->neighbours == job->neighbours) &&
+       (q->resolution == job->resolution) &&
+       (q->compression == job->compression) &&
+       (q->generation == job->generation) && (q->session == job->session))
+    {
+      delete job;
+      return;
+    }
+  }
+  queue.push_back(job);
+  ++(state.pending);
+  pthread_cond_signal(&cond);
+}
+
+/*!
+* \return	True if the job's session view has not changed.
+* \ingroup	WlzIIPServer
+* \brief	Checks that a job is still wanted. The mutex must be locked.
+* \param	job			Job.
+*/
+bool		TilePrefetcher::current(const Job *job)
+{
+  SessionMap::iterator sIt = sessions.find(job->session);
+
+  return((sIt != sessions.end()) &&
+         (sIt->second.generation == job->generation));
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Accounts for a finished job, forgetting the session once
+* 		it has no more jobs. The mutex must be locked.
+* \param	job			Job.
+*/
+void		TilePrefetcher::done(const Job *job)
+{
+  SessionMap::iterator sIt = sessions.find(job->session);
+
+  if((sIt != sessions.end()) && (--(sIt->second.pending) <= 0))
+  {
+    sessions.erase(sIt);
+  }
+}
+
+/*!
+* \return	NULL.
+* \ingroup	WlzIIPServer
+* \brief	Entry point of a prefetch thread, which runs at the lowest
+* 		scheduling priority where supported.
+* \param	arg			The prefetcher.
+*/
+void		*TilePrefetcher::run(void *arg)
+{
+#ifdef SCHED_IDLE
+  struct sched_param param;
+
+  param.sched_priority = 0;
+  (void )pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+  ((TilePrefetcher *)arg)->work();
+  return(NULL);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Runs queued jobs until the prefetcher is destroyed.
+* 		Jobs of sessions whose view has changed since they were
+* 		queued are dropped.
+*/
+void		TilePrefetcher::work()
+{
+  pthread_mutex_lock(&mutex);
+  for(;;)
+  {
+    while(!stop && queue.empty())
+    {
+      pthread_cond_wait(&cond, &mutex);
+    }
+    if(stop)
+    {
+      break;
+    }
+    Job *job = queue.front();
+    queue.pop_front();
+    if(current(job))
+    {
+      pthread_mutex_unlock(&mutex);
+      if(job->neighbours)
+      {
+        expand(job);
+      }
+      else
+      {
+        render(job);
+      }
+      pthread_mutex_lock(&mutex);
+    }
+    done(job);
+    delete job;
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Renders a job's tile, if it is not already cached, and
+* 		inserts it into the tile cache. Errors, such as a tile
+* 		which does not exist on an adjacent section, are ignored.
+* \param	job			Job.
+*/
+void		TilePrefetcher::render(Job *job)
+{
+  try
+  {
+    WlzImage	image(job->path);
+    JPEGCompressor jpeg(job->quality);
+    PNGCompressor png;
+
+    image.Initialise();
+    image.setView(&(job->view));
+    TileManager tilemanager(tileCache, &image, &jpeg, &png);
+    (void )tilemanager.getTile(job->resolution, job->tile,
+                               job->xAngle, job->yAngle, job->compression);
+    LOG_DEBUG("TilePrefetcher :: Prefetched tile " << job->tile <<
+              " at distance " << job->view.dist);
+  }
+  catch(const string &error)
+  {
+    LOG_DEBUG("TilePrefetcher :: " << error);
+  }
+  catch(...)
+  {
+    LOG_DEBUG("TilePrefetcher :: Failed to prefetch tile " << job->tile);
+  }
+}
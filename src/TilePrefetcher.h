@@ -0,0 +1,138 @@
+#ifndef _TILEPREFETCHER_H
+#define _TILEPREFETCHER_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _TilePrefetcher_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         TilePrefetcher.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Background prefetching of the tiles around those served.
+* \ingroup	WlzIIPServer
+*/
+
+#include <pthread.h>
+#include <list>
+#include <map>
+#include <string>
+#include "RawTile.h"
+#include "Cache.h"
+#include "ViewParameters.h"
+
+class WlzImage;
+
+/*!
+* \brief	Renders the tiles which a viewer is likely to request next
+* 		on low priority background threads and inserts them into
+* 		the tile cache, keyed just as TileManager keys them.
+* 		After a tile has been served the tiles surrounding it in
+* 		the same view and the same tile at the section distances
+* 		either side are queued by a prefetch thread, so that the
+* 		request thread does no more than queue a single job. Each session (the client and image)
+* 		may only have a limited number of tiles queued and a change
+* 		of a session's view cancels its queued tiles.
+* \ingroup	WlzIIPServer
+*/
+class TilePrefetcher
+{
+  private:
+    /*!
+    * \brief	A tile to be prefetched.
+    * \ingroup	WlzIIPServer
+    */
+    struct Job
+    {
+      std::string	session;		/*!< Session key. */
+      unsigned long	generation;		/*!< Session view generation
+      						     when queued. */
+      std::string	path;			/*!< Image path. */
+      ViewParameters	view;			/*!< View of the tile. */
+      int		resolution;		/*!< Resolution number. */
+      int		tile;			/*!< Tile number. */
+      bool		neighbours;		/*!< Queue the tiles around
+      						     the tile, which has been
+						     served, rather than
+						     render it. */
+      int		xAngle;			/*!< Horizontal sequence
+      						     number. */
+      int		yAngle;			/*!< Vertical sequence
+      						     number. */
+      CompressionType	compression;		/*!< Compression type. */
+      int		quality;		/*!< Compression quality. */
+    };
+    /*!
+    * \brief	Prefetching state of a session.
+    * \ingroup	WlzIIPServer
+    */
+    struct SessionState
+    {
+      std::string	view;			/*!< Hash of the last view
+      						     served. */
+      unsigned long	generation;		/*!< Incremented whenever the
+      						     view changes. */
+      int		pending;		/*!< Number of queued or
+      						     running jobs. */
+    };
+    typedef std::map<std::string, SessionState> SessionMap;
+
+    Cache		*tileCache;		/*!< Tile cache. */
+    int			budget;			/*!< Maximum number of jobs
+    						     per session. */
+    int			nThreads;		/*!< Number of threads. */
+    pthread_t		*threads;		/*!< Prefetch threads. */
+    pthread_mutex_t	mutex;			/*!< Protects the queue and
+    						     sessions. */
+    pthread_cond_t	cond;			/*!< Signals queued jobs. */
+    bool		stop;			/*!< Set to stop the threads. */
+    std::list<Job *>	queue;			/*!< Queued jobs. */
+    SessionMap		sessions;		/*!< Sessions with jobs. */
+    static void		*run(void *arg);
+    void		work();
+    void		render(Job *job);
+    void		expand(const Job *job);
+    bool		current(const Job *job);
+    void		done(const Job *job);
+    void		push(Job *job, SessionState &state);
+
+  public:
+    TilePrefetcher(Cache *tileCache, int nThreads, int budget);
+    ~TilePrefetcher();
+    bool		isValid() const {return(nThreads > 0);}
+    void		prefetch(const std::string &client, WlzImage *image,
+				 const ViewParameters *view,
+				 int resolution, int tile,
+				 int xAngle, int yAngle,
+				 CompressionType compression, int quality);
+};
+
+#endif
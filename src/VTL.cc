@@ -0,0 +1,137 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _VTL_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         VTL.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+* 
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	IIP VTL grey value tile command handler.
+* \ingroup    	WlzIIPServer
+*/
+
+
+#include <algorithm>
+#include <cctype>
+#include "Log.h"
+#include "Task.h"
+#include "Tokenizer.h"
+
+using namespace std;
+
+
+/**
+ * Sends a tile of the section's grey values in their own type, for clients
+ * which apply their own colour maps. The tile is a ValueTile.h header
+ * followed by the values, which may be deflated.
+ * @param session 
+ * @param argument 
+ */
+void VTL::run( Session* session, std::string argument ){
+  /* The argument should consist of 2 or 3 comma separated values:
+     1) resolution
+     2) tile number
+     3) optional transport compression, "deflate" or "none"
+  */
+  LOG_INFO("VTL handler reached");
+  this->session = session;
+  this->argument = argument;
+  checkImage();
+  checkIfWoolz();
+  LOG_COND_INFO(command_timer.start());
+
+  // Parse the argument list
+  vector<string> args;
+  Tokenizer izer( argument, "," );
+  while( izer.hasMoreTokens() ) args.push_back( izer.nextToken() );
+  if( args.size() == 3 ){
+    transform( args[2].begin(), args[2].end(), args[2].begin(), ::tolower );
+  }
+  if( args.size() < 2 || args.size() > 3 ||
+      args[0].find_first_not_of( "0123456789" ) != string::npos ||
+      args[1].find_first_not_of( "0123456789" ) != string::npos ||
+      (args.size() == 3 && args[2] != "deflate" && args[2] != "none") ){
+    // Malformed command syntax error code is 2 1
+    session->response->setError( "2 1", argument );
+    throw string( "VTL : Invalid parameters." );
+  }
+  // The values of several selections can not be combined
+  if( session->viewParams->selector && session->viewParams->selector->next ){
+    session->response->setError( "2 1", argument );
+    throw string( "VTL : Only one SEL may be given." );
+  }
+  int resolution = atoi( args[0].c_str() );
+  int tile = atoi( args[1].c_str() );
+  CompressionType c = (args.size() == 3 && args[2] == "deflate")?
+		      DEFLATE: UNCOMPRESSED;
+
+  // Answer revalidation before rendering anything
+  char params[128];
+  snprintf( params, 128, "VTL,%d,%d,%d,%d,%d", resolution, tile,
+	    session->view->xangle, session->view->yangle, (int) c );
+  string etag = makeETag( session, params );
+  if( sendNotModified( session, etag ) ){
+    LOG_INFO("VTL :: Total command time " << command_timer.getTime() << "us");
+    return;
+  }
+
+  TileManager tilemanager( session->tileCache, *session->image, session->jpeg, session->png );
+  RawTile rawtile = tilemanager.getValueTile( resolution, tile, session->view->xangle,
+					      session->view->yangle, c );
+  int len = rawtile.dataLength;
+
+  LOG_INFO("VTL :: Tile size: " << rawtile.width << " x " << rawtile.height <<
+	   endl << "VTL :: Bits per channel: " << rawtile.bpc << endl <<
+	   "VTL :: Tile data size is " << len);
+
+#ifndef DEBUG
+  char buf[1024];
+  snprintf( buf, 1024, "%s"
+	    "Content-length: %d\r\n"
+	    "Content-type: application/octet-stream\r\n"
+	    "Content-disposition: inline;filename=\"vtl.bin\""
+	    "\r\n\r\n", cacheHeaders( etag ).c_str(), len );
+  session->out->printf( (const char*) buf );
+#endif
+
+  if( session->out->putStr( (const char*) rawtile.data, len ) != len ){
+    LOG_ERROR("VTL :: Error writing grey value tile");
+  }
+  if( session->out->flush() == -1 ){
+    LOG_ERROR("VTL :: Error flushing grey value tile");
+  }
+
+  // Inform our response object that we have sent something to the client
+  session->response->setImageSent();
+
+  LOG_INFO("VTL :: Total command time " << command_timer.getTime() << "us");
+}
@@ -0,0 +1,204 @@
+#ifndef _VALUETILE_H
+#define _VALUETILE_H
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _ValueTile_h[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         ValueTile.h
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Layout of the grey value tiles sent for client side rendering.
+* \ingroup	WlzIIPServer
+*/
+
+
+#include <string.h>
+#include <Wlz.h>
+
+/*!
+* \def		VALUETILE_HEADER_SZ
+* \ingroup	WlzIIPServer
+* \brief	Size of the header which precedes the values of a grey value
+* 		tile. The header is:
+* 		  bytes 0-3   "WLZV"
+* 		  byte  4     version (1)
+* 		  byte  5     sample type, see _ValueTileType
+* 		  byte  6     compression, see _ValueTileCompression
+* 		  byte  7     1 if the values are big endian, else 0
+* 		  bytes 8-9   tile width, little endian
+* 		  bytes 10-11 tile height, little endian
+* 		  bytes 12-15 uncompressed size of the values, little endian
+* 		The values follow in raster order without padding. Pixels
+* 		outside of the object's domain are zero. An object without
+* 		values is sent as unsigned 8 bit values which are 255
+* 		within its domain, see ValueTileSetDomain().
+*/
+#define VALUETILE_HEADER_SZ	(16)
+
+/*!
+* \def		VALUETILE_HASH
+* \ingroup	WlzIIPServer
+* \brief	Appended to an image hash to key its grey value tiles in the
+* 		tile cache apart from its rendered tiles.
+*/
+#define VALUETILE_HASH		":values"
+
+/*!
+* \enum		_ValueTileType
+* \ingroup	WlzIIPServer
+* \brief	Sample types of grey value tiles.
+*/
+typedef enum _ValueTileType
+{
+  VALUETILE_UBYTE	= 1,		/*!< Unsigned 8 bit. */
+  VALUETILE_SHORT	= 2,		/*!< Signed 16 bit. */
+  VALUETILE_INT		= 3,		/*!< Signed 32 bit. */
+  VALUETILE_FLOAT	= 4,		/*!< 32 bit floating point. */
+  VALUETILE_RGBA	= 5,		/*!< 8 bit red, green, blue and alpha
+  					     in a 32 bit word. */
+  VALUETILE_LONG	= 6,		/*!< Signed 64 bit. */
+  VALUETILE_DOUBLE	= 7		/*!< 64 bit floating point. */
+} ValueTileType;
+
+/*!
+* \enum		_ValueTileCompression
+* \ingroup	WlzIIPServer
+* \brief	Compression of the values of grey value tiles.
+*/
+typedef enum _ValueTileCompression
+{
+  VALUETILE_NONE	= 0,		/*!< Uncompressed. */
+  VALUETILE_DEFLATE	= 1		/*!< Zlib (RFC 1950) deflate stream. */
+} ValueTileCompression;
+
+/*!
+* \return	Number of bytes in a sample of the given type.
+* \ingroup	WlzIIPServer
+* \brief	Gives the size of the samples of a grey value tile.
+* \param	type			Sample type.
+*/
+inline int	ValueTileSampleSize(ValueTileType type)
+{
+  return((type == VALUETILE_UBYTE)? 1: (type == VALUETILE_SHORT)? 2:
+         ((type == VALUETILE_LONG) || (type == VALUETILE_DOUBLE))? 8: 4);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Sets the header of a grey value tile.
+* \param	hdr			Header of VALUETILE_HEADER_SZ bytes.
+* \param	type			Sample type.
+* \param	compression		Compression of the values.
+* \param	width			Tile width.
+* \param	height			Tile height.
+* \param	size			Uncompressed size of the values.
+*/
+inline void	ValueTileSetHeader(unsigned char *hdr, ValueTileType type,
+				   ValueTileCompression compression,
+				   unsigned int width, unsigned int height,
+				   unsigned int size)
+{
+  const unsigned int one = 1;
+
+  memcpy(hdr, "WLZV", 4);
+  hdr[4] = 1;
+  hdr[5] = (unsigned char )type;
+  hdr[6] = (unsigned char )compression;
+  hdr[7] = (*(const unsigned char *)&one == 1)? 0: 1;
+  hdr[8] = width & 0xff;
+  hdr[9] = (width >> 8) & 0xff;
+  hdr[10] = height & 0xff;
+  hdr[11] = (height >> 8) & 0xff;
+  for(int i = 0; i < 4; ++i)
+  {
+    hdr[12 + i] = (size >> (8 * i)) & 0xff;
+  }
+}
+
+
+/*!
+* \return	Woolz error code.
+* \ingroup	WlzIIPServer
+* \brief	Sets the unsigned 8 bit values of a grey value tile to 255
+* 		within the domain of a 2D object, leaving those outside of
+* 		the domain unchanged. This gives the same mask for domain
+* 		objects as the rendered tiles, in which the domain is
+* 		composited as if all its values were 255. Intervals are
+* 		clipped to the tile.
+* \param	values			Values of the tile, which follow the
+* 					header.
+* \param	obj			2D domain object, the values of which
+* 					are ignored.
+* \param	x0			Column of the first tile pixel.
+* \param	y0			Line of the first tile pixel.
+* \param	width			Tile width.
+* \param	height			Tile height.
+*/
+inline WlzErrorNum ValueTileSetDomain(unsigned char *values, WlzObject *obj,
+				      int x0, int y0,
+				      int width, int height)
+{
+  WlzIntervalWSpace iwsp;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  if((values == NULL) || (obj == NULL))
+  {
+    errNum = WLZ_ERR_OBJECT_NULL;
+  }
+  else if(obj->type != WLZ_2D_DOMAINOBJ)
+  {
+    errNum = WLZ_ERR_OBJECT_TYPE;
+  }
+  else if((errNum = WlzInitRasterScan(obj, &iwsp,
+				      WLZ_RASTERDIR_ILIC)) == WLZ_ERR_NONE)
+  {
+    while((errNum = WlzNextInterval(&iwsp)) == WLZ_ERR_NONE)
+    {
+      const int	y = iwsp.linpos - y0,
+      		x1 = WLZ_MAX(iwsp.lftpos - x0, 0),
+		x2 = WLZ_MIN(iwsp.rgtpos - x0, width - 1);
+
+      if((y >= 0) && (y < height) && (x1 <= x2))
+      {
+	memset(values + (width * y) + x1, 255, x2 - x1 + 1);
+      }
+    }
+    if(errNum == WLZ_ERR_EOO)
+    {
+      errNum = WLZ_ERR_NONE;
+    }
+  }
+  return(errNum);
+}
+
+#endif
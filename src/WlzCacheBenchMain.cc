@@ -0,0 +1,326 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _WlzCacheBenchMain_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         WlzCacheBenchMain.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Measures the time taken by the tile cache to insert and
+* 		find tiles, both from a single thread and from several
+* 		threads at once, and compares it with the list and
+* 		hash_map cache which it replaced.
+* \ingroup	WlzIIPServer
+*/
+
+
+#define _MAIN_CC
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include "Log.h"
+#include "Cache.h"
+#include "ListCache.h"
+
+/*!
+* \struct	WlzCacheBenchThread
+* \ingroup	WlzIIPServer
+* \brief	Parameters and result of a mixed test thread.
+*/
+template <class C> struct WlzCacheBenchThread
+{
+  C		*cache;			/*!< Cache under test. */
+  int		id;			/*!< Thread index. */
+  int		nOps;			/*!< Number of gets. */
+  int		nTiles;			/*!< Number of distinct tiles. */
+  int		tileSz;			/*!< Tile data size. */
+  long		hits;			/*!< Number of gets which hit. */
+};
+
+static const char *WlzCacheBenchFile =
+    "/data/wlz/bench.wlz(D=0,S=1,Y=0,P=0,R=0,M=0,N=0,C=1,F=0,0,0)S=";
+
+/*!
+* \return	Wall clock time in seconds.
+* \ingroup	WlzIIPServer
+* \brief	Returns the wall clock time.
+*/
+static double	WlzCacheBenchTime(void)
+{
+  struct timeval tv;
+
+  (void )gettimeofday(&tv, NULL);
+  return((double )(tv.tv_sec) + (1.0e-6 * tv.tv_usec));
+}
+
+/*!
+* \return	Next pseudo random number.
+* \ingroup	WlzIIPServer
+* \brief	Small linear congruential generator, used so that each
+* 		thread has its own sequence without any locking.
+* \param	s			Generator state.
+*/
+static unsigned int WlzCacheBenchRand(unsigned int *s)
+{
+  *s = (*s * 1103515245u) + 12345u;
+  return(*s >> 1);
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Sets up a tile with the given number and allocated data.
+* \param	t			Tile to set up.
+* \param	n			Tile number.
+* \param	sz			Size of the tile data in bytes.
+*/
+static void	WlzCacheBenchTile(RawTile *t, int n, int sz)
+{
+  t->tileNum = n;
+  t->filename = WlzCacheBenchFile;
+  t->compressionType = JPEG;
+  t->quality = 75;
+  t->dataLength = sz;
+  t->data = calloc(sz, 1);
+  t->localData = 1;
+  if(sz >= (int )sizeof(int))
+  {
+    /* Distinct data so that tiles do not share payloads. */
+    memcpy(t->data, &n, sizeof(int));
+  }
+}
+
+/*!
+* \return	NULL.
+* \ingroup	WlzIIPServer
+* \brief	Thread body for the mixed test: gets tiles, mostly from a
+* 		small hot set, and inserts any tile that is missing, as
+* 		the server does.
+* \param	arg			Thread parameters.
+*/
+template <class C> static void *WlzCacheBenchRun(void *arg)
+{
+  int		i;
+  WlzCacheBenchThread<C> *p = (WlzCacheBenchThread<C> *)arg;
+  unsigned int	s = (p->id * 7919) + 1;
+
+  for(i = 0; i < p->nOps; ++i)
+  {
+    int		n;
+    RawTile	t;
+
+    n = ((WlzCacheBenchRand(&s) % 4) == 0)?
+	WlzCacheBenchRand(&s) % p->nTiles:
+	WlzCacheBenchRand(&s) % ((p->nTiles + 9) / 10);
+    if(p->cache->getTile(WlzCacheBenchFile, 0, n, 0, 0, JPEG, 75, &t))
+    {
+      ++(p->hits);
+    }
+    else
+    {
+      RawTile	u;
+
+      WlzCacheBenchTile(&u, n, p->tileSz);
+      p->cache->insert(u);
+    }
+  }
+  return(NULL);
+}
+
+/*!
+* \return	Non zero on success.
+* \ingroup	WlzIIPServer
+* \brief	Times inserts, single threaded gets and mixed gets and
+* 		inserts from several threads on a cache of the given
+* 		type and prints the times.
+* \param	name			Name of the cache for the output.
+* \param	nThr			Number of threads for the mixed test.
+* \param	nTiles			Number of distinct tiles.
+* \param	nOps			Number of gets for each test.
+* \param	tileSz			Tile data size in bytes.
+*/
+template <class C> static int WlzCacheBench(const char *name, int nThr,
+					    int nTiles, int nOps, int tileSz)
+{
+  int		i,
+  		ok = 1;
+  long		hits = 0;
+  double	t0,
+  		t1,
+		t2,
+		t3;
+  /* Large enough to hold every tile, allowing for the per tile
+   * overhead. */
+  const float	sz = nTiles * (tileSz + 512) / 1024000.0;
+  C		*cache = new C(sz);
+  pthread_t	*thr = new pthread_t[nThr];
+  WlzCacheBenchThread<C> *thrP = new WlzCacheBenchThread<C>[nThr];
+
+  t0 = WlzCacheBenchTime();
+  for(i = 0; i < nTiles; ++i)
+  {
+    RawTile	t;
+
+    WlzCacheBenchTile(&t, i, tileSz);
+    cache->insert(t);
+  }
+  t1 = WlzCacheBenchTime();
+  {
+    unsigned int s = 1;
+
+    for(i = 0; i < nOps; ++i)
+    {
+      RawTile	t;
+
+      if(cache->getTile(WlzCacheBenchFile, 0,
+			WlzCacheBenchRand(&s) % nTiles, 0, 0, JPEG, 75, &t))
+      {
+	++hits;
+      }
+    }
+  }
+  t2 = WlzCacheBenchTime();
+  (void )printf("%-8s insert:                %8.0f ns/op\n"
+		"%-8s get, 1 thread:         %8.0f ns/op, hit rate %.2f\n",
+		name, (t1 - t0) * 1.0e9 / nTiles,
+		name, (t2 - t1) * 1.0e9 / nOps, (double )hits / nOps);
+  /* Start again with an empty cache for the mixed test. */
+  delete cache;
+  cache = new C(sz);
+  for(i = 0; i < nThr; ++i)
+  {
+    thrP[i].cache = cache;
+    thrP[i].id = i;
+    thrP[i].nOps = nOps / nThr;
+    thrP[i].nTiles = nTiles;
+    thrP[i].tileSz = tileSz;
+    thrP[i].hits = 0;
+  }
+  t2 = WlzCacheBenchTime();
+  for(i = 0; ok && (i < nThr); ++i)
+  {
+    if(pthread_create(thr + i, NULL, WlzCacheBenchRun<C>, thrP + i) != 0)
+    {
+      ok = 0;
+      (void )fprintf(stderr, "failed to create thread %d\n", i);
+      nThr = i;
+    }
+  }
+  hits = 0;
+  for(i = 0; i < nThr; ++i)
+  {
+    (void )pthread_join(thr[i], NULL);
+    hits += thrP[i].hits;
+  }
+  t3 = WlzCacheBenchTime();
+  if(ok)
+  {
+    (void )printf("%-8s get/insert, %2d threads: %8.0f ns/op, hit rate %.2f\n"
+		  "%-8s %u tiles, %.1f MB\n",
+		  name, nThr, (t3 - t2) * 1.0e9 / (thrP[0].nOps * nThr),
+		  (double )hits / (thrP[0].nOps * nThr),
+		  name, cache->getNumElements(), cache->getMemorySize());
+  }
+  delete cache;
+  delete[] thr;
+  delete[] thrP;
+  return(ok);
+}
+
+int 		main(int argc, char *argv[])
+{
+  int		option,
+  		ok = 1,
+  		usage = 0,
+		list = 1,
+		nThr = 4,
+		nTiles = 1000000,
+		nOps = 4000000,
+		tileSz = 64;
+  static char	optList[] = "hln:o:s:t:";
+
+  while((usage == 0) && ((option = getopt(argc, argv, optList)) != EOF))
+  {
+    switch(option)
+    {
+      case 'l':
+        list = 0;
+	break;
+      case 'n':
+        usage = ((nTiles = atoi(optarg)) < 1);
+	break;
+      case 'o':
+        usage = ((nOps = atoi(optarg)) < 1);
+	break;
+      case 's':
+        usage = ((tileSz = atoi(optarg)) < 1);
+	break;
+      case 't':
+        usage = ((nThr = atoi(optarg)) < 1);
+	break;
+      case 'h':
+      default:
+        usage = 1;
+	break;
+    }
+  }
+  ok = (usage == 0) && (optind == argc);
+  usage = !ok;
+  if(ok && list)
+  {
+    ok = WlzCacheBench<ListCache>("list", nThr, nTiles, nOps, tileSz);
+  }
+  if(ok)
+  {
+    ok = WlzCacheBench<Cache>("sharded", nThr, nTiles, nOps, tileSz);
+  }
+  if(usage)
+  {
+    (void )fprintf(stderr,
+    "Usage: %s [-h] [-l] [-n<tiles>] [-o<operations>] [-s<bytes>]\n"
+    "       [-t<threads>]\n"
+    "Measures the Woolz IIP server tile cache and the list and hash_map\n"
+    "cache which it replaced. Tiles are inserted, then found from a\n"
+    "single thread, then several threads get tiles and insert those\n"
+    "which are missing. Compare runs with -t1 and with one thread per\n"
+    "core to see the cost of lock contention. Options are:\n"
+    "  -l  Don't measure the list cache.\n"
+    "  -n  Number of distinct tiles (default 1000000).\n"
+    "  -o  Number of get operations for each test (default 4000000).\n"
+    "  -s  Size of the tile data in bytes (default 64).\n"
+    "  -t  Number of threads for the mixed test (default 4).\n"
+    "  -h  Help, prints this usage message.\n",
+    *argv);
+  }
+  return(!ok);
+}
@@ -0,0 +1,443 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _WlzCompositorBenchMain_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         WlzCompositorBenchMain.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Measures the rate at which grey value intervals are
+* 		composited into tile buffers by the fixed point
+* 		compositor, and compares it with the floating point
+* 		loop of convertValueObjToRGB() which it replaced.
+* \ingroup	WlzIIPServer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/time.h>
+#include "Compositor.h"
+
+/*!
+* \struct	WlzCompositorBenchCase
+* \ingroup	WlzIIPServer
+* \brief	A grey type, buffer layout and selector to be measured.
+*/
+typedef struct _WlzCompositorBenchCase
+{
+  const char	*name;			/*!< Description for the output. */
+  WlzGreyType	gType;			/*!< Grey type of the values. */
+  int		nCh;			/*!< Number of buffer channels. */
+  int		alphaOff;		/*!< Offset of the alpha channel,
+  					     zero if none. */
+  int		a;			/*!< Selector alpha. */
+  int		r;			/*!< Selector red. */
+  int		g;			/*!< Selector green. */
+  int		b;			/*!< Selector blue. */
+} WlzCompositorBenchCase;
+
+static const WlzCompositorBenchCase WlzCompositorBenchCases[] =
+{
+  {"ubyte, grey, default selector", WLZ_GREY_UBYTE, 1, 0, 255, 255, 255, 255},
+  {"ubyte, RGB, default selector",  WLZ_GREY_UBYTE, 3, 0, 255, 255, 255, 255},
+  {"ubyte, RGB, coloured opaque",   WLZ_GREY_UBYTE, 3, 0, 255, 255, 128, 0},
+  {"ubyte, RGBA, 50% alpha",        WLZ_GREY_UBYTE, 4, 3, 128, 255, 0, 0},
+  {"short, RGB, default selector",  WLZ_GREY_SHORT, 3, 0, 255, 255, 255, 255},
+  {"int, RGBA, 50% alpha",          WLZ_GREY_INT, 4, 3, 128, 255, 0, 0},
+  {"float, RGB, coloured opaque",   WLZ_GREY_FLOAT, 3, 0, 255, 255, 128, 0},
+  {"long, RGBA, 50% alpha",         WLZ_GREY_LONG, 4, 3, 128, 255, 0, 0},
+  {"double, RGBA, 50% alpha",       WLZ_GREY_DOUBLE, 4, 3, 128, 255, 0, 0},
+  {"rgba, RGBA, 50% alpha",         WLZ_GREY_RGBA, 4, 3, 128, 255, 255, 255}
+};
+
+/*!
+* \return	Wall clock time in seconds.
+* \ingroup	WlzIIPServer
+* \brief	Returns the wall clock time.
+*/
+static double	WlzCompositorBenchTime(void)
+{
+  struct timeval tv;
+
+  (void )gettimeofday(&tv, NULL);
+  return((double )(tv.tv_sec) + (1.0e-6 * tv.tv_usec));
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Composites grey values into the buffer in floating point,
+* 		as convertValueObjToRGB() did before the compositor.
+* \param	buf			Destination buffer.
+* \param	src			Source values.
+* \param	n			Number of values.
+* \param	c			Case giving the layout and selector.
+*/
+template <class T> static void WlzCompositorBenchFloat(
+				  WlzUByte *buf, const T *src, int n,
+				  const WlzCompositorBenchCase *c)
+{
+  int		i;
+  float		gray,
+  		fAlphaPrev;
+  const int	copyGreyToRGB = (c->nCh > 2);
+  const float	fA = c->a / 255.0f,
+  		fR = c->r / 255.0f,
+		fG = c->g / 255.0f,
+		fB = c->b / 255.0f;
+
+  for(i = 0; i < n; ++i)
+  {
+    int boff = i * c->nCh;
+
+    gray = src[i] * fA;
+    buf[boff] = (WlzUByte )(gray * fR + buf[boff] * (1 - fA));
+    if(copyGreyToRGB)
+    {
+      buf[boff + 1] = (WlzUByte )(gray * fG + buf[boff + 1] * (1 - fA));
+      buf[boff + 2] = (WlzUByte )(gray * fB + buf[boff + 2] * (1 - fA));
+    }
+    if(c->alphaOff > 0)
+    {
+      fAlphaPrev = buf[boff + c->alphaOff] / 255.0f;
+      buf[boff + c->alphaOff] = (WlzUByte )(round((fA + fAlphaPrev -
+					    fAlphaPrev * fA) * 255.0));
+    }
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Composites RGBA values into the buffer in floating point,
+* 		as convertValueObjToRGB() did before the compositor.
+* \param	buf			Destination buffer.
+* \param	src			Source values.
+* \param	n			Number of values.
+* \param	c			Case giving the layout and selector.
+*/
+static void	WlzCompositorBenchFloatRGBA(WlzUByte *buf, const WlzUInt *src,
+					    int n,
+					    const WlzCompositorBenchCase *c)
+{
+  int		i;
+  float		fAlphaPrev,
+  		fANew;
+  const float	fA = c->a / 255.0f,
+  		fR = c->r / 255.0f,
+		fG = c->g / 255.0f,
+		fB = c->b / 255.0f;
+
+  for(i = 0; i < n; ++i)
+  {
+    WlzUInt	val = src[i];
+    int		boff = i * c->nCh;
+
+    buf[boff] = (WlzUByte )(WLZ_RGBA_RED_GET(val) * fA * fR +
+			    buf[boff] * (1 - fA));
+    buf[boff + 1] = (WlzUByte )(WLZ_RGBA_GREEN_GET(val) * fA * fG +
+				buf[boff + 1] * (1 - fA));
+    buf[boff + 2] = (WlzUByte )(WLZ_RGBA_BLUE_GET(val) * fA * fB +
+				buf[boff + 2] * (1 - fA));
+    if(c->nCh == 4)
+    {
+      fAlphaPrev = buf[boff + c->alphaOff] / 255.0f;
+      fANew = fA * ((WlzUByte )(WLZ_RGBA_ALPHA_GET(val))) / 255.0f;
+      buf[boff + c->alphaOff] = (WlzUByte )round((fANew + fAlphaPrev -
+						 fAlphaPrev * fANew) * 255.0);
+    }
+  }
+}
+
+/*!
+* \ingroup	WlzIIPServer
+* \brief	Composites the values with the floating point loop for
+* 		their grey type.
+* \param	buf			Destination buffer.
+* \param	src			Source values.
+* \param	n			Number of values.
+* \param	c			Case giving the grey type, layout and
+* 					selector.
+*/
+static void	WlzCompositorBenchFloatAny(WlzUByte *buf, const void *src,
+					   int n,
+					   const WlzCompositorBenchCase *c)
+{
+  switch(c->gType)
+  {
+    case WLZ_GREY_UBYTE:
+      WlzCompositorBenchFloat(buf, (const WlzUByte *)src, n, c);
+      break;
+    case WLZ_GREY_SHORT:
+      WlzCompositorBenchFloat(buf, (const short *)src, n, c);
+      break;
+    case WLZ_GREY_INT:
+      WlzCompositorBenchFloat(buf, (const int *)src, n, c);
+      break;
+    case WLZ_GREY_LONG:
+      WlzCompositorBenchFloat(buf, (const WlzLong *)src, n, c);
+      break;
+    case WLZ_GREY_FLOAT:
+      WlzCompositorBenchFloat(buf, (const float *)src, n, c);
+      break;
+    case WLZ_GREY_DOUBLE:
+      WlzCompositorBenchFloat(buf, (const double *)src, n, c);
+      break;
+    case WLZ_GREY_RGBA:
+      WlzCompositorBenchFloatRGBA(buf, (const WlzUInt *)src, n, c);
+      break;
+    default:
+      break;
+  }
+}
+
+/*!
+* \return	Allocated source values or NULL on error.
+* \ingroup	WlzIIPServer
+* \brief	Allocates n pseudo random values of the grey type, in the
+* 		range of bytes so that no values are clamped.
+* \param	gType			Grey type.
+* \param	n			Number of values.
+*/
+static void	*WlzCompositorBenchValues(WlzGreyType gType, int n)
+{
+  int		i;
+  void		*v = NULL;
+
+  switch(gType)
+  {
+    case WLZ_GREY_UBYTE:
+      if((v = malloc(n * sizeof(WlzUByte))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((WlzUByte *)v)[i] = rand() % 256;
+      }
+      break;
+    case WLZ_GREY_SHORT:
+      if((v = malloc(n * sizeof(short))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((short *)v)[i] = rand() % 256;
+      }
+      break;
+    case WLZ_GREY_INT:
+      if((v = malloc(n * sizeof(int))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((int *)v)[i] = rand() % 256;
+      }
+      break;
+    case WLZ_GREY_LONG:
+      if((v = malloc(n * sizeof(WlzLong))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((WlzLong *)v)[i] = rand() % 256;
+      }
+      break;
+    case WLZ_GREY_FLOAT:
+      if((v = malloc(n * sizeof(float))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((float *)v)[i] = rand() % 256;
+      }
+      break;
+    case WLZ_GREY_DOUBLE:
+      if((v = malloc(n * sizeof(double))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((double *)v)[i] = rand() % 256;
+      }
+      break;
+    case WLZ_GREY_RGBA:
+      if((v = malloc(n * sizeof(WlzUInt))) != NULL)
+      {
+        for(i = 0; i < n; ++i) ((WlzUInt *)v)[i] = rand();
+      }
+      break;
+    default:
+      break;
+  }
+  return(v);
+}
+
+/*!
+* \return	Maximum absolute difference between the buffers.
+* \ingroup	WlzIIPServer
+* \brief	Compares two buffers.
+* \param	b0			First buffer.
+* \param	b1			Second buffer.
+* \param	n			Number of bytes.
+*/
+static int	WlzCompositorBenchDiff(const WlzUByte *b0, const WlzUByte *b1,
+				       int n)
+{
+  int		i,
+  		d = 0;
+
+  for(i = 0; i < n; ++i)
+  {
+    d = WLZ_MAX(d, abs((int )(b0[i]) - (int )(b1[i])));
+  }
+  return(d);
+}
+
+/*!
+* \return	Non zero on success.
+* \ingroup	WlzIIPServer
+* \brief	Times the floating point loop, the scalar compositor and
+* 		the compositor for the host's instruction set on a case
+* 		and prints the rates and the largest differences between
+* 		their outputs.
+* \param	c			Case to measure.
+* \param	n			Number of values in the interval.
+* \param	nRep			Number of times each is repeated.
+*/
+static int	WlzCompositorBench(const WlzCompositorBenchCase *c,
+				   int n, int nRep)
+{
+  int		i,
+  		ok = 0;
+  double	t0,
+  		t1,
+		t2,
+		t3;
+  const int	nCol = (c->nCh > 2)? 3: 1;
+  const int	sz = n * c->nCh;
+  void		*src = WlzCompositorBenchValues(c->gType, n);
+  WlzUByte	*b0 = (WlzUByte *)malloc(sz),
+  		*b1 = (WlzUByte *)malloc(sz),
+		*b2 = (WlzUByte *)malloc(sz);
+  Compositor	scalar(c->gType, c->nCh, nCol, c->alphaOff,
+		       c->a, c->r, c->g, c->b, COMPOSITOR_ISA_SCALAR),
+		best(c->gType, c->nCh, nCol, c->alphaOff,
+		     c->a, c->r, c->g, c->b);
+
+  if(src && b0 && b1 && b2 && scalar.isValid() && best.isValid())
+  {
+    ok = 1;
+    for(i = 0; i < sz; ++i)
+    {
+      b0[i] = b1[i] = b2[i] = rand() % 256;
+    }
+    /* Compare the outputs of a single pass over the same buffer. */
+    WlzCompositorBenchFloatAny(b0, src, n, c);
+    scalar.composite(b1, src, n);
+    best.composite(b2, src, n);
+    (void )printf("%-30s max diff from float %d, from scalar %d\n",
+		  c->name, WlzCompositorBenchDiff(b0, b1, sz),
+		  WlzCompositorBenchDiff(b1, b2, sz));
+    t0 = WlzCompositorBenchTime();
+    for(i = 0; i < nRep; ++i)
+    {
+      WlzCompositorBenchFloatAny(b0, src, n, c);
+    }
+    t1 = WlzCompositorBenchTime();
+    for(i = 0; i < nRep; ++i)
+    {
+      scalar.composite(b1, src, n);
+    }
+    t2 = WlzCompositorBenchTime();
+    for(i = 0; i < nRep; ++i)
+    {
+      best.composite(b2, src, n);
+    }
+    t3 = WlzCompositorBenchTime();
+    {
+      const double mPix = (double )n * nRep / 1.0e6;
+
+      (void )printf("%-30s float %8.0f, scalar %8.0f, %-6s %8.0f"
+		    " Mpixels/s\n",
+		    "", mPix / (t1 - t0), mPix / (t2 - t1),
+		    Compositor::getISAName(Compositor::getISA()),
+		    mPix / (t3 - t2));
+    }
+  }
+  else
+  {
+    (void )fprintf(stderr, "failed to set up %s\n", c->name);
+  }
+  free(src);
+  free(b0);
+  free(b1);
+  free(b2);
+  return(ok);
+}
+
+int 		main(int argc, char *argv[])
+{
+  int		i,
+  		option,
+  		ok = 1,
+  		usage = 0,
+		n = 3000,
+		nRep = 3000;
+  static char	optList[] = "hn:r:";
+
+  while((usage == 0) && ((option = getopt(argc, argv, optList)) != EOF))
+  {
+    switch(option)
+    {
+      case 'n':
+        usage = ((n = atoi(optarg)) < 1);
+	break;
+      case 'r':
+        usage = ((nRep = atoi(optarg)) < 1);
+	break;
+      case 'h':
+      default:
+        usage = 1;
+	break;
+    }
+  }
+  ok = (usage == 0) && (optind == argc);
+  usage = !ok;
+  if(ok)
+  {
+    (void )printf("%d values, %d repetitions\n", n, nRep);
+    for(i = 0; ok && (i < (int )(sizeof(WlzCompositorBenchCases) /
+				 sizeof(WlzCompositorBenchCase))); ++i)
+    {
+      ok = WlzCompositorBench(WlzCompositorBenchCases + i, n, nRep);
+    }
+  }
+  if(usage)
+  {
+    (void )fprintf(stderr,
+    "Usage: %s [-h] [-n<values>] [-r<repetitions>]\n"
+    "Measures the rate at which the Woolz IIP server composites grey value\n"
+    "intervals into tile buffers, using the floating point loop which the\n"
+    "compositor replaced, the scalar compositor and the compositor for the\n"
+    "host's instruction set, for a range of grey types, buffer layouts\n"
+    "and selectors. The largest differences between their outputs are\n"
+    "also printed. Options are:\n"
+    "  -n  Number of values in the interval (default 3000).\n"
+    "  -r  Number of times each interval is composited (default 3000).\n"
+    "  -h  Help, prints this usage message.\n",
+    *argv);
+  }
+  return(!ok);
+}
@@ -136,6 +136,9 @@ WlzExp 		*WlzExpMake(unsigned int nParam)
 * \return	Assigned expression or NULL on error.
 * \ingroup	WlzIIPServer
 * \brief	Assigns the given expression by incrementing it's linkcount.
+* 		The linkcount is updated atomically since expressions
+* 		are shared by the copies of view parameters used by the
+* 		request and prefetch threads.
 * \param	exp			Given expression.
 */
 WlzExp		*WlzExpAssign(WlzExp *exp)
@@ -148,7 +151,7 @@ WlzExp		*WlzExpAssign(WlzExp *exp)
     }
     else
     {
-      ++(exp->linkcount);
+      (void )__sync_add_and_fetch(&(exp->linkcount), 1);
     }
   }
   return(exp);
@@ -156,21 +159,19 @@ WlzExp		*WlzExpAssign(WlzExp *exp)
 
 /*!
 * \ingroup	WlzIIPServer
-* \brief	Frees the given expression and any sub expressioons.
+* \brief	Frees the given expression and any sub expressioons,
+* 		once the last link to it has been freed. The linkcount
+* 		is updated atomically, see WlzExpAssign().
 * \param	e			The given expression.
 */
 void 		WlzExpFree(WlzExp *e)
 {
-  if(e)
+  if(e && (e->linkcount >= 0))
   {
     int		idx;
     WlzExpOpParam  *p;
 
-    if(e->linkcount > 1)
-    {
-      --(e->linkcount);
-    }
-    else if(e->linkcount >= 0)
+    if(__sync_sub_and_fetch(&(e->linkcount), 1) <= 0)
     {
       p = e->param;
       e->linkcount = -1;
@@ -45,6 +45,12 @@ static char _WlzImage_cc[] = "University of Edinburgh $Id$";
 #include <WlzProto.h>
 #include <WlzExtFF.h>
 #include "Environment.h"
+#include "CacheKey.h"
+#include "CompressedFile.h"
+#include "MappedObj.h"
+#include "ValueTile.h"
+#include <sys/stat.h>
+#include <unistd.h>
 
 //#define __PERFORMANCE_DEBUG
 #ifdef __PERFORMANCE_DEBUG
@@ -66,6 +72,12 @@ const WlzInterpolationType WlzImage::interp = WLZ_INTERPOLATION_NEAREST;
  */
 WlzObjectCache            WlzImage::wlzObjectCache;
 
+/*!
+ * Objects being read or computed for the object cache, so that
+ * concurrent queries for the same object wait for a single copy.
+ */
+SingleFlight              WlzImage::objectFlights;
+
 
 /*!
  * \ingroup      WlzIIPServer
@@ -76,18 +88,21 @@ WlzObjectCache            WlzImage::wlzObjectCache;
  */
 WlzImage::WlzImage(): IIPImage() { 
   wlzObject         = NULL;
-  tile_buf          = NULL;
   tile_width        = 0;
   tile_height       = 0;
   numResolutions    = 0;
   viewParams        = NULL;
   wlzViewStr        = NULL;
+  memset(levelViewStr, 0, sizeof(levelViewStr));
+  memset(proxyObj, 0, sizeof(proxyObj));
+  memset(proxyViewStr, 0, sizeof(proxyViewStr));
   curViewParams     = NULL;
   number_of_tiles   = 0;
   lastTileWidth     = 0;
   lastTileHeight    = 0;
   ntlx              = 0;
   ntly              = 0; 
+  hashValid         = false;
   
   tile_height       = Environment::getWlzTileHeight();
   tile_width        = Environment::getWlzTileWidth();
@@ -104,18 +119,21 @@ WlzImage::WlzImage(): IIPImage() {
  */
 WlzImage::WlzImage( const std::string& path): IIPImage( path ) {
   wlzObject         = NULL;
-  tile_buf          = NULL;
   tile_width        = 0;
   tile_height       = 0;
   numResolutions    = 0;
   viewParams        = NULL;
   wlzViewStr        = NULL;
+  memset(levelViewStr, 0, sizeof(levelViewStr));
+  memset(proxyObj, 0, sizeof(proxyObj));
+  memset(proxyViewStr, 0, sizeof(proxyViewStr));
   curViewParams     = NULL;
   number_of_tiles   = 0;
   lastTileWidth     = 0;
   lastTileHeight    = 0;
   ntlx              = 0;
   ntly              = 0;
+  hashValid         = false;
   
   tile_height       = Environment::getWlzTileHeight();
   tile_width        = Environment::getWlzTileWidth();
@@ -133,17 +151,26 @@ WlzImage:: WlzImage( const WlzImage& image ): IIPImage( image ) {
   
   wlzObject = WlzAssignObject(image.wlzObject , NULL);
   
-  tile_buf          = NULL;
   tile_width        = image.tile_width; 
   tile_height       = image.tile_height;
   numResolutions    = image.numResolutions;
   viewParams        = image.viewParams;
   wlzViewStr        = image.wlzViewStr;
+  for(int l = 0; l < WLZIMAGE_MAX_RESOLUTIONS; ++l)
+  {
+    levelViewStr[l] = (image.levelViewStr[l])?
+                      WlzAssign3DViewStruct(image.levelViewStr[l], NULL): NULL;
+    proxyObj[l] = (image.proxyObj[l])?
+                  WlzAssignObject(image.proxyObj[l], NULL): NULL;
+    proxyViewStr[l] = (image.proxyViewStr[l])?
+                      WlzAssign3DViewStruct(image.proxyViewStr[l], NULL): NULL;
+  }
   number_of_tiles   = image.number_of_tiles;
   lastTileWidth     = image.lastTileWidth; 
   lastTileHeight    = image.lastTileHeight;
   ntlx              = image.ntlx;
   ntly              = image.ntly; 
+  hashValid         = false;
   tile_height       = image.tile_height;
   tile_width        = image.tile_width;
   
@@ -168,7 +195,7 @@ WlzImage:: WlzImage( const WlzImage& image ): IIPImage( image ) {
 void WlzImage::openImage()
 {
   // if already opened do not reopen
-  if( wlzObject || tile_buf ){
+  if( wlzObject ){
     return;
   }
   loadImageInfo( 0, 0 );
@@ -202,79 +229,495 @@ throw(string)
   }
   prepareObject();  //make sure object is loaded
   //generate cache hash
-  string hash = generateHash(viewParams);
+  string hash = getViewHash();
   LOG_DEBUG("WlzImage::prepareViewStruct() hash:" << hash);
   if(wlzViewStr != NULL)
   {
     WlzFree3DViewStruct(wlzViewStr);
+    wlzViewStr = NULL;
   }
-  wlzViewStr = WlzAssign3DViewStruct(wlzObjectCache.getVS(hash), NULL);
-  if (wlzViewStr == NULL)  // cache miss?
+  wlzViewStr = makeViewStruct(hash, viewParams->scale);
+  return;
+}
+
+/*!
+ * \return       View structure with incremented link count.
+ * \ingroup      WlzIIPServer
+ * \brief        Gets a view structure for the current view parameters,
+ * 		 but with the given scale, either from the view structure
+ * 		 cache or by computing it and adding it to the cache.
+ * 		 If an object sampled from the current object is given
+ * 		 the view structure sections it in the same place as the
+ * 		 current object would be sectioned.
+ * \param        hash		Cache key of the view structure.
+ * \param        scale		Scale of the view structure.
+ * \param        obj		Object sampled from the current object
+ * 				by the given factor, NULL for the current
+ * 				object.
+ * \param        factor		Sampling factor of the given object.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+WlzThreeDViewStruct *WlzImage::makeViewStruct(const string &hash, double scale,
+					      WlzObject *obj, int factor)
+throw(string)
+{
+  WlzThreeDViewStruct *vs = NULL;
+  WlzErrorNum errNum = WLZ_ERR_NONE;
+
+  vs = wlzObjectCache.getVS(hash);
+  if (vs == NULL)  // cache miss?
   {
     
-    if((wlzViewStr = WlzAssign3DViewStruct(
+    if((vs = WlzAssign3DViewStruct(
                      WlzMake3DViewStruct(WLZ_3D_VIEW_STRUCT, &errNum),
 		                          NULL )) != NULL)
     {
-      wlzViewStr->theta           = viewParams->yaw   * WLZ_M_PI / 180.0;
-      wlzViewStr->phi             = viewParams->pitch * WLZ_M_PI / 180.0;
-      wlzViewStr->zeta            = viewParams->roll  * WLZ_M_PI / 180.0;
-      wlzViewStr->dist            = viewParams->dist;
-      wlzViewStr->fixed           = viewParams->fixed;
-      wlzViewStr->fixed_2         = viewParams->fixed2;
-      wlzViewStr->up              = viewParams->up;
-      wlzViewStr->view_mode       = viewParams->mode;
-      wlzViewStr->scale           = viewParams->scale;
-      wlzViewStr->voxelRescaleFlg = 0x01 | 0x02;  // Set if voxel size
-                                                  // correciton is needed.
+      vs->theta           = viewParams->yaw   * WLZ_M_PI / 180.0;
+      vs->phi             = viewParams->pitch * WLZ_M_PI / 180.0;
+      vs->zeta            = viewParams->roll  * WLZ_M_PI / 180.0;
+      vs->dist            = viewParams->dist;
+      vs->fixed           = viewParams->fixed;
+      vs->fixed_2         = viewParams->fixed2;
+      if(factor > 1)
+      {
+        // The fixed points are in the voxels of the current object.
+        WLZ_VTX_3_SCALE(vs->fixed, vs->fixed, 1.0 / factor);
+        WLZ_VTX_3_SCALE(vs->fixed_2, vs->fixed_2, 1.0 / factor);
+      }
+      vs->up              = viewParams->up;
+      vs->view_mode       = viewParams->mode;
+      vs->scale           = scale;
+      vs->voxelRescaleFlg = 0x01 | 0x02;  // Set if voxel size
+                                          // correciton is needed.
     }
     else
     {
       throw(
-      makeWlzErrorMessage("WlzImage::prepareViewStruct() creation failed.",
+      makeWlzErrorMessage("WlzImage::makeViewStruct() creation failed.",
                           errNum));
     }
-    if(wlzObject->type == WLZ_COMPOUND_ARR_2)
+    if(obj == NULL)
     {
-      WlzCompoundArray *array = (WlzCompoundArray *)wlzObject;
-      WlzObject *obj = array->o[0];
+      obj = wlzObject;
+    }
+    if(obj->type == WLZ_COMPOUND_ARR_2)
+    {
+      WlzCompoundArray *array = (WlzCompoundArray *)obj;
+      obj = array->o[0];
       if(array && array->n>0 && obj)
       {
 	if(obj->domain.p)
 	{
-	  wlzViewStr->voxelSize[0]    = obj->domain.p->voxel_size[0];
-	  wlzViewStr->voxelSize[1]    = obj->domain.p->voxel_size[1];
-	  wlzViewStr->voxelSize[2]    = obj->domain.p->voxel_size[2];
+	  vs->voxelSize[0]    = obj->domain.p->voxel_size[0];
+	  vs->voxelSize[1]    = obj->domain.p->voxel_size[1];
+	  vs->voxelSize[2]    = obj->domain.p->voxel_size[2];
 	}
-	errNum = WlzInit3DViewStruct(wlzViewStr, array->o[0]);
+	errNum = WlzInit3DViewStruct(vs, array->o[0]);
       }
       else
       {
+	WlzFree3DViewStruct(vs);
 	throw(
 	makeWlzErrorMessage(
-	  "WlzImage::prepareViewStruct() can't find object to prepare "
+	  "WlzImage::makeViewStruct() can't find object to prepare "
 	  "ViewStruct.", errNum));
       }
     }
     else
     {
-      if(wlzObject && wlzObject->domain.p)
+      if(obj->domain.p)
       {
-	wlzViewStr->voxelSize[0]    = wlzObject->domain.p->voxel_size[0];
-	wlzViewStr->voxelSize[1]    = wlzObject->domain.p->voxel_size[1];
-	wlzViewStr->voxelSize[2]    = wlzObject->domain.p->voxel_size[2];
+	vs->voxelSize[0]    = obj->domain.p->voxel_size[0];
+	vs->voxelSize[1]    = obj->domain.p->voxel_size[1];
+	vs->voxelSize[2]    = obj->domain.p->voxel_size[2];
       }
-      errNum = WlzInit3DViewStruct(wlzViewStr, wlzObject);
+      errNum = WlzInit3DViewStruct(vs, obj);
     }
     if(errNum != WLZ_ERR_NONE)
     {
+      WlzFree3DViewStruct(vs);
       throw(
       makeWlzErrorMessage(
-        "WlzImage::prepareViewStruct() failed.", errNum));
+        "WlzImage::makeViewStruct() failed.", errNum));
+    }
+    wlzObjectCache.insert(vs , hash);
+  }
+  return(vs);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Prepares the view structures of the reduced resolution
+ * 		 levels of the current view. Level l is sectioned at 1/2^l
+ * 		 of the view's scale, so that the resolution numbers of
+ * 		 tile requests select fewer and cheaper pixels. The number
+ * 		 of resolutions is chosen so that the lowest resolution
+ * 		 fits within a single tile, up to WLZ_MAX_RESOLUTIONS.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void WlzImage::prepareLevels()
+throw(string)
+{
+  int maxRes = Environment::getWlzMaxResolutions();
+
+  freeLevels();
+  if(maxRes > WLZIMAGE_MAX_RESOLUTIONS)
+  {
+    maxRes = WLZIMAGE_MAX_RESOLUTIONS;
+  }
+  numResolutions = 1;
+  while((numResolutions < maxRes) &&
+        (((image_width >> (numResolutions - 1)) > tile_width) ||
+	 ((image_height >> (numResolutions - 1)) > tile_height)))
+  {
+    ++numResolutions;
+  }
+  for(int l = 1; l < numResolutions; ++l)
+  {
+    char	buf[32];
+
+    snprintf(buf, 32, "RES=%d,", l);
+    levelViewStr[l] = makeViewStruct(string(buf) + getViewHash(),
+                                     viewParams->scale / (double )(1 << l));
+  }
+  prepareProxies();
+}
+
+/*!
+ * \return       File name of the copy.
+ * \ingroup      WlzIIPServer
+ * \brief        Makes the name of a preprocessed copy of an object file,
+ * 		 which is named by a hash of the file name, see
+ * 		 MappedObjCopyName().
+ * \param        dir		Directory of the copies.
+ * \param        filename	Object file name.
+ * \param        ext		File name extension of the copy.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+string WlzImage::getCopyName(const string &dir, const string &filename,
+			     const char *ext)
+{
+  return(MappedObjCopyName(dir, filename, ext));
+}
+
+/*!
+ * \return       Object read from the file, with its intervals and grey
+ * 		 values in a memory mapped file where possible, or NULL if
+ * 		 mapped copies are not enabled or the file can not be read.
+ * \ingroup      WlzIIPServer
+ * \brief        Maps the mapped copy (see MappedObjRead()) of an object
+ * 		 file from the mapped object directory (WLZ_MAPPED_DIR),
+ * 		 so that the object is available without parsing or
+ * 		 copying and its pages are shared through the page cache
+ * 		 by all server processes. Mapped copies are made offline
+ * 		 using WlzMapObj. Only if WLZ_MAPPED_MAKE is set and there
+ * 		 is no up to date copy, is a file holding a 3D domain
+ * 		 object read and written as a mapped copy, which is then
+ * 		 mapped in its place. Since this is done by the request
+ * 		 which first reads the file it is not done by default.
+ * \param        filename	Object file name.
+ * \param        mapped		Set to true if the object returned is
+ * 				mapped.
+ * \param        dstErr		Destination error pointer, may be NULL.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+WlzObject *WlzImage::readMappedObj(const string &filename, bool &mapped,
+				   WlzErrorNum *dstErr)
+{
+  struct stat	srcStat,
+  		mpStat;
+  FILE		*fP = NULL;
+  WlzObject	*obj = NULL,
+  		*mpObj = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+  const string	dir = Environment::getWlzMappedDir();
+
+  mapped = false;
+  if(dir.empty() || (stat(filename.c_str(), &srcStat) != 0))
+  {
+    return(NULL);
+  }
+  const string	mpName = getCopyName(dir, filename, MAPPEDOBJ_EXT);
+  // Use an existing mapped copy which is newer than the file.
+  if((stat(mpName.c_str(), &mpStat) == 0) &&
+     (mpStat.st_mtime >= srcStat.st_mtime) &&
+     ((mpObj = MappedObjRead(mpName.c_str(), NULL)) != NULL))
+  {
+    LOG_DEBUG("WlzImage::readMappedObj() mapped " << mpName <<
+	      " for " << filename);
+    mapped = true;
+    return(mpObj);
+  }
+  if(!Environment::getWlzMappedMake())
+  {
+    return(NULL);
+  }
+  // Otherwise make one if the file holds a 3D domain object.
+  if((fP = CompressedFileOpen(filename)) != NULL)
+  {
+    obj = WlzEffReadObj(fP, NULL, WLZEFF_FORMAT_WLZ, 0, 0, 0, &errNum);
+    (void )fclose(fP);
+  }
+  if((errNum == WLZ_ERR_NONE) && obj && (obj->type == WLZ_3D_DOMAINOBJ))
+  {
+    char	pStr[32];
+
+    // Write to a temporary file and rename it so that other
+    // processes never map a partial copy.
+    (void )snprintf(pStr, 32, ".%d", (int )getpid());
+    const string tmpName = mpName + pStr;
+    if((MappedObjWrite(tmpName.c_str(), obj) == WLZ_ERR_NONE) &&
+       (rename(tmpName.c_str(), mpName.c_str()) == 0))
+    {
+      mpObj = MappedObjRead(mpName.c_str(), NULL);
+    }
+    (void )unlink(tmpName.c_str());
+    if(mpObj)
+    {
+      LOG_INFO("WlzImage::readMappedObj() wrote " << mpName <<
+	       " for " << filename);
+      (void )WlzFreeObj(obj);
+      obj = mpObj;
+      mapped = true;
+    }
+    else
+    {
+      LOG_WARN("WlzImage::readMappedObj() failed to make " << mpName <<
+	       " for " << filename);
+    }
+  }
+  if(dstErr)
+  {
+    *dstErr = errNum;
+  }
+  return(obj);
+}
+
+/*!
+ * \return       Object read from the file, with memory mapped tiled values
+ * 		 where possible, or NULL if tiled copies are not enabled
+ * 		 or the file can not be read.
+ * \ingroup      WlzIIPServer
+ * \brief        Reads the tiled copy of an object file from the tiled
+ * 		 object directory (WLZ_TILED_DIR), so that only the tiles
+ * 		 of grey values which are used become resident and they
+ * 		 are shared through the page cache by all server
+ * 		 processes. Tiled copies are made offline using WlzMapObj
+ * 		 and are named by a hash of the file name, see
+ * 		 MappedObjCopyName(). A copy is only used if it is newer
+ * 		 than the file.
+ * \param        filename	Object file name.
+ * \param        dstErr		Destination error pointer, may be NULL.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+WlzObject *WlzImage::readTiledObj(const string &filename, WlzErrorNum *dstErr)
+{
+  struct stat	srcStat,
+  		tlStat;
+  FILE		*fP = NULL;
+  WlzObject	*tlObj = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+  const string	dir = Environment::getWlzTiledDir();
+
+  if(dir.empty() || (stat(filename.c_str(), &srcStat) != 0))
+  {
+    return(NULL);
+  }
+  const string	tlName = getCopyName(dir, filename, MAPPEDOBJ_TILED_EXT);
+  if((stat(tlName.c_str(), &tlStat) == 0) &&
+     (tlStat.st_mtime >= srcStat.st_mtime) &&
+     ((fP = fopen(tlName.c_str(), "r")) != NULL))
+  {
+    tlObj = WlzReadObj(fP, &errNum);
+    (void )fclose(fP);
+    if(tlObj)
+    {
+      LOG_DEBUG("WlzImage::readTiledObj() read " << tlName <<
+                " for " << filename);
+    }
+    else
+    {
+      LOG_WARN("WlzImage::readTiledObj() failed to read " << tlName <<
+               " for " << filename);
+    }
+  }
+  if(dstErr)
+  {
+    *dstErr = WLZ_ERR_NONE;
+  }
+  return(tlObj);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Chooses, for each resolution level of a section view,
+ * 		 the coarsest proxy of the current object whose voxels are
+ * 		 no larger than the level's pixels and prepares its view
+ * 		 structure. The largest voxel dimension of the object is
+ * 		 used, so that a proxy is never coarser than the level
+ * 		 along any axis. Proxies are point sampled from the current
+ * 		 object by factors of 2, 4 and 8, up to WLZ_MAX_PROXY,
+ * 		 and are kept in the object cache.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void WlzImage::prepareProxies()
+throw(string)
+{
+  int maxFactor = Environment::getWlzMaxProxy();
+
+  if((maxFactor < 2) || (viewParams->rmd != RENDERMODE_SECT) ||
+     (wlzObject == NULL) || (wlzObject->type != WLZ_3D_DOMAINOBJ) ||
+     (wlzObject->values.core == NULL))
+  {
+    return;
+  }
+  if(maxFactor > WLZIMAGE_MAX_PROXY)
+  {
+    maxFactor = WLZIMAGE_MAX_PROXY;
+  }
+  double	maxVoxSz = 0.0;
+  const float	*voxSz = wlzObject->domain.p->voxel_size;
+
+  for(int i = 0; i < 3; ++i)
+  {
+    maxVoxSz = WLZ_MAX(maxVoxSz, voxSz[i]);
+  }
+  if(maxVoxSz <= 0.0)
+  {
+    maxVoxSz = 1.0;
+  }
+  for(int l = 0; l < numResolutions; ++l)
+  {
+    int		factor = 1;
+    const double scale = viewParams->scale / (double )(1 << l);
+
+    while(((factor * 2) <= maxFactor) &&
+          ((maxVoxSz * factor * 2) <= (1.0 / scale)))
+    {
+      factor *= 2;
+    }
+    if(factor > 1)
+    {
+      char	buf[32];
+      WlzErrorNum errNum = WLZ_ERR_NONE;
+
+      proxyObj[l] = getProxyObj(factor, &errNum);
+      if(errNum != WLZ_ERR_NONE)
+      {
+	throw(
+	makeWlzErrorMessage(
+	  "WlzImage::prepareProxies() failed to sample object.", errNum));
+      }
+      snprintf(buf, 32, "PROXY=%d,RES=%d,", factor, l);
+      proxyViewStr[l] = makeViewStruct(string(buf) + getViewHash(),
+                                       scale, proxyObj[l], factor);
+    }
+  }
+}
+
+/*!
+ * \return       Proxy object with incremented link count.
+ * \ingroup      WlzIIPServer
+ * \brief        Gets a proxy of the current object, which is point sampled
+ * 		 by the given factor along each axis and has its voxel size
+ * 		 scaled up by the same factor, either from the object cache
+ * 		 or by sampling it and adding it to the cache.
+ * \param        factor		Sampling factor.
+ * \param        dstErr		Destination error pointer, may be NULL.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+WlzObject *WlzImage::getProxyObj(int factor, WlzErrorNum *dstErr)
+{
+  char		buf[32];
+  WlzObject	*obj = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  snprintf(buf, 32, "&PROXY=%d", factor);
+  const string proxyS = getFileName() + string(buf);
+  SingleFlight::Guard flight(objectFlights);
+  // Increments the objects linkcount.
+  while(((obj = getObjectFromCache(proxyS)) == NULL) &&
+        !flight.begin(proxyS))
+  {
+  }
+  if(obj == NULL)
+  {
+    WlzIVertex3 samFac;
+
+    samFac.vtX = samFac.vtY = samFac.vtZ = factor;
+    obj = WlzAssignObject(
+          WlzSampleObj(wlzObject, samFac, WLZ_SAMPLEFN_POINT, &errNum), NULL);
+    if(errNum == WLZ_ERR_NONE)
+    {
+      WlzPlaneDomain *pDom = obj->domain.p;
+
+      for(int i = 0; i < 3; ++i)
+      {
+        pDom->voxel_size[i] = wlzObject->domain.p->voxel_size[i] * factor;
+      }
+      addObjectToCache(obj, proxyS);
+      LOG_DEBUG("WlzImage::getProxyObj() sampled " << proxyS);
+    }
+  }
+  if(dstErr)
+  {
+    *dstErr = errNum;
+  }
+  return(obj);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Releases the view structures of the reduced resolution
+ * 		 levels and the proxies of the current object.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void WlzImage::freeLevels()
+{
+  for(int l = 0; l < WLZIMAGE_MAX_RESOLUTIONS; ++l)
+  {
+    if(levelViewStr[l] != NULL)
+    {
+      WlzFree3DViewStruct(levelViewStr[l]);
+      levelViewStr[l] = NULL;
+    }
+    if(proxyViewStr[l] != NULL)
+    {
+      WlzFree3DViewStruct(proxyViewStr[l]);
+      proxyViewStr[l] = NULL;
+    }
+    if(proxyObj[l] != NULL)
+    {
+      (void )WlzFreeObj(proxyObj[l]);
+      proxyObj[l] = NULL;
     }
-    wlzObjectCache.insert(wlzViewStr , hash);
   }
-  return;
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Gets the size of the view at a resolution level, which
+ * 		 is halved (rounding down) for each level as by View.
+ * \param        level		Resolution level, 0 being the full
+ * 				resolution.
+ * \param        width		Destination for the width.
+ * \param        height	Destination for the height.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void WlzImage::getLevelSize(int level, unsigned int &width,
+                            unsigned int &height)
+{
+  width = image_width >> level;
+  height = image_height >> level;
 }
 
 /*!
@@ -294,11 +737,15 @@ throw(string)
   if(!wlzObject)
   {
     string filename;
-    int usepipe = 0;
+    bool mapped = false;
     LOG_DEBUG("WlzImage::prepareObject() reloading");
     //check cache first
     filename = getFileName( );
-    wlzObject  = WlzAssignObject(wlzObjectCache.get(filename), NULL);
+    // Only one query reads an object, others wait for it to be cached
+    SingleFlight::Guard flight(objectFlights);
+    while (((wlzObject = wlzObjectCache.get(filename)) == NULL) &&
+           !flight.begin(filename)) {
+    }
 #ifdef __PERFORMANCE_DEBUG
     struct timeval tVal;
     struct timeval tVal2;
@@ -310,24 +757,21 @@ throw(string)
     if (wlzObject == NULL)  // cache miss?
     {
       // if not in cache then load
-      FILE *fp = NULL;
-      if (filename.substr(filename.length()-3, 3) == ".gz") {
-	string command = "gunzip -c ";
-	command += filename;
-	fp = popen( command.c_str(), "r");
-	usepipe = 1;
-      } else
-	fp = fopen(filename.c_str(), "r");
-      
-      if (fp)
-	wlzObject = WlzEffReadObj( fp , NULL, WLZEFF_FORMAT_WLZ,
-	                           0, 0, 0, &errNum );
-      
-      if (fp) {
-	if (usepipe)
-	  pclose(fp);
-	else
+      // Objects may have a mapped copy and large objects may
+      // have a memory mapped tiled copy
+      wlzObject = readMappedObj(filename, mapped, &errNum);
+      if (wlzObject == NULL) {
+	wlzObject = readTiledObj(filename, &errNum);
+      }
+      if (wlzObject == NULL) {
+	// Compressed objects are decompressed in process
+	FILE *fp = CompressedFileOpen(filename);
+	
+	if (fp) {
+	  wlzObject = WlzEffReadObj( fp , NULL, WLZEFF_FORMAT_WLZ,
+				     0, 0, 0, &errNum );
 	  fclose(fp);
+	}
       }
       
 #ifdef __ALLOW_REMOTE_FILE
@@ -383,7 +827,7 @@ throw(string)
 	    throw("WlzImage::prepareObject() failed to read object "
 	          "from file " + filename + ".");
 	  }
-	  wlzObjectCache.insert(wlzObject , filename);
+	  wlzObjectCache.insert(wlzObject , filename, mapped);
     }
 #ifdef __PERFORMANCE_DEBUG
     gettimeofday(&tVal2, NULL);
@@ -563,7 +1007,8 @@ throw(string)
               number_of_tiles);
     
     
-    numResolutions = 1; // resoltions. currently only one resolution is used.
+    // Reduced resolution levels of the view.
+    prepareLevels();
     
     // Update current sections view status
     if (curViewParams == NULL)
@@ -592,22 +1037,18 @@ throw(string)
  *                WlzImage.cc
  */
 void WlzImage::closeImage() {
-  // free tile temporary data
-  if( tile_buf != NULL ){
-    free(tile_buf);
-    tile_buf = NULL;
-  }
-  
   // release view
   if( wlzViewStr != NULL ){
     WlzFree3DViewStruct( wlzViewStr ); 
     wlzViewStr  = NULL;
   }
+  freeLevels();
   
-  // release object 
+  // release object, unmapping it if this was the last use of a mapped one
   if( wlzObject != NULL ){
     WlzFreeObj( wlzObject );
     wlzObject = NULL;
+    MappedObjRelease();
   }
   
   // release current object parameters
@@ -618,48 +1059,101 @@ void WlzImage::closeImage() {
 }
 
 /*!
-* \return       Woolz error code.
+* \return       Rendered 2D object, which has been assigned, or NULL on
+* 		error.
 * \ingroup      WlzIIPServer
-* \brief	Renders a Woolz object by either sectioning or projecting
-* 		the given 3D object to generate a single tile in tile_buf
-* 		for the tileing given by tileObj.
-* \param        tileBuf   allocated memmory location for the tile
+* \brief	Sections or projects the given 3D object, as set by the
+* 		rendering mode, within the given tile domain.
 * \param        gvnObj	   The given 3D woolz object to render.
 * \param        tileObj    Given tile object set up for the requested tile.
-* \param        pos        Section bounding box origin.
-* \param        size       Section bounding box size.
-* \param        sel        Selector with the colour to be used for the section.
+* \param        sel        Selector (required for the cache string).
+* \param        level      Resolution level, 0 being the full resolution.
+* \param	dstErr	   Destination error pointer, may be NULL.
 */
-WlzErrorNum			WlzImage::renderObj(
-				  WlzUByte *tileBuf,
+WlzObject			*WlzImage::renderSection(
 				  WlzObject *gvnObj,
                     		  WlzObject *tileObj,
-				  WlzIVertex2  pos,
-		    		  WlzIVertex2 size,
-				  CompoundSelector *sel)
+				  CompoundSelector *sel,
+				  int level,
+				  WlzErrorNum *dstErr)
 {
   WlzObject 	*renObj = NULL;
   WlzErrorNum 	errNum = WLZ_ERR_NONE;
-  const int	dither = 0;
 
-  // Render the object for the given tile domain.
   switch(viewParams->rmd)
   {
     case RENDERMODE_SECT:
-      renObj = WlzAssignObject(
-	       WlzGetSubSectionFromObject(gvnObj, tileObj, wlzViewStr, interp,
-					  NULL, &errNum), NULL);
+      {
+	WlzObject	*secObj = gvnObj;
+	WlzThreeDViewStruct *vs = (level > 0)? levelViewStr[level]: wlzViewStr;
+
+	if((gvnObj == wlzObject) && proxyObj[level])
+	{
+	  // A proxy has enough voxels for the level's scale.
+	  secObj = proxyObj[level];
+	  vs = proxyViewStr[level];
+	}
+	if(Environment::getWlzSectionCache())
+	{
+	  renObj = WlzAssignObject(
+		   getSubSectFromObject(secObj, vs, tileObj, sel, level,
+					&errNum), NULL);
+	}
+	else
+	{
+	  renObj = WlzAssignObject(
+		   WlzGetSubSectionFromObject(secObj, tileObj, vs, interp,
+					      NULL, &errNum), NULL);
+	}
+      }
       break;
     case RENDERMODE_PROJ_N: // FALLTHROUGH
     case RENDERMODE_PROJ_D: // FALLTHROUGH
     case RENDERMODE_PROJ_V:
       renObj = WlzAssignObject(
-	       getSubProjFromObject(gvnObj, tileObj, sel, &errNum), NULL);
+	       getSubProjFromObject(gvnObj, tileObj, sel, level, &errNum),
+	       NULL);
       break;
     default:
       errNum = WLZ_ERR_PARAM_DATA;
       break;
   }
+  if(dstErr)
+  {
+    *dstErr = errNum;
+  }
+  return(renObj);
+}
+
+/*!
+* \return       Woolz error code.
+* \ingroup      WlzIIPServer
+* \brief	Renders a Woolz object by either sectioning or projecting
+* 		the given 3D object to generate a single tile in tileBuf
+* 		for the tileing given by tileObj.
+* \param        tileBuf   allocated memmory location for the tile
+* \param        gvnObj	   The given 3D woolz object to render.
+* \param        tileObj    Given tile object set up for the requested tile.
+* \param        pos        Section bounding box origin.
+* \param        size       Section bounding box size.
+* \param        sel        Selector with the colour to be used for the section.
+* \param        level      Resolution level, 0 being the full resolution.
+*/
+WlzErrorNum			WlzImage::renderObj(
+				  WlzUByte *tileBuf,
+				  WlzObject *gvnObj,
+                    		  WlzObject *tileObj,
+				  WlzIVertex2  pos,
+		    		  WlzIVertex2 size,
+				  CompoundSelector *sel,
+				  int level)
+{
+  WlzObject 	*renObj = NULL;
+  WlzErrorNum 	errNum = WLZ_ERR_NONE;
+  const int	dither = 0;
+
+  // Render the object for the given tile domain.
+  renObj = renderSection(gvnObj, tileObj, sel, level, &errNum);
   if(renObj == NULL || errNum != WLZ_ERR_NONE)
   {
     throw(
@@ -683,25 +1177,35 @@ WlzErrorNum			WlzImage::renderObj(
       lutObj = getMapLUTObj(&errNum);
       if(errNum == WLZ_ERR_NONE)
       {
+        CompositorLUT lut;
         WlzGreyType gType,
 		    mGType;
 
 	gType = WlzGreyTypeFromObj(renObj, NULL);
-	mGType = ((nChan > 1) || (gType == WLZ_GREY_RGBA))?
-	         WLZ_GREY_RGBA: WLZ_GREY_UBYTE;
-        mapObj = WlzAssignObject(
-	         WlzLUTTransformObj(renObj, lutObj, mGType,
-	                            0, dither, &errNum), NULL);
+	if((gType != WLZ_GREY_RGBA) && getMapLUT(lutObj, &lut))
+	{
+	  // Map the values through the cached table as they are composited.
+	  errNum = convertValueObjToRGB(tileBuf, renObj, pos, size, sel, &lut);
+	}
+	else
+	{
+	  mGType = ((nChan > 1) || (gType == WLZ_GREY_RGBA))?
+		   WLZ_GREY_RGBA: WLZ_GREY_UBYTE;
+	  mapObj = WlzAssignObject(
+		   WlzLUTTransformObj(renObj, lutObj, mGType,
+				      0, dither, &errNum), NULL);
+	  if(errNum == WLZ_ERR_NONE) {
+	    errNum = convertValueObjToRGB(tileBuf, mapObj, pos, size, sel,
+	                                  NULL);
+	  }
+	}
       }
       (void )WlzFreeObj(lutObj);
-      if(errNum == WLZ_ERR_NONE) {
-        errNum = convertValueObjToRGB(tileBuf, mapObj, pos, size, sel);
-      }
       (void )WlzFreeObj(mapObj);
     }
     else
     {
-      errNum = convertValueObjToRGB(tileBuf, renObj, pos, size, sel);
+      errNum = convertValueObjToRGB(tileBuf, renObj, pos, size, sel, NULL);
     }
   }
   if(errNum != WLZ_ERR_NONE)
@@ -714,6 +1218,97 @@ WlzErrorNum			WlzImage::renderObj(
   return(errNum);
 }
 
+/*!
+* \return	Woolz object or NULL on error.
+* \ingroup	WlzIIPServer
+* \brief	Gets the section of the given object which falls within
+* 		the given tile's domain. The whole section of the view is
+* 		cut once and kept in the object cache, so that the tiles
+* 		of the view are cropped from it rather than each being
+* 		sectioned.
+* \param	gvnObj			Given object to be sectioned.
+* \param	vs			View structure for the given object.
+* \param	tileObj			Object with required tile domain.
+* \param	sel			The selector (required for cache
+* 					string).
+* \param	level			Resolution level, 0 being the full
+* 					resolution.
+* \param	dstErr			Destination error pointer, may be NULL.
+*/
+WlzObject 			*WlzImage::getSubSectFromObject(
+				  WlzObject *gvnObj,
+				  WlzThreeDViewStruct *vs,
+				  WlzObject *tileObj,
+				  CompoundSelector *sel,
+				  int level,
+				  WlzErrorNum *dstErr)
+{
+  char		*eS = NULL;
+  std::string   secS;
+  WlzObject	*secObj = NULL,
+  		*subObj = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  secS = "SEC=" + getHash() + "SEL=";
+  if((eS = WlzExpStr(sel->expression, NULL, NULL)) != NULL)
+  {
+    secS += eS;
+    AlcFree(eS);
+  }
+  if(level > 0)
+  {
+    char	buf[32];
+
+    snprintf(buf, 32, ",RES=%d", level);
+    secS += buf;
+  }
+  SingleFlight::Guard flight(objectFlights);
+  while(((secObj = getObjectFromCache(secS)) == NULL) &&
+        !flight.begin(secS))
+  {
+  }
+  if(secObj == NULL)
+  {
+    secObj = WlzAssignObject(
+	     WlzGetSectionFromObject(gvnObj, vs, interp, &errNum), NULL);
+    if(errNum == WLZ_ERR_NONE)
+    {
+      addObjectToCache(secObj, secS);
+      LOG_DEBUG("WlzImage::getSubSectFromObject() sectioned " << secS);
+    }
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    if(secObj->type == WLZ_EMPTY_OBJ)
+    {
+      subObj = WlzMakeEmpty(&errNum);
+    }
+    else
+    {
+      WlzObject *tmpObj = WlzIntersect2(tileObj, secObj, &errNum);
+      if(errNum == WLZ_ERR_NONE)
+      {
+	if(tmpObj->type == WLZ_EMPTY_OBJ)
+	{
+	  subObj = WlzMakeEmpty(&errNum);
+	}
+	else
+	{
+	  subObj = WlzMakeMain(tmpObj->type, tmpObj->domain, secObj->values,
+			       NULL, NULL, &errNum);
+	}
+      }
+      (void )WlzFreeObj(tmpObj);
+    }
+  }
+  (void )WlzFreeObj(secObj);
+  if(dstErr)
+  {
+    *dstErr = errNum;
+  }
+  return(subObj);
+}
+
 /*!
 * \return	Woolz object or NULL on error.
 * \ingroup	WlzIIPServer
@@ -723,12 +1318,15 @@ WlzErrorNum			WlzImage::renderObj(
 * \param	tileObj			Object with required til domain.
 * \param	sel			The selector (required for cache
 * 					string).
+* \param	level			Resolution level, 0 being the full
+* 					resolution.
 * \param	dstErr			Destination error pointer, may be NULL.
 */
 WlzObject 			*WlzImage::getSubProjFromObject(
 				  WlzObject *gvnObj,
 				  WlzObject *tileObj,
 				  CompoundSelector *sel,
+				  int level,
 				  WlzErrorNum *dstErr)
 {
   std::string 	pS = "S";
@@ -758,7 +1356,18 @@ WlzObject 			*WlzImage::getSubProjFromObject(
   }
   prjS = "PRJ=" + pS + "," + getHash() +
          "SEL=" + WlzExpStr(sel->expression, NULL, NULL);;
-  prjObj = getObjectFromCache(prjS);
+  if(level > 0)
+  {
+    char	buf[32];
+
+    snprintf(buf, 32, ",RES=%d", level);
+    prjS += buf;
+  }
+  SingleFlight::Guard flight(objectFlights);
+  while(((prjObj = getObjectFromCache(prjS)) == NULL) &&
+        !flight.begin(prjS))
+  {
+  }
   if(prjObj == NULL)
   {
 
@@ -767,7 +1376,9 @@ WlzObject 			*WlzImage::getSubProjFromObject(
     if(errNum == WLZ_ERR_NONE)
     {
       t0 = WlzAssignObject(
-	   WlzProjectObjToPlane(gvnObj, wlzViewStr, itm, 1, NULL,
+	   WlzProjectObjToPlane(gvnObj,
+	                        (level > 0)? levelViewStr[level]: wlzViewStr,
+				itm, 1, NULL,
 				&errNum), NULL);
     }
     if(errNum == WLZ_ERR_NONE)
@@ -831,55 +1442,389 @@ WlzObject
   WlzObject	*lutObj = NULL;
   WlzErrorNum	errNum = WLZ_ERR_NONE;
 
-  const ImageMap &map = viewParams->map;
-  if(map.getNChan() > 0)
-  {
-    const string mapS = map.toString();
-    lutObj = getObjectFromCache(mapS);     // Increments the objects linkcount.
-    if(lutObj == NULL)
+  const ImageMap &map = viewParams->map;
+  if(map.getNChan() > 0)
+  {
+    const string mapS = map.toString();
+    lutObj = getObjectFromCache(mapS);     // Increments the objects linkcount.
+    if(lutObj == NULL)
+    {
+      lutObj = WlzAssignObject(map.createLUT(&errNum), NULL);
+      if(errNum == WLZ_ERR_NONE)
+      {
+	addObjectToCache(lutObj, mapS);
+      }
+    }
+  }
+  if(dstErr)
+  {
+    *dstErr = errNum;
+  }
+  return(lutObj);
+}
+
+/*!
+* \return	True if the look up table has been set.
+* \ingroup	WlzIIPServer
+* \brief	Sets a flat look up table which refers to the values of
+* 		the given look up table object, so that the cached object
+* 		can be indexed directly while compositing. The table is
+* 		only valid while the object is.
+* \param	lutObj			Look up table object.
+* \param	lut			Destination look up table.
+*/
+bool
+WlzImage::getMapLUT(WlzObject *lutObj, CompositorLUT *lut)
+{
+  bool		set = false;
+
+  if(lutObj && (lutObj->type == WLZ_LUT) &&
+     lutObj->domain.lut && lutObj->values.lut &&
+     (lutObj->domain.lut->lastbin >= lutObj->domain.lut->bin1))
+  {
+    lut->bin1 = lutObj->domain.lut->bin1;
+    lut->nBin = lutObj->domain.lut->lastbin - lutObj->domain.lut->bin1 + 1;
+    lut->grey = NULL;
+    lut->rgba = NULL;
+    switch(lutObj->values.lut->vType)
+    {
+      case WLZ_GREY_INT:
+	lut->grey = lutObj->values.lut->val.inp;
+	set = true;
+	break;
+      case WLZ_GREY_RGBA:
+	lut->rgba = lutObj->values.lut->val.rgbp;
+	set = true;
+	break;
+      default:
+	break;
+    }
+  }
+  return(set);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Generate the current tile. Once the image information
+ * 		 has been loaded for the current view, tiles may be
+ * 		 generated concurrently since each tile is rendered into
+ * 		 its own buffer. Tiles which can not intersect the object
+ * 		 are just filled with the background.
+ * \param        seq not used
+ * \param        ang not used
+ * \param        res requested resolution, numResolutions - 1 being
+ * 				the full resolution
+ * \param        tile requested tile number
+ * \return       RawTile raw tile data
+ * \par      Source:
+ *                WlzImage.cc
+ */
+RawTile		WlzImage::getTile(int seq, int ang, unsigned int res,
+				  unsigned int tile)
+throw(string)
+{
+  int		level;
+  WlzIVertex2   pos;
+  WlzIVertex2   size;
+  
+  //seq = ang =  res  = 0;
+  // force unused parameters to zero to, facilitate cache match
+  loadImageInfo( 0, 0);
+  getTileRegion(res, tile, level, pos, size);
+  
+  //recompute out channels
+  int outchannels = getNumChannels();
+  WlzUByte *tile_buf = (WlzUByte *)malloc(tile_width * tile_height *
+                                           outchannels);
+  if(tile_buf == NULL)
+  {
+    throw(makeWlzErrorMessage("WlzImage::getTile() tile allocation failed.",
+                              WLZ_ERR_MEM_ALLOC));
+  }
+  if(isRegionEmpty(pos, size, level))
+  {
+    LOG_DEBUG("WlzImage::getTile() empty tile " << tile);
+    for(int i = 0; i < size.vtX * size.vtY; ++i)
+    {
+      memcpy(tile_buf + i * outchannels, background, outchannels);
+    }
+  }
+  else
+  {
+    try
+    {
+      renderRegion(tile_buf, pos, size, level);
+    }
+    catch(...)
+    {
+      free(tile_buf);
+      throw;
+    }
+  }
+  
+  LOG_DEBUG("WlzImage::getTile() raw creation");
+  
+  RawTile rawtile(tile, res, seq, ang, size.vtX, size.vtY, outchannels, bpp);
+  rawtile.data = tile_buf;
+  rawtile.localData = 1;
+  rawtile.dataLength = size.vtX * size.vtY * outchannels;
+  rawtile.width_padding = tile_width - size.vtX;
+  //get hash of the tile
+  rawtile.filename = getHash();
+  return(rawtile);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Gets a tile of the sectioned (or projected) grey values
+ * 		 of the current view in their own type, rather than
+ * 		 converted to RGB, for clients which map the values
+ * 		 themselves. At most one selector may be given, as the
+ * 		 values of different selections can not be combined, and
+ * 		 the MAP look up table is not applied. The tile data is a
+ * 		 ValueTile.h header followed by the uncompressed values,
+ * 		 which are zero outside of the object. Objects without
+ * 		 values are sent as unsigned bytes which are 255 within
+ * 		 their domain, as they are rendered. The tile's file name
+ * 		 is the image hash with VALUETILE_HASH appended, which keys
+ * 		 it in the tile cache.
+ * \param        seq not used
+ * \param        ang not used
+ * \param        res requested resolution, numResolutions - 1 being
+ * 				the full resolution
+ * \param        tile requested tile number
+ * \return       RawTile grey value tile data
+ * \par      Source:
+ *                WlzImage.cc
+ */
+RawTile		WlzImage::getValueTile(int seq, int ang, unsigned int res,
+				       unsigned int tile)
+throw(string)
+{
+  int		level,
+  		sampleSz;
+  bool		domainOnly = false;
+  size_t	dataSz;
+  WlzIVertex2   pos,
+  		pos2D,
+		size;
+  WlzDomain	domain;
+  WlzValues	values;
+  WlzGreyType	gType;
+  ValueTileType	vType;
+  WlzObject	*gvnObj,
+  		*expObj = NULL,
+		*tileObj = NULL,
+		*renObj = NULL;
+  CompoundSelector dfltSel,
+  		*sel = viewParams->selector;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  loadImageInfo(0, 0);
+  getTileRegion(res, tile, level, pos, size);
+  WlzThreeDViewStruct *vs = (level > 0)? levelViewStr[level]: wlzViewStr;
+  if(vs == NULL)
+  {
+    throw(makeWlzErrorMessage("WlzImage::getValueTile() invalid level.",
+                              WLZ_ERR_PARAM_DATA));
+  }
+  if(sel && sel->next)
+  {
+    throw(string("WlzImage::getValueTile() only one selector may be given."));
+  }
+  if(sel == NULL)
+  {
+    dfltSel.a = dfltSel.r = dfltSel.g = dfltSel.b = 255;
+    dfltSel.expression = NULL;
+    sel = &dfltSel;
+  }
+  // The object from which values are taken, as selected for rendering.
+  gvnObj = wlzObject;
+  if(wlzObject->type == WLZ_COMPOUND_ARR_2)
+  {
+    WlzCompoundArray *array = (WlzCompoundArray *)wlzObject;
+
+    if(sel->expression)
+    {
+      gvnObj = expObj = WlzImageExpEval(sel->expression); // Assigns obj.
+    }
+    else
+    {
+      gvnObj = (array->n > 0)? array->o[0]: NULL;
+    }
+    if(gvnObj == NULL)
+    {
+      (void )WlzFreeObj(expObj);
+      throw(makeWlzErrorMessage("WlzImage::getValueTile() no object selected.",
+				WLZ_ERR_OBJECT_NULL));
+    }
+  }
+  gType = WlzGreyTypeFromObj(gvnObj, &errNum);
+  if(errNum != WLZ_ERR_NONE)
+  {
+    // Domain objects are sent as a byte mask.
+    gType = WLZ_GREY_UBYTE;
+    domainOnly = true;
+    errNum = WLZ_ERR_NONE;
+  }
+  // Tiles which can not intersect the object are left as zeros.
+  pos2D.vtX = pos.vtX + WLZ_NINT(vs->minvals.vtX);
+  pos2D.vtY = pos.vtY + WLZ_NINT(vs->minvals.vtY);
+  if(!isRegionEmpty(pos, size, level))
+  {
+    if((domain.i = WlzMakeIntervalDomain(WLZ_INTERVALDOMAIN_RECT,
+					 pos2D.vtY, pos2D.vtY + size.vtY - 1,
+					 pos2D.vtX, pos2D.vtX + size.vtX - 1,
+					 &errNum)) != NULL)
+    {
+      values.core = NULL;
+      tileObj = WlzAssignObject(WlzMakeMain(WLZ_2D_DOMAINOBJ, domain, values,
+                                            NULL, NULL, &errNum), NULL);
+    }
+    if(errNum == WLZ_ERR_NONE)
+    {
+      try
+      {
+	renObj = renderSection(gvnObj, tileObj, sel, level, &errNum);
+      }
+      catch(...)
+      {
+	(void )WlzFreeObj(tileObj);
+	(void )WlzFreeObj(expObj);
+	throw;
+      }
+    }
+    if((errNum == WLZ_ERR_NONE) && renObj && renObj->values.core)
+    {
+      gType = WlzGreyTypeFromObj(renObj, &errNum);
+    }
+  }
+  switch(gType)
+  {
+    case WLZ_GREY_UBYTE:
+      vType = VALUETILE_UBYTE;
+      break;
+    case WLZ_GREY_SHORT:
+      vType = VALUETILE_SHORT;
+      break;
+    case WLZ_GREY_INT:
+      vType = VALUETILE_INT;
+      break;
+    case WLZ_GREY_LONG:
+      vType = VALUETILE_LONG;
+      break;
+    case WLZ_GREY_FLOAT:
+      vType = VALUETILE_FLOAT;
+      break;
+    case WLZ_GREY_DOUBLE:
+      vType = VALUETILE_DOUBLE;
+      break;
+    case WLZ_GREY_RGBA:
+      vType = VALUETILE_RGBA;
+      break;
+    default:
+      vType = VALUETILE_UBYTE;
+      errNum = (errNum == WLZ_ERR_NONE)? WLZ_ERR_GREY_TYPE: errNum;
+      break;
+  }
+  sampleSz = ValueTileSampleSize(vType);
+  dataSz = size.vtX * size.vtY * sampleSz;
+  WlzUByte *buf = NULL;
+  if((errNum == WLZ_ERR_NONE) &&
+     ((buf = (WlzUByte *)calloc(VALUETILE_HEADER_SZ + dataSz, 1)) == NULL))
+  {
+    errNum = WLZ_ERR_MEM_ALLOC;
+  }
+  if((errNum == WLZ_ERR_NONE) && renObj && renObj->values.core)
+  {
+    WlzIntervalWSpace iwsp;
+    WlzGreyWSpace gwsp;
+    WlzUByte	*vBuf = buf + VALUETILE_HEADER_SZ;
+
+    errNum = WlzInitGreyScan(renObj, &iwsp, &gwsp);
+    while((errNum == WLZ_ERR_NONE) &&
+          ((errNum = WlzNextGreyInterval(&iwsp)) == WLZ_ERR_NONE))
+    {
+      const int	iwidth = iwsp.rgtpos - iwsp.lftpos + 1;
+      WlzUByte	*dst = vBuf + (size.vtX * (iwsp.linpos - pos2D.vtY) +
+			       (iwsp.colpos - pos2D.vtX)) * sampleSz;
+
+      memcpy(dst, gwsp.u_grintptr.v, iwidth * sampleSz);
+    }
+    if(errNum == WLZ_ERR_EOO)
     {
-      lutObj = WlzAssignObject(map.createLUT(&errNum), NULL);
-      if(errNum == WLZ_ERR_NONE)
-      {
-	addObjectToCache(lutObj, mapS);
-      }
+      errNum = WLZ_ERR_NONE;
     }
   }
-  if(dstErr)
+  else if((errNum == WLZ_ERR_NONE) && domainOnly && renObj &&
+          (renObj->type == WLZ_2D_DOMAINOBJ))
   {
-    *dstErr = errNum;
+    errNum = ValueTileSetDomain(buf + VALUETILE_HEADER_SZ, renObj,
+				pos2D.vtX, pos2D.vtY, size.vtX, size.vtY);
   }
-  return(lutObj);
+  (void )WlzFreeObj(renObj);
+  (void )WlzFreeObj(tileObj);
+  (void )WlzFreeObj(expObj);
+  if(errNum != WLZ_ERR_NONE)
+  {
+    free(buf);
+    throw(makeWlzErrorMessage("WlzImage::getValueTile() rendering failed.",
+                              errNum));
+  }
+  ValueTileSetHeader(buf, vType, VALUETILE_NONE, size.vtX, size.vtY, dataSz);
+  RawTile rawtile(tile, res, seq, ang, size.vtX, size.vtY,
+                  (vType == VALUETILE_RGBA)? 4: 1,
+		  (vType == VALUETILE_RGBA)? 8: 8 * sampleSz);
+  rawtile.data = buf;
+  rawtile.localData = 1;
+  rawtile.dataLength = VALUETILE_HEADER_SZ + dataSz;
+  rawtile.filename = getHash() + VALUETILE_HASH;
+  return(rawtile);
 }
 
 /*!
  * \ingroup      WlzIIPServer
- * \brief        Generate the current tile
- * \param        seq not used
- * \param        ang not used
- * \param        res requested resolution
- * \param        tile requested tile number
- * \return       RawTile raw tile data
+ * \brief        Computes the region of the view covered by a tile.
+ * 		 The image information must have been loaded.
+ * \param        res		Resolution number, numResolutions - 1
+ * 				being the full resolution.
+ * \param        tile		Tile number.
+ * \param        level		Destination for the resolution level.
+ * \param        pos		Destination for the origin of the tile
+ * 				relative to the top left of the level.
+ * \param        size		Destination for the size of the tile,
+ * 				which is smaller than the tile size for
+ * 				the last column and row.
  * \par      Source:
  *                WlzImage.cc
  */
-RawTile		WlzImage::getTile(int seq, int ang, unsigned int res,
-				  unsigned int tile)
+void		WlzImage::getTileRegion(unsigned int res, unsigned int tile,
+					int &level, WlzIVertex2 &pos,
+					WlzIVertex2 &size)
 throw(string)
 {
   int 		tw=0, th=0; //real tile width and height
-  WlzErrorNum 	errNum=WLZ_ERR_NONE;
-  string 	filename;
-  WlzObject     *tmpObj;
-  WlzIVertex3   pos;
-  WlzObject     *wlzSection = NULL;
-  
-  //seq = ang =  res  = 0;
-  // force unused parameters to zero to, facilitate cache match
-  loadImageInfo( 0, 0);
+  int		lntlx, lntly, lLastWidth, lLastHeight;
+  unsigned int	lWidth, lHeight;
+
+  // Check that a valid resolution was given
+  if(res >= (unsigned int )numResolutions)
+  {
+    char res_no[64];
+    snprintf( res_no, 64, "%d", res );
+    string res_n = string( res_no );
+    throw("WlzImage::getTile() resolution " + res_n + " does not exist");
+  }
+  // The tile grid of the resolution level
+  level = numResolutions - 1 - res;
+  getLevelSize(level, lWidth, lHeight);
+  lLastWidth = lWidth % tile_width;
+  lLastHeight = lHeight % tile_height;
+  lntlx = (lWidth / tile_width) + (lLastWidth == 0 ? 0 : 1);
+  lntly = (lHeight / tile_height) + (lLastHeight == 0 ? 0 : 1);
   
   // Check that a valid tile number was given
-  if( tile >= number_of_tiles)
+  if( tile >= (unsigned int )(lntlx * lntly))
   {
     char tile_no[64];
     snprintf( tile_no, 64, "%d", tile );
@@ -889,128 +1834,411 @@ throw(string)
   tw = tile_width;
   th = tile_height;
   // Alter the tile size if it's in the last column
-  if((tile % ntlx == ntlx - 1) && (lastTileWidth != 0))
+  if(((int )tile % lntlx == lntlx - 1) && (lLastWidth != 0))
   {
-    tw = lastTileWidth;
+    tw = lLastWidth;
   }
   // Alter the tile size if it's in the bottom row
-  if((tile / ntlx == ntly - 1) && (lastTileHeight != 0))
+  if(((int )tile / lntlx == lntly - 1) && (lLastHeight != 0))
   {
-    th = lastTileHeight;
+    th = lLastHeight;
   }
-  if(errNum == WLZ_ERR_NONE)
+  pos.vtX = (tile % lntlx) * tile_width;
+  pos.vtY = (tile / lntlx) * tile_height;
+  size.vtX = tw;
+  size.vtY = th;
+}
+
+/*!
+ * \return       True if the tile is known to contain only background.
+ * \ingroup      WlzIIPServer
+ * \brief        Tests whether a tile of the current view can not
+ * 		 intersect the object, in which case it is just filled
+ * 		 with the background by getTile() and is the same as any
+ * 		 other empty tile of the same size. Nothing is rendered
+ * 		 or allocated; for an empty tile the header of the tile
+ * 		 that getTile() would return is set, without any data.
+ * \param        seq not used
+ * \param        ang not used
+ * \param        res requested resolution, numResolutions - 1 being
+ * 				the full resolution
+ * \param        tile requested tile number
+ * \param        rawtile		Set to the header of an empty tile.
+ * \param        bg		Set to the background of each channel
+ * 				of an empty tile, at least 4 bytes.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+bool		WlzImage::isEmptyTile(int seq, int ang, unsigned int res,
+				      unsigned int tile, RawTile &rawtile,
+				      unsigned char *bg)
+{
+  bool		empty = false;
+
+  try
   {
-    /* Create maximum sized rectangular object */
-    WlzDomain     domain;
-    WlzValues     values;
-    
-    pos.vtX = (tile % ntlx) * tile_width +  WLZ_NINT(wlzViewStr->minvals.vtX);
-    pos.vtY = (tile / ntlx) * tile_height + WLZ_NINT(wlzViewStr->minvals.vtY);
-    if((domain.i = WlzMakeIntervalDomain(WLZ_INTERVALDOMAIN_RECT,
-					 WLZ_NINT(pos.vtY),
-					 WLZ_NINT(pos.vtY + th - 1),
-					 WLZ_NINT(pos.vtX),
-					 WLZ_NINT(pos.vtX + tw - 1),
-					 &errNum)))
+    int		level;
+    WlzIVertex2	pos,
+		size;
+
+    loadImageInfo(0, 0);
+    getTileRegion(res, tile, level, pos, size);
+    empty = (bpp == 8) && isRegionEmpty(pos, size, level);
+    if(empty)
     {
-      LOG_DEBUG("WlzImage::getTile() domain size " << pos.vtX <<"," <<
-                pos.vtY << "," << tw << "," << th << " --- " <<
-		wlzObject->domain.core->type);
-      values.core = NULL;
-      tmpObj = WlzAssignObject(WlzMakeMain(WLZ_2D_DOMAINOBJ, domain,
-					   values, NULL, NULL, &errNum), NULL);
+      int	outchannels = getNumChannels();
+
+      rawtile.tileNum = tile;
+      rawtile.resolution = res;
+      rawtile.hSequence = seq;
+      rawtile.vSequence = ang;
+      rawtile.width = size.vtX;
+      rawtile.height = size.vtY;
+      rawtile.channels = outchannels;
+      rawtile.bpc = bpp;
+      rawtile.width_padding = tile_width - size.vtX;
+      rawtile.filename = getHash();
+      memcpy(bg, background, WLZ_MIN(outchannels, 4));
     }
   }
-  WlzIBox3 gBufBox;
-  gBufBox.xMin=pos.vtX;
-  gBufBox.yMin=pos.vtY;
-  gBufBox.xMax=pos.vtX + tw -1;
-  gBufBox.yMax=pos.vtY + th -1;
-  gBufBox.zMin=0;
-  gBufBox.zMax=0;
-  
-  WlzIVertex2 pos2D;
-  WlzIVertex2 size;
-  pos2D.vtX = pos.vtX;
-  pos2D.vtY = pos.vtY;
-  size.vtX= tw;
-  size.vtY= th;
-  
+  catch(const string &error)
+  {
+    LOG_DEBUG("WlzImage::isEmptyTile() " << error);
+  }
+  return(empty);
+}
+
+/*!
+ * \return       Largest distance by which the expression may grow an
+ * 		 object.
+ * \ingroup      WlzIIPServer
+ * \brief        Sums the radii of nested dilations in the expression,
+ * 		 taking the largest sum over its operands.
+ * \param        exp		Given expression, may be NULL.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+unsigned int	WlzImage::getExpDilation(const WlzExp *exp)
+{
+  unsigned int	idx,
+  		rad = 0;
+
+  if(exp)
+  {
+    for(idx = 0; idx < exp->nParam; ++idx)
+    {
+      if(exp->param[idx].type == WLZ_EXP_PRM_EXP)
+      {
+        rad = WLZ_MAX(rad, getExpDilation(exp->param[idx].val.exp));
+      }
+    }
+    if((exp->type == WLZ_EXP_OP_DILATION) && (exp->nParam > 1) &&
+       (exp->param[1].type == WLZ_EXP_PRM_UINT))
+    {
+      rad += exp->param[1].val.u;
+    }
+  }
+  return(rad);
+}
+
+/*!
+ * \return       True if the region can not intersect the object.
+ * \ingroup      WlzIIPServer
+ * \brief        Tests whether a rectangular region of a section view
+ * 		 lies outside the bounding box of the object's domain.
+ * 		 The region is mapped back onto its plane through the
+ * 		 object and the resulting parallelogram is tested against
+ * 		 the bounding box for a separating axis. The box is grown
+ * 		 by a voxel and by the largest dilation in any selector
+ * 		 expression. Projections and objects other than 3D domain
+ * 		 objects, or compounds of them, are never considered
+ * 		 to be empty.
+ * \param        pos		Origin of the region relative to the
+ * 				top left of the level.
+ * \param        size		Size of the region.
+ * \param        level		Resolution level, 0 being the full
+ * 				resolution.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+bool		WlzImage::isRegionEmpty(WlzIVertex2 pos, WlzIVertex2 size,
+					int level)
+{
+  int		idx,
+  		nObj = 1;
+  double	grow = 1.0;
+  WlzObject	**objs = &wlzObject;
+  WlzDBox3	box;
+  WlzDVertex3	rgn[4],
+  		bv[8],
+		axes[10];
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+  WlzThreeDViewStruct *vs;
+
+  if((wlzObject == NULL) || (viewParams->rmd != RENDERMODE_SECT) ||
+     (level < 0) || (level >= numResolutions) ||
+     ((vs = (level > 0)? levelViewStr[level]: wlzViewStr) == NULL))
+  {
+    return(false);
+  }
+  if(wlzObject->type == WLZ_COMPOUND_ARR_2)
+  {
+    WlzCompoundArray *array = (WlzCompoundArray *)wlzObject;
+
+    objs = array->o;
+    nObj = array->n;
+  }
+  // Bounding box of the domains.
+  for(idx = 0; idx < nObj; ++idx)
+  {
+    WlzPlaneDomain *pDom;
+
+    if((objs[idx] == NULL) || (objs[idx]->type != WLZ_3D_DOMAINOBJ) ||
+       ((pDom = objs[idx]->domain.p) == NULL))
+    {
+      return(false);
+    }
+    if((idx == 0) || (pDom->kol1 < box.xMin)) box.xMin = pDom->kol1;
+    if((idx == 0) || (pDom->line1 < box.yMin)) box.yMin = pDom->line1;
+    if((idx == 0) || (pDom->plane1 < box.zMin)) box.zMin = pDom->plane1;
+    if((idx == 0) || (pDom->lastkl > box.xMax)) box.xMax = pDom->lastkl;
+    if((idx == 0) || (pDom->lastln > box.yMax)) box.yMax = pDom->lastln;
+    if((idx == 0) || (pDom->lastpl > box.zMax)) box.zMax = pDom->lastpl;
+  }
+  if(nObj < 1)
+  {
+    return(false);
+  }
+  // Dilations in selector expressions grow the rendered domains.
+  for(CompoundSelector *sel = viewParams->selector; sel != NULL;
+      sel = sel->next)
+  {
+    grow = WLZ_MAX(grow, 1.0 + getExpDilation(sel->expression));
+  }
+  for(idx = 0; idx < 8; ++idx)
+  {
+    bv[idx].vtX = (idx & 1)? box.xMax + grow: box.xMin - grow;
+    bv[idx].vtY = (idx & 2)? box.yMax + grow: box.yMin - grow;
+    bv[idx].vtZ = (idx & 4)? box.zMax + grow: box.zMin - grow;
+  }
+  // Corners of the region's pixels on the section plane, in the
+  // coordinates of the object.
+  for(idx = 0; (errNum == WLZ_ERR_NONE) && (idx < 4); ++idx)
+  {
+    rgn[idx].vtX = WLZ_NINT(vs->minvals.vtX) + pos.vtX - 0.5 +
+                   ((idx == 1 || idx == 2)? size.vtX: 0);
+    rgn[idx].vtY = WLZ_NINT(vs->minvals.vtY) + pos.vtY - 0.5 +
+                   ((idx >= 2)? size.vtY: 0);
+    rgn[idx].vtZ = vs->dist;
+    errNum = Wlz3DSectionTransformInvVtx(rgn + idx, vs);
+  }
+  if(errNum != WLZ_ERR_NONE)
+  {
+    return(false);
+  }
+  // Candidate separating axes: the box normals, the region's normal and
+  // the cross products of the box and region edges.
+  WlzDVertex3	e0,
+  		e1;
+
+  WLZ_VTX_3_SUB(e0, rgn[1], rgn[0]);
+  WLZ_VTX_3_SUB(e1, rgn[3], rgn[0]);
+  for(idx = 0; idx < 3; ++idx)
+  {
+    WLZ_VTX_3_SET(axes[idx], (idx == 0)? 1.0: 0.0, (idx == 1)? 1.0: 0.0,
+                  (idx == 2)? 1.0: 0.0);
+    WLZ_VTX_3_CROSS(axes[3 + idx], axes[idx], e0);
+    WLZ_VTX_3_CROSS(axes[6 + idx], axes[idx], e1);
+  }
+  WLZ_VTX_3_CROSS(axes[9], e0, e1);
+  for(idx = 0; idx < 10; ++idx)
+  {
+    double	bMin = 0.0, bMax = 0.0,
+    		rMin = 0.0, rMax = 0.0;
+    const WlzDVertex3 a = axes[idx];
+
+    if(WLZ_VTX_3_SQRLEN(a) < 1.0e-12)
+    {
+      continue;
+    }
+    for(int i = 0; i < 8; ++i)
+    {
+      const double d = WLZ_VTX_3_DOT(a, bv[i]);
+
+      if((i == 0) || (d < bMin)) bMin = d;
+      if((i == 0) || (d > bMax)) bMax = d;
+    }
+    for(int i = 0; i < 4; ++i)
+    {
+      const double d = WLZ_VTX_3_DOT(a, rgn[i]);
+
+      if((i == 0) || (d < rMin)) rMin = d;
+      if((i == 0) || (d > rMax)) rMax = d;
+    }
+    if((rMax < bMin) || (rMin > bMax))
+    {
+      // A separating axis has been found.
+      return(true);
+    }
+  }
+  return(false);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Renders a rectangular region of the current view into
+ * 		 the given buffer, which must have room for size.vtX x
+ * 		 size.vtY pixels of getNumChannels() bytes, packed
+ * 		 without padding. The region is sectioned (or projected)
+ * 		 once for each selector, so a large region is rendered
+ * 		 with much less overhead than the tiles covering it.
+ * 		 As for getTile(), regions may be rendered concurrently
+ * 		 once the image information has been loaded.
+ * \param        buf		Destination buffer.
+ * \param        pos		Origin of the region relative to the
+ * 				top left of the view.
+ * \param        size		Size of the region.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void		WlzImage::renderRegion(WlzUByte *buf, WlzIVertex2 pos,
+				       WlzIVertex2 size)
+throw(string)
+{
+  renderRegion(buf, pos, size, 0);
+}
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Renders a rectangular region of a resolution level of
+ * 		 the current view into the given buffer, as for the
+ * 		 full resolution renderRegion().
+ * \param        buf		Destination buffer.
+ * \param        pos		Origin of the region relative to the
+ * 				top left of the level.
+ * \param        size		Size of the region.
+ * \param        level		Resolution level, 0 being the full
+ * 				resolution.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void		WlzImage::renderRegion(WlzUByte *buf, WlzIVertex2 pos,
+				       WlzIVertex2 size, int level)
+throw(string)
+{
+  WlzErrorNum 	errNum=WLZ_ERR_NONE;
+  WlzObject     *tmpObj = NULL;
+  WlzDomain     domain;
+  WlzValues     values;
+  WlzIVertex2 	pos2D;
+
+  WlzThreeDViewStruct *vs = wlzViewStr;
+
+  if((level < 0) || (level >= numResolutions) ||
+     ((level > 0) && ((vs = levelViewStr[level]) == NULL)))
+  {
+    throw(makeWlzErrorMessage("WlzImage::renderRegion() invalid level.",
+                              WLZ_ERR_PARAM_DATA));
+  }
+  /* Create rectangular object covering the region */
+  pos2D.vtX = pos.vtX + WLZ_NINT(vs->minvals.vtX);
+  pos2D.vtY = pos.vtY + WLZ_NINT(vs->minvals.vtY);
+  if((domain.i = WlzMakeIntervalDomain(WLZ_INTERVALDOMAIN_RECT,
+				       pos2D.vtY,
+				       pos2D.vtY + size.vtY - 1,
+				       pos2D.vtX,
+				       pos2D.vtX + size.vtX - 1,
+				       &errNum)))
+  {
+    LOG_DEBUG("WlzImage::renderRegion() domain size " << pos2D.vtX <<"," <<
+	      pos2D.vtY << "," << size.vtX << "," << size.vtY << " --- " <<
+	      wlzObject->domain.core->type);
+    values.core = NULL;
+    tmpObj = WlzAssignObject(WlzMakeMain(WLZ_2D_DOMAINOBJ, domain,
+					 values, NULL, NULL, &errNum), NULL);
+  }
+  if(errNum != WLZ_ERR_NONE)
+  {
+    throw(makeWlzErrorMessage("WlzImage::renderRegion() domain creation.",
+                              errNum));
+  }
   //recompute out channels
   int outchannels = getNumChannels();
   WlzCompoundArray *array = (wlzObject->type == WLZ_COMPOUND_ARR_2)?
                             (WlzCompoundArray* )wlzObject: NULL;
-  if(!tile_buf)
-  {
-    tile_buf = (WlzUByte *)malloc(tile_width * tile_height * outchannels);
-  }
-  //init tile buffer
+  //init buffer
   for (int i = 0; i < size.vtX * size.vtY; i++)
   {
-    memcpy(tile_buf + i * outchannels, background, outchannels);
+    memcpy(buf + i * outchannels, background, outchannels);
   }
-  if(viewParams->selector)
+  try
   {
-    //if selector existis
-    CompoundSelector *iter = viewParams->selector;
-    while(iter)
+    if(viewParams->selector)
     {
-      if(array)
+      //if selector existis
+      CompoundSelector *iter = viewParams->selector;
+      while(iter)
       {
-	if(iter->expression)
+	if(array)
 	{
-          WlzObject *obj= NULL;
-
-          obj = WlzImageExpEval(iter->expression); // Assigns obj.
-	  if(obj)
+	  if(iter->expression)
 	  {
-	    renderObj(tile_buf, obj, tmpObj, pos2D, size, iter);
+	    WlzObject *obj= NULL;
+
+	    obj = WlzImageExpEval(iter->expression); // Assigns obj.
+	    if(obj)
+	    {
+	      try
+	      {
+		renderObj(buf, obj, tmpObj, pos2D, size, iter, level);
+	      }
+	      catch(...)
+	      {
+		(void )WlzFreeObj(obj);
+		throw;
+	      }
+	    }
+	    (void )WlzFreeObj(obj);
 	  }
-	  (void )WlzFreeObj(obj);
+	}
+	else
+	{
+	  // use selector with lowest index
+	  renderObj(buf, wlzObject, tmpObj, pos2D, size, iter, level);
+	  break;
+	}
+	iter = iter->next;
+      }
+    }
+    else
+    {
+      //use default selector
+      CompoundSelector sel;
+      sel.a=255;
+      sel.r=255;
+      sel.g=255;
+      sel.b=255;
+      sel.expression = NULL;
+      if(array)
+      {
+	if((array->n > 0) && array->o[0])
+	{
+	  renderObj(buf, array->o[0], tmpObj, pos2D, size, &sel, level);
 	}
       }
       else
       {
-	// use selector with lowest index
-	renderObj(tile_buf, wlzObject, tmpObj, pos2D, size, iter);
-	break;
+	renderObj(buf, wlzObject , tmpObj, pos2D, size, &sel, level);
       }
-      iter = iter->next;
     }
   }
-  else
+  catch(...)
   {
-    //use default selector
-    CompoundSelector sel;
-    sel.a=255;
-    sel.r=255;
-    sel.g=255;
-    sel.b=255;
-    sel.expression = NULL;
-    if(array)
-    {
-      if((array->n > 0) && array->o[0])
-      {
-	renderObj(tile_buf, array->o[0], tmpObj, pos2D, size, &sel);
-      }
-    }
-    else
-    {
-      renderObj(tile_buf, wlzObject , tmpObj, pos2D, size, &sel);
-    }
+    (void )WlzFreeObj(tmpObj);
+    throw;
   }
-  //free tileing object
-  (void *)WlzFreeObj(tmpObj);
-  
-  LOG_DEBUG("WlzImage::getTile() raw creation");
-  
-  RawTile rawtile(tile, res, seq, ang, tw, th, outchannels, bpp);
-  rawtile.data = tile_buf;
-  rawtile.dataLength = tw * th * outchannels;
-  rawtile.width_padding = tile_width - tw;
-  //get hash of the tile
-  rawtile.filename = getHash();
-  return(rawtile);
+  //free region object
+  (void )WlzFreeObj(tmpObj);
 }
 
 /*!
@@ -1454,20 +2682,17 @@ WlzImage::convertDomainObjToRGB(WlzUByte *cbuffer, WlzObject* obj,
   }
   else if(obj->type == WLZ_2D_DOMAINOBJ)
   {
-    int           i;
     WlzIntervalWSpace iwsp;
 
     int col1 = pos.vtX;
     int line1 = pos.vtY;
     int lnOff = 0;
-    int iwidth = 0;
-    int alpha = sel ? sel->a:255;
     int nCh = getNumChannels();
-    float fA = alpha / 255.0;
-    float fA1 = 1.0f - fA;
-    float r = (sel ? sel->r:255) * fA;
-    float g = (sel ? sel->g:255) * fA;
-    float b = (sel ? sel->b:255) * fA;
+    // The domain is composited as if all its values were 255.
+    Compositor comp(WLZ_GREY_ERROR, nCh, (nCh >= 3)? 3: 1,
+		    (nCh == 2 || nCh == 4)? nCh - 1: 0,
+		    (sel)? sel->a: 255, (sel)? sel->r: 255,
+		    (sel)? sel->g: 255, (sel)? sel->b: 255);
 
     //scan the object
     if((errNum = WlzInitRasterScan(obj, &iwsp,
@@ -1475,22 +2700,8 @@ WlzImage::convertDomainObjToRGB(WlzUByte *cbuffer, WlzObject* obj,
     {
       while((errNum = WlzNextInterval(&iwsp)) == WLZ_ERR_NONE)
       {
-	WlzUInt val;
 	lnOff = ((size.vtX * (iwsp.linpos-line1)) + (iwsp.lftpos-col1))* nCh;
-	iwidth = iwsp.rgtpos - iwsp.lftpos;
-	for(i = 0; i <= iwidth; i++)
-	{
-	  int	lnCOff = lnOff + (i * nCh);
-
-	  cbuffer[lnCOff]     = (WlzUByte )(r + cbuffer[lnCOff] * fA1);
-	  cbuffer[lnCOff + 1] = (WlzUByte )(g + cbuffer[lnCOff + 1] * fA1);
-	  cbuffer[lnCOff + 2] = (WlzUByte )(b + cbuffer[lnCOff + 2] * fA1);
-	  if (nCh==4)
-	  {
-	    float a2 = cbuffer[lnCOff + 3] / 255.0f;
-	    cbuffer[lnCOff + 3] = (WlzUByte )round((fA + a2 - a2 * fA)*255.0);
-	  }
-	}
+	comp.composite(cbuffer + lnOff, NULL, iwsp.rgtpos - iwsp.lftpos + 1);
       }
     }
     if(errNum == WLZ_ERR_EOO)
@@ -1504,13 +2715,17 @@ WlzImage::convertDomainObjToRGB(WlzUByte *cbuffer, WlzObject* obj,
 /*!
  * \return      Woolz error code.
  * \ingroup     WlzIIPServer
- * \brief       Converts a 2D value object to a linearised 2D array
+ * \brief       Converts a 2D value object to a linearised 2D array,
+ * 		compositing each interval of values over the array with
+ * 		the selector's colour and alpha using a Compositor.
  * \param       cbuf    	Allocated memmory location for the output.
  * \param	obj        	Input object.
  * \param       pos        	Section bounding box origin.
  * \param       size       	Section bounding box size.
  * \param       sel        	Selector with the colour to be used for the
  * 				section.
+ * \param	lut		Look up table through which the values are
+ * 				mapped, may be NULL.
  * \par      Source:
  *                WlzImage.cc
  */
@@ -1518,12 +2733,11 @@ WlzErrorNum
 WlzImage::convertValueObjToRGB(WlzUByte *cbuf,
 			       WlzObject* obj,
                                WlzIVertex2  pos, WlzIVertex2  size,
-			       CompoundSelector *sel)
+			       CompoundSelector *sel,
+			       const CompositorLUT *lut)
 {
   WlzIntervalWSpace     iwsp;
   WlzGreyWSpace         gwsp;
-  int           i,
-  		j;
   WlzGreyType   gType;
   WlzErrorNum   errNum = WLZ_ERR_NONE;
   
@@ -1544,144 +2758,39 @@ WlzImage::convertValueObjToRGB(WlzUByte *cbuf,
   bool copyGreyToRGB = outchannels != channels;
   int alphaoffset = (outchannels == 2 || outchannels==4)?
                     ((copyGreyToRGB || outchannels==4)? 3 :1): 0;
-  float gray;
-  int   alpha = sel ? sel->a : 255;
-  float fA = alpha / 255.0f;
-  float fR = sel ? sel->r/255.0f : 1.0f;
-  float fG = sel ? sel->g/255.0f : 1.0f;
-  float fB = sel ? sel->b/255.0f : 1.0f;
-  float fAlphaPrev = 0, fANew=0;
   
   gType = WlzGreyTypeFromObj(obj, &errNum);
-  //scan the object
-  if(errNum == WLZ_ERR_NONE)
+  if(errNum != WLZ_ERR_NONE)
+  {
+    return(errNum);
+  }
+  // RGBA values, including values mapped to RGBA, always set the three
+  // colour channels and only set the alpha channel of an RGBA buffer.
+  if((gType == WLZ_GREY_RGBA) || (lut && lut->rgba))
+  {
+    copyGreyToRGB = true;
+    alphaoffset = (outchannels == 4)? 3: 0;
+  }
+  // The kernel for the grey type, channels and selector is chosen once
+  // for the object.
+  Compositor comp(gType, lut, outchannels, (copyGreyToRGB)? 3: 1,
+		  alphaoffset,
+		  (sel)? sel->a: 255, (sel)? sel->r: 255,
+		  (sel)? sel->g: 255, (sel)? sel->b: 255);
+  if(!comp.isValid())
   {
-    errNum = WlzInitGreyScan(obj, &iwsp, &gwsp);
+    return(WLZ_ERR_GREY_TYPE);
   }
+  //scan the object
+  errNum = WlzInitGreyScan(obj, &iwsp, &gwsp);
   if(errNum == WLZ_ERR_NONE)
   {
-    j = 0;
-    while((errNum == WLZ_ERR_NONE) &&
-          ((errNum = WlzNextGreyInterval(&iwsp)) == WLZ_ERR_NONE))
+    while((errNum = WlzNextGreyInterval(&iwsp)) == WLZ_ERR_NONE)
     {
       lineoff = (size.vtX * (iwsp.linpos - line1) + (iwsp.colpos - col1)) *
                 outchannels;
-      iwidth = iwsp.rgtpos-iwsp.lftpos;
-      switch( gType ){
-      case WLZ_GREY_LONG:
-	for(i=0; i <= iwidth; i++){
-	  int boff = lineoff + (i * outchannels);
-	  gray = gwsp.u_grintptr.lnp[i] * fA;
-	  cbuf[boff] = (WlzUByte)(gray * fR + cbuf[boff] * (1 - fA));
-	  if (copyGreyToRGB)
-	  {
-	    cbuf[boff + 1] = (WlzUByte )(gray * fG + cbuf[boff + 1] * (1 - fA));
-	    cbuf[boff + 2] = (WlzUByte )(gray * fB + cbuf[boff + 2] * (1 - fA));
-	  }
-	  if(alphaoffset > 0)
-	  {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )(round((fA + fAlphaPrev - fAlphaPrev * fA)*255.0));
-	  }
-	}
-	break;
-      case WLZ_GREY_INT:
-	for(i=0; i <= iwidth; i++){
-	  int boff = lineoff + (i * outchannels);
-	  gray = gwsp.u_grintptr.inp[i] * fA;
-	  cbuf[boff] = (WlzUByte )(gray * fR + cbuf[boff] * (1 - fA));
-	  if (copyGreyToRGB) {
-	    cbuf[boff + 1] = (WlzUByte )(gray * fG + cbuf[boff + 1] * (1 - fA));
-	    cbuf[boff + 2] = (WlzUByte )(gray * fB + cbuf[boff + 2] * (1 - fA));
-	  }
-	  if (alphaoffset>0) {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )(round((fA + fAlphaPrev - fAlphaPrev * fA)*255.0));
-	  }
-	}
-	break;
-      case WLZ_GREY_SHORT:
-	for(i=0; i <= iwidth; i++){
-	  int boff = lineoff + (i * outchannels);
-	  gray= gwsp.u_grintptr.shp[i] * fA;
-	  cbuf[boff] = (WlzUByte )(gray * fR + cbuf[boff] * (1 - fA));
-	  if (copyGreyToRGB) {
-	    cbuf[boff + 1] = (WlzUByte )(gray * fR + cbuf[boff + 1] * (1 - fA));
-	    cbuf[boff + 2] = (WlzUByte )(gray * fB + cbuf[boff + 2] * (1 - fA));
-	  }
-	  if (alphaoffset>0) {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )round((fA + fAlphaPrev - fAlphaPrev * fA)*255.0);
-	  }
-	}
-	break;
-      case WLZ_GREY_FLOAT:
-	for(i=0; i <= iwidth; i++){
-	  int boff = lineoff + (i * outchannels);
-	  gray= gwsp.u_grintptr.flp[i] * fA;
-	  cbuf[boff] = (WlzUByte )(gray * fR + cbuf[boff] * (1 - fA));
-	  if (copyGreyToRGB) {
-	    cbuf[boff + 1] = (WlzUByte )(gray * fG + cbuf[boff + 1] * (1 - fA));
-	    cbuf[boff + 2] = (WlzUByte )(gray * fB+ cbuf[boff + 2] * (1 - fA));
-	  }
-	  if (alphaoffset>0) {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )round((fA + fAlphaPrev - fAlphaPrev * fA)*255.0);
-	  }
-	}
-	break;
-      case WLZ_GREY_DOUBLE:
-	for(i=0; i <= iwidth; i++){
-	  int boff = lineoff + (i * outchannels);
-	  gray= gwsp.u_grintptr.dbp[i] * fA;
-	  
-	  cbuf[boff] = (WlzUByte )(gray * fR + cbuf[boff] * (1 - fA));
-	  if (copyGreyToRGB) {
-	    cbuf[boff + 1] = (WlzUByte )(gray * fG + cbuf[boff + 1] * (1 - fA));
-	    cbuf[boff + 2] = (WlzUByte )(gray * fB + cbuf[boff + 2] * (1 - fA));
-	  }
-	  if (alphaoffset>0) {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )(round((fA + fAlphaPrev - fAlphaPrev * fA)*255.0));
-	  }
-	}
-	break;
-	
-      case WLZ_GREY_UBYTE:
-	for(i=0; i <= iwidth; i++){
-	  int boff = lineoff + (i * outchannels);
-	  gray= gwsp.u_grintptr.ubp[i] * fA;
-	  cbuf[boff] = (WlzUByte )(gray * fR + cbuf[boff] * (1 - fA));
-	  if (copyGreyToRGB) {
-	    cbuf[boff + 1] = (WlzUByte )(gray * fG + cbuf[boff + 1] * (1 - fA));
-	    cbuf[boff + 2] = (WlzUByte )(gray * fB + cbuf[boff + 2] * (1 - fA));
-	  }
-	  if (outchannels==2 || outchannels==4) {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )round((fA + fAlphaPrev - fAlphaPrev * fA)*255.0);
-	  }
-	}
-	break;
-	
-      case WLZ_GREY_RGBA:
-	for(i=0; i <= iwidth; i++){
-          WlzUInt val;
-	  int boff = lineoff + (i * outchannels);
-	  val = gwsp.u_grintptr.rgbp[i];
-	  cbuf[boff]   = (WlzUByte )(WLZ_RGBA_RED_GET(val)   * fA * fR + cbuf[boff] * (1 - fA));
-	  cbuf[boff + 1] = (WlzUByte )(WLZ_RGBA_GREEN_GET(val) * fA * fG + cbuf[boff + 1] * (1 - fA));
-	  cbuf[boff + 2] = (WlzUByte )(WLZ_RGBA_BLUE_GET(val)  * fA * fB + cbuf[boff + 2] * (1 - fA));
-	  if (outchannels==4) {
-	    fAlphaPrev=cbuf[boff + alphaoffset]/255.0f;
-	    fANew = fA* ((WlzUByte )(WLZ_RGBA_ALPHA_GET(val)))/255.0f;
-	    cbuf[boff + alphaoffset] = (WlzUByte )round((fANew + fAlphaPrev - fAlphaPrev * fANew)*255.0);
-	  }
-	}
-	break;
-      default:
-	errNum = WLZ_ERR_GREY_TYPE;
-	break;
-      }
+      iwidth = iwsp.rgtpos - iwsp.lftpos + 1;
+      comp.composite(cbuf + lineoff, gwsp.u_grintptr.v, iwidth);
     }
   }
   if(errNum == WLZ_ERR_EOO)
@@ -1730,7 +2839,7 @@ WlzImage::convertObjToRGB(WlzUByte *cbuffer, WlzObject *obj, WlzIVertex2 pos,
       case WLZ_2D_DOMAINOBJ:
 	errNum = (obj->values.core == NULL)?
 		 convertDomainObjToRGB(cbuffer,  obj,  pos, size, NULL):
-		 convertValueObjToRGB(cbuffer,  obj,  pos, size, NULL);
+		 convertValueObjToRGB(cbuffer,  obj,  pos, size, NULL, NULL);
 	break;
       default:
 	errNum = WLZ_ERR_OBJECT_TYPE;
@@ -1742,81 +2851,120 @@ WlzImage::convertObjToRGB(WlzUByte *cbuffer, WlzObject *obj, WlzIVertex2 pos,
 
 /*!
  * \ingroup      WlzIIPServer
- * \brief        Return the image hash
+ * \brief        Return the image hash, which identifies the image, view
+ * 		 and selectors. Used as the image name for the tile cache
+ * 		 and in object cache keys.
  * \return       the hash string
  * \par      Source:
  *                WlzImage.cc
  */
 const std::string WlzImage::getHash() { 
-  return generateHash(viewParams) + selString(viewParams);
+  updateHash();
+  return(imageHash);
 };
 
 /*!
  * \ingroup      WlzIIPServer
- * \brief        The hash string component generated by SEL commands
- * \param        view parameters
+ * \brief        Return the view hash, which identifies the image and view
+ * 		 but not the selectors. Used as the view structure cache
+ * 		 key.
  * \return       the hash string
  * \par      Source:
  *                WlzImage.cc
  */
-const std::string WlzImage::selString(const ViewParameters* view )
+const std::string &WlzImage::getViewHash() { 
+  updateHash();
+  return(viewHash);
+};
+
+/*!
+ * \ingroup      WlzIIPServer
+ * \brief        Recomputes the view and image hashes if the view
+ * 		 parameters have changed since they were last computed.
+ * 		 The hashes are 128 bit hashes of the image path, the
+ * 		 modification time and size of the image file, the
+ * 		 binary view descriptor and (for the image hash) the
+ * 		 selector expressions, formated as hexadecimal strings.
+ * 		 Tiles cached beyond the life of the process, as in the
+ * 		 shared tile cache, are so not found once the file has
+ * 		 changed.
+ * \par      Source:
+ *                WlzImage.cc
+ */
+void WlzImage::updateHash()
 {
-  char		*eStr;
-  WlzErrorNum errNum = WLZ_ERR_NONE;
+  int		n;
+  const CompoundSelector *sel;
+  WlzViewDescriptor desc;
 
-  if( view == NULL)
+  prepareObject();  // needs to have set channel number
+  (void )memset(&desc, 0, sizeof(WlzViewDescriptor));
+  desc.dist = viewParams->dist;
+  desc.scale = viewParams->scale;
+  desc.yaw = viewParams->yaw;
+  desc.pitch = viewParams->pitch;
+  desc.roll = viewParams->roll;
+  desc.fixed = viewParams->fixed;
+  desc.fixed2 = viewParams->fixed2;
+  desc.up = viewParams->up;
+  desc.mode = viewParams->mode;
+  desc.rmd = viewParams->rmd;
+  desc.channels = getNumChannels();
+  desc.nMapChan = viewParams->map.getNChan();
+  for(n = 0; n < desc.nMapChan; ++n)
+  {
+    (void )memcpy(desc.mapChan + n, viewParams->map.getChan(n),
+                  sizeof(ImageMapChan));
+  }
+  for(sel = viewParams->selector; sel != NULL; sel = sel->next)
   {
-    return "";
+    ++(desc.nSel);
   }
-  std::string selStr = "";
-  CompoundSelector *iter = view->selector;
-  while(iter)
+  desc.selector = viewParams->selector;
+  desc.lastSel = viewParams->lastsel;
+  if(!hashValid || memcmp(&desc, &hashDesc, sizeof(WlzViewDescriptor)))
   {
-    char	*tStr;
-    char 	buf[25];
+    unsigned long long h[2];
+    char	hStr[40];
+    std::string	buf;
+
+    struct stat	st;
 
-    tStr = WlzExpStr(iter->expression, NULL, NULL);
-    if(tStr)
+    /* The selector list identity is not part of the hash. */
+    desc.selector = desc.lastSel = NULL;
+    buf = getImagePath();
+    if(stat(getFileName().c_str(), &st) == 0)
     {
-      selStr += tStr;
+      char	fStr[64];
+
+      (void )snprintf(fStr, 64, "\n%ld,%lld", (long )st.st_mtime,
+                      (long long )st.st_size);
+      buf += fStr;
+    }
+    buf.append((const char *)&desc, sizeof(WlzViewDescriptor));
+    hash128(buf.data(), buf.length(), h);
+    (void )snprintf(hStr, 40, "V%016llx%016llx", h[0], h[1]);
+    viewHash = hStr;
+    for(sel = viewParams->selector; sel != NULL; sel = sel->next)
+    {
+      char	*eStr;
+      char 	cStr[25];
+
+      if((eStr = WlzExpStr(sel->expression, NULL, NULL)) != NULL)
+      {
+	buf += eStr;
+	AlcFree(eStr);
+      }
+      (void )snprintf(cStr, 25, ",%d,%d,%d,%d;", sel->r, sel->g, sel->b, sel->a);
+      buf += cStr;
     }
-    snprintf(buf, 25, ",%d,%d,%d,%d",iter->r,iter->g,iter->b,iter->a);
-    selStr += buf;
-    iter=iter->next;
-    AlcFree(tStr);
+    hash128(buf.data(), buf.length(), h);
+    (void )snprintf(hStr, 40, "I%016llx%016llx", h[0], h[1]);
+    imageHash = hStr;
+    desc.selector = viewParams->selector;
+    desc.lastSel = viewParams->lastsel;
+    (void )memcpy(&hashDesc, &desc, sizeof(WlzViewDescriptor));
+    hashValid = true;
+    LOG_DEBUG("WlzImage::updateHash() " << viewHash << " " << imageHash);
   }
-  return("S=" + selStr);
 }
-
-/*!
- * \ingroup      WlzIIPServer
- * \brief        Generate the image hash for a set of view parameters
- * \param        view parameters
- * \return       the hash string
- * \par      Source:
- *                WlzImage.cc
- */
-const std::string WlzImage::generateHash(const ViewParameters* view ) { 
-  if ( view == NULL)
-    view = curViewParams;
-  prepareObject();  // needs to have set channel number
-  
-  char temp[256];
-  snprintf(temp, 256,
-           "(D=%g,S=%g,Y=%g,P=%g,R=%g,M=%d,N=%d,C=%d,F=%g,%g,%g,F2=%g,%g,%g)",
-	   view->dist,
-	   view->scale,
-	   view->yaw,
-	   view->pitch,
-	   view->roll,
-	   view->mode,
-	   view->rmd,
-	   getNumChannels(),
-	   view->fixed.vtX,
-	   view->fixed.vtY,
-	   view->fixed.vtZ,
-	   view->fixed2.vtX,
-	   view->fixed2.vtY,
-	   view->fixed2.vtZ);
-  return(getImagePath() + temp + view->map.toString());
-};
@@ -48,6 +48,53 @@ static char _WlzImage_h[] = "University of Edinburgh $Id$";
 
 #include "WlzViewStructCache.h"
 #include "WlzObjectCache.h"
+#include "SingleFlight.h"
+#include "Compositor.h"
+
+/*!
+* \def		WLZIMAGE_MAX_RESOLUTIONS
+* \ingroup	WlzIIPServer
+* \brief	Maximum number of resolutions of a view.
+*/
+#define WLZIMAGE_MAX_RESOLUTIONS	(16)
+
+/*!
+* \def		WLZIMAGE_MAX_PROXY
+* \ingroup	WlzIIPServer
+* \brief	Coarsest sampling factor of the volume proxies.
+*/
+#define WLZIMAGE_MAX_PROXY		(8)
+
+/*!
+* \struct	_WlzViewDescriptor
+* \ingroup	WlzIIPServer
+* \brief	Canonical binary descriptor of the view parameters which
+* 		determine the rendered image. It is zeroed before being
+* 		filled so that it may be compared and hashed as bytes.
+* 		Selectors are only ever appended to the view parameters,
+* 		so they are described by the identity of the list rather
+* 		than by their expressions.
+* 		Typedef: WlzViewDescriptor.
+*/
+typedef struct _WlzViewDescriptor
+{
+  double		dist;		/*!< Distance. */
+  double		scale;		/*!< Scale. */
+  double		yaw;		/*!< Yaw angle. */
+  double		pitch;		/*!< Pitch angle. */
+  double		roll;		/*!< Roll angle. */
+  WlzDVertex3		fixed;		/*!< Fixed point. */
+  WlzDVertex3		fixed2;		/*!< Second fixed point. */
+  WlzDVertex3		up;		/*!< Up vector. */
+  int			mode;		/*!< View mode. */
+  int			rmd;		/*!< Rendering mode. */
+  int			channels;	/*!< Number of output channels. */
+  int			nMapChan;	/*!< Number of image map channels. */
+  ImageMapChan		mapChan[4];	/*!< Image map channels. */
+  int			nSel;		/*!< Number of selectors. */
+  const CompoundSelector *selector;	/*!< First selector. */
+  const CompoundSelector *lastSel;	/*!< Last selector. */
+} WlzViewDescriptor;
 
 
 /*! 
@@ -63,6 +110,21 @@ class WlzImage : public IIPImage
   protected:
     WlzObject		*wlzObject;         /*!< Current object. */
     WlzThreeDViewStruct *wlzViewStr;        /*!< Current view structure. */
+    WlzThreeDViewStruct *levelViewStr[WLZIMAGE_MAX_RESOLUTIONS];
+    					    /*!< View structures of the
+					         reduced resolution levels,
+						 level l being sampled at
+						 1/2^l of the current view's
+						 scale. Level 0 is
+						 wlzViewStr. */
+    WlzObject		*proxyObj[WLZIMAGE_MAX_RESOLUTIONS];
+    					    /*!< Downsampled proxies of the
+					         current object, by level,
+						 NULL where the full object
+						 is sectioned. */
+    WlzThreeDViewStruct *proxyViewStr[WLZIMAGE_MAX_RESOLUTIONS];
+    					    /*!< View structures for
+					         sectioning the proxies. */
     ViewParameters      *curViewParams;     /*!< Current view parameters,
                                                  partly redundant with
 						 wlzViewStr, however used to 
@@ -71,7 +133,9 @@ class WlzImage : public IIPImage
     						 user. These might not be
 						 reflected yet in wlzViewStr. */
     static WlzObjectCache wlzObjectCache;   /*!< Woolz object cache*/
-    WlzUByte	   	*tile_buf;          /*!< Tile data buffer */
+    static SingleFlight objectFlights;      /*!< Objects being read or
+    						 computed for the object
+						 cache. */
     int                 number_of_tiles;    /*!< Number of tiles */
     static const WlzInterpolationType interp ; /*!< Type of interpollation */
     int         	lastTileWidth;      /*!< Width for last column tiles */
@@ -79,6 +143,14 @@ class WlzImage : public IIPImage
     int                 ntlx;               /*!< Number of tiles per row */
     int                 ntly;               /*!< Number of tiles per columns */
     WlzUByte	        background[4];      /*!< Background value */
+    WlzViewDescriptor	hashDesc;	    /*!< View descriptor from which
+    						 the hashes were computed. */
+    bool		hashValid;	    /*!< True if the hashes are
+    						 valid for hashDesc. */
+    std::string		viewHash;	    /*!< Hash of the image and
+    						 view without selectors. */
+    std::string		imageHash;	    /*!< Hash of the image, view
+    						 and selectors. */
   public:
     // Constructors and destructor
     WlzImage();
@@ -105,13 +177,56 @@ class WlzImage : public IIPImage
 				  unsigned int r,
 				  unsigned int t)
       	        		throw(std::string);
+    bool			isEmptyTile(
+    				  int x,
+				  int y,
+				  unsigned int r,
+				  unsigned int t,
+				  RawTile &empty,
+				  unsigned char *bg);
+    RawTile 			getValueTile(
+    				  int x,
+				  int y,
+				  unsigned int r,
+				  unsigned int t)
+      	        		throw(std::string);
+    void			renderRegion(
+    				  WlzUByte *buf,
+				  WlzIVertex2 pos,
+				  WlzIVertex2 size)
+      	        		throw(std::string);
+    void			renderRegion(
+    				  WlzUByte *buf,
+				  WlzIVertex2 pos,
+				  WlzIVertex2 size,
+				  int level)
+      	        		throw(std::string);
+    void			getLevelSize(
+    				  int level,
+				  unsigned int &width,
+				  unsigned int &height);
     string			getFileName();
     const std::string 		getHash();
     // Woolz operations
     void			prepareObject()
     				throw(std::string);
+    static std::string		getCopyName(
+    				  const std::string &dir,
+				  const std::string &filename,
+				  const char *ext);
+    WlzObject			*readMappedObj(
+    				  const std::string &filename,
+				  bool &mapped,
+				  WlzErrorNum *dstErr);
+    WlzObject			*readTiledObj(
+    				  const std::string &filename,
+				  WlzErrorNum *dstErr);
     void			prepareViewStruct()
     				throw(std::string);
+    void			prepareLevels()
+    				throw(std::string);
+    void			prepareProxies()
+    				throw(std::string);
     bool			isViewChanged();
     WlzObject			*WlzImageExpEval(
     				  WlzExp *e);
@@ -164,7 +279,7 @@ class WlzImage : public IIPImage
     {
       WlzObject     *obj;
 
-      obj  = WlzAssignObject(wlzObjectCache.get(ois), NULL);
+      obj  = wlzObjectCache.get(ois);
       return(obj);
     }
 
@@ -271,28 +386,70 @@ class WlzImage : public IIPImage
 				  WlzObject *obj,
 				  WlzIVertex2  pos,
 				  WlzIVertex2  size,
-				  CompoundSelector *sel);
+				  CompoundSelector *sel,
+				  const CompositorLUT *lut);
+    WlzObject			*renderSection(
+    				  WlzObject *wlzObject,
+                                  WlzObject *tileObject,
+				  CompoundSelector *sel,
+				  int level,
+				  WlzErrorNum *dstErr);
     WlzErrorNum 		renderObj(
     				  WlzUByte* tile_buf,
 				  WlzObject *wlzObject,
                                   WlzObject *tileObject,
 				  WlzIVertex2  pos,
 			          WlzIVertex2  size,
-				  CompoundSelector *sel);
+				  CompoundSelector *sel,
+				  int level);
+    WlzObject			*getSubSectFromObject(
+    				  WlzObject *wlzObject,
+				  WlzThreeDViewStruct *vs,
+				  WlzObject *tileObject,
+				  CompoundSelector *sel,
+				  int level,
+				  WlzErrorNum *dstErr);
     WlzObject			*getSubProjFromObject(
     				  WlzObject *wlzObject,
 				  WlzObject *tileObject,
 				  CompoundSelector *sel,
+				  int level,
+				  WlzErrorNum *dstErr);
+    void			getTileRegion(
+    				  unsigned int res,
+				  unsigned int tile,
+				  int &level,
+				  WlzIVertex2 &pos,
+				  WlzIVertex2 &size)
+				throw(std::string);
+    bool			isRegionEmpty(
+    				  WlzIVertex2 pos,
+				  WlzIVertex2 size,
+				  int level);
+    static unsigned int		getExpDilation(
+    				  const WlzExp *exp);
+    WlzThreeDViewStruct		*makeViewStruct(
+    				  const std::string &hash,
+				  double scale,
+				  WlzObject *obj = NULL,
+				  int factor = 1)
+				throw(std::string);
+    WlzObject			*getProxyObj(
+    				  int factor,
 				  WlzErrorNum *dstErr);
+    void			freeLevels();
     WlzObject 			*getMapLUTObj(
     				  WlzErrorNum *dstErr);
+    bool			getMapLUT(
+    				  WlzObject *lutObj,
+				  CompositorLUT *lut);
     WlzObject 			*mapValueObj(
     				  WlzObject *iObj,
 				  WlzObject *lutObj,
     			   	  WlzErrorNum *dstErr);
     WlzDVertex3 		getCurrentPointInPlane();
-    const std::string 		generateHash(const ViewParameters *view);
-    const std::string 		selString(const ViewParameters* view );
+    void			updateHash();
+    const std::string		&getViewHash();
 
     /*!
      * \ingroup WlzIIPServer
@@ -0,0 +1,181 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _WlzMapObjMain_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         WlzMapObjMain.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	Makes mapped or tiled copies of Woolz object files, as
+* 		read by the Woolz IIP server when WLZ_MAPPED_DIR or
+* 		WLZ_TILED_DIR is set.
+* \ingroup	WlzIIPServer
+*/
+
+#define _MAIN_CC
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <Wlz.h>
+#include "Log.h"
+#include "CompressedFile.h"
+#include "MappedObj.h"
+
+int 		main(int argc, char *argv[])
+{
+  int		option,
+  		ok = 1,
+  		tiled = 0,
+  		usage = 0;
+  char		*inFileStr = NULL,
+  		*outFileStr = NULL,
+		*outDirStr = NULL;
+  FILE		*fP = NULL;
+  std::string	outName,
+  		tmpName;
+  WlzObject	*obj = NULL;
+  const char    *errMsgStr;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+  static char	optList[] = "d:ho:t";
+
+  while((usage == 0) && ((option = getopt(argc, argv, optList)) != EOF))
+  {
+    switch(option)
+    {
+      case 'd':
+        outDirStr = optarg;
+	break;
+      case 'o':
+        outFileStr = optarg;
+	break;
+      case 't':
+        tiled = 1;
+	break;
+      case 'h':
+      default:
+        usage = 1;
+	break;
+    }
+  }
+  if((usage == 0) && ((optind + 1) == argc) &&
+     ((outFileStr == NULL) != (outDirStr == NULL)))
+  {
+    inFileStr = argv[optind];
+    if(outDirStr)
+    {
+      char	pStr[32];
+
+      /* Named as the server names it and written to a temporary file
+       * which is renamed, so that servers never map a partial copy. */
+      outName = MappedObjCopyName(outDirStr, inFileStr,
+                                  (tiled)? MAPPEDOBJ_TILED_EXT: MAPPEDOBJ_EXT);
+      (void )snprintf(pStr, 32, ".%d", (int )getpid());
+      tmpName = outName + pStr;
+    }
+    else
+    {
+      outName = tmpName = outFileStr;
+    }
+  }
+  else
+  {
+    usage = 1;
+  }
+  ok = usage == 0;
+  if(ok)
+  {
+    if(((fP = CompressedFileOpen(inFileStr)) == NULL) ||
+       ((obj = WlzAssignObject(WlzReadObj(fP, &errNum), NULL)) == NULL) ||
+       (errNum != WLZ_ERR_NONE))
+    {
+      ok = 0;
+      (void )fprintf(stderr,
+                     "%s: failed to read object from file %s\n",
+		     *argv, inFileStr);
+    }
+    if(fP)
+    {
+      (void )fclose(fP);
+    }
+  }
+  if(ok)
+  {
+    errNum = (tiled)? MappedObjWriteTiled(tmpName.c_str(), obj):
+                      MappedObjWrite(tmpName.c_str(), obj);
+    if(errNum != WLZ_ERR_NONE)
+    {
+      ok = 0;
+      (void )WlzStringFromErrorNum(errNum, &errMsgStr);
+      (void )fprintf(stderr,
+                     "%s: failed to write %s object to file %s (%s)\n",
+		     *argv, (tiled)? "tiled": "mapped", outName.c_str(),
+		     errMsgStr);
+      (void )unlink(tmpName.c_str());
+    }
+    else if((tmpName != outName) &&
+            (rename(tmpName.c_str(), outName.c_str()) != 0))
+    {
+      ok = 0;
+      (void )fprintf(stderr,
+                     "%s: failed to rename %s to %s\n",
+		     *argv, tmpName.c_str(), outName.c_str());
+      (void )unlink(tmpName.c_str());
+    }
+  }
+  if(ok && outDirStr)
+  {
+    (void )printf("%s\n", outName.c_str());
+  }
+  (void )WlzFreeObj(obj);
+  if(usage)
+  {
+    (void )fprintf(stderr,
+    "Usage: %s [-h] [-t] [-d<directory>] [-o<output file>] <input file>\n"
+    "Writes a 3D domain object as a flat file which the Woolz IIP\n"
+    "server maps without reading or, with -t, as an object with tiled\n"
+    "grey values of which the server only reads the tiles it uses.\n"
+    "The server only uses copies in WLZ_MAPPED_DIR (or WLZ_TILED_DIR)\n"
+    "which are named by a hash of the input file name, so the input\n"
+    "file name must be given just as in the server's requests, ie the\n"
+    "(decoded) WLZ or FIF argument. Exactly one of -d or -o must be\n"
+    "given. Options are:\n"
+    "  -d  Directory, usually WLZ_MAPPED_DIR (or WLZ_TILED_DIR), in\n"
+    "      which to write the copy, named as the server names it. The\n"
+    "      name is printed.\n"
+    "  -o  Output file.\n"
+    "  -t  Write a tiled copy rather than a mapped copy.\n"
+    "  -h  Help, prints this usage message.\n",
+    *argv);
+  }
+  return(!ok);
+}
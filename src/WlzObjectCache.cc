@@ -40,6 +40,7 @@ static char _WlzObjectCache_cc[] = "University of Edinburgh $Id$";
 */
 
 #include "Log.h"
+#include "MappedObj.h"
 #include "WlzObjectCache.h"
 
 /*!
@@ -53,6 +54,7 @@ WlzObjectCache()
   size_t	 maxSz;
   
   enabled = 1;
+  pthread_mutex_init(&mutex, NULL);
   maxItem = Environment::getMaxWlzObjCacheCount();
   maxSz = MBytesToBytes(Environment::getMaxWlzObjCacheSize());
   objCache = AlcLRUCacheNew(maxItem, maxSz,
@@ -74,6 +76,7 @@ WlzObjectCache::
 {
   LOG_NOTICE("WlzObjectCache released.\n");
   AlcLRUCacheFree(objCache, 1);
+  pthread_mutex_destroy(&mutex);
 }
 
 /*!
@@ -81,9 +84,12 @@ WlzObjectCache::
 * \ingroup	WlzIIPServer
 * \brief	Computes the approximate object size in bytes.
 * \param	obj			The object.
+* \param	mapped			True if the intervals and values of
+* 					the object are in a mapped file and
+* 					so only its tables use memory.
 */
 size_t		WlzObjectCache::
-		ComputeObjectSize(WlzObject *obj)
+		ComputeObjectSize(WlzObject *obj, bool mapped)
 {
   size_t	sz = 0;
   WlzErrorNum	errNum = WLZ_ERR_NONE;
@@ -96,6 +102,15 @@ size_t		WlzObjectCache::
 	break;
       case WLZ_2D_DOMAINOBJ: /* FALLTHROUGH */
       case WLZ_3D_DOMAINOBJ:
+	if(mapped)
+	{
+	  WlzPlaneDomain *pDom = obj->domain.p;
+
+	  sz = (pDom->lastpl - pDom->plane1 + 1) *
+	       (sizeof(WlzIntervalDomain) + sizeof(WlzRectValues) +
+	        ((pDom->lastln - pDom->line1 + 1) * sizeof(WlzIntervalLine)));
+	  break;
+	}
 	sz = 4 * WlzIntervalCountObj(obj, &errNum);
 	if((errNum == WLZ_ERR_NONE) &&
 	   obj->values.core && !WlzGreyTableIsTiled(obj->values.core->type))
@@ -260,7 +275,8 @@ int		WlzObjectCache::
 * \ingroup	WlzIIPServer
 * \brief	This function is called when a cache entry is about to be
 * 		removed. This function frees the entry object and then the
-* 		entry itself.
+* 		entry itself, unmapping the object if it was mapped and
+* 		is no longer used.
 * \param	cache			The cache (unused).
 * \param	e			Cache entry.
 */
@@ -273,6 +289,7 @@ void		WlzObjectCache::
   {
     (void )WlzFreeObj(ent->obj);
     AlcFree(ent);
+    MappedObjRelease();
   }
 }
 
@@ -313,9 +330,12 @@ void 		WlzObjectCache::
 * \warning	Objects may not be cached if too big to fit.
 * \param    	obj       		WlzObj to be be inserted
 * \param    	str	  		String used to identify the object.
+* \param	mapped			True if the object's intervals and
+* 					values are in a mapped file, see
+* 					MappedObjRead().
 */
 void 		WlzObjectCache::
-		insert(WlzObject *obj, const std::string  str)
+		insert(WlzObject *obj, const std::string  str, bool mapped)
 		throw(std::string)
 {
   LOG_INFO("WlzObjectCache::insert " << str);
@@ -333,6 +353,7 @@ void 		WlzObjectCache::
 
       ent->obj = NULL;
       key = this->WlzObjCacheKeyFn(objCache, ent);
+      pthread_mutex_lock(&mutex);
       item = AlcLRUCItemFind(objCache, key, (void *)ent);
       LOG_INFO("WlzObjectCache::insert item in cache=" <<
 	       (item != NULL)? 1: 0);
@@ -341,10 +362,11 @@ void 		WlzObjectCache::
         size_t	sz;
 
 	ent->obj = WlzAssignObject(obj, NULL);
-	sz = ComputeObjectSize(obj);
+	sz = ComputeObjectSize(obj, mapped);
 	item = AlcLRUCEntryAddWithKey(objCache, sz, ent, key, &newFlg);
 	LOG_INFO("WlzObjectCache::insert sz=" << sz);
       }
+      pthread_mutex_unlock(&mutex);
       LOG_INFO("WlzObjectCache::insert item added to cache=" <<
 	       (newFlg != 0)? 1: 0);
       if(newFlg == 0)
@@ -364,7 +386,8 @@ void 		WlzObjectCache::
 
 /*!
 * \return	Pointer to the requested Woolz object or NULL if not found
-* 		in the cache.
+* 		in the cache. The object's linkcount is incremented before
+* 		the cache is unlocked so the caller must free it.
 * \ingroup  	WlzIIPServer
 * \brief    	Gets a Woolz object from the cache .
 * \param    	str     		String identifying the required
@@ -383,11 +406,13 @@ WlzObject 	*WlzObjectCache::
 
     ent.str = (char *)(str.c_str());
     key = this->WlzObjCacheKeyFn(objCache, &ent);
+    pthread_mutex_lock(&mutex);
     item = AlcLRUCItemFind(objCache, key, &ent);
     if(item)
     {
-      obj = ((WlzObjCacheEntry *)(item->entry))->obj;
+      obj = WlzAssignObject(((WlzObjCacheEntry *)(item->entry))->obj, NULL);
     }
+    pthread_mutex_unlock(&mutex);
 #ifdef WLZ_IIP_LOG
     if(obj)
     {
@@ -405,7 +430,9 @@ WlzObject 	*WlzObjectCache::
 
 /*!
 * \return	Pointer to the requested Woolz 3D view structure or NULL if
-*           	not found in the cache.
+*           	not found in the cache. The view structure's linkcount is
+*           	incremented before the cache is unlocked so the caller
+*           	must free it.
 * \ingroup	WlzIIPServer
 * \brief    	Gets a Woolz 3D view structure from the cache .
 * \param    	str     		String identifying the required
@@ -424,6 +451,7 @@ WlzThreeDViewStruct *WlzObjectCache::
 
     ent.str = (char *)(str.c_str());
     key = this->WlzObjCacheKeyFn(objCache, &ent);
+    pthread_mutex_lock(&mutex);
     item = AlcLRUCItemFind(objCache, key, &ent);
     if(item)
     {
@@ -432,9 +460,10 @@ WlzThreeDViewStruct *WlzObjectCache::
       obj = ((WlzObjCacheEntry *)(item->entry))->obj;
       if(obj && (obj->type = WLZ_3D_VIEW_STRUCT))
       {
-	vs = obj->domain.vs3d;
+	vs = WlzAssign3DViewStruct(obj->domain.vs3d, NULL);
       }
     }
+    pthread_mutex_unlock(&mutex);
   }
   return(vs);
 }
@@ -451,7 +480,9 @@ unsigned int 	WlzObjectCache::
 
   if(objCache)
   {
+    pthread_mutex_lock(&mutex);
     n = objCache->numItem;
+    pthread_mutex_unlock(&mutex);
   }
   return(n);
 }
@@ -464,7 +495,12 @@ unsigned int 	WlzObjectCache::
 float 		WlzObjectCache::
 		getMemorySize()
 {
-  return((float )BytesToMBytes(objCache->curSz));
+  size_t	sz;
+
+  pthread_mutex_lock(&mutex);
+  sz = objCache->curSz;
+  pthread_mutex_unlock(&mutex);
+  return((float )BytesToMBytes(sz));
 }
 
 /*!
@@ -478,6 +514,8 @@ void 		WlzObjectCache::
 {
   if(objCache)
   {
+    pthread_mutex_lock(&mutex);
     AlcLRUCacheMaxSz(objCache, BytesToMBytes(max));
+    pthread_mutex_unlock(&mutex);
   }
 };
@@ -44,6 +44,7 @@ static char _WlzObjectCache_h[] = "University of Edinburgh $Id$";
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <iostream>
 #include <list>
 #include <string>
@@ -65,6 +66,8 @@ typedef struct _WlzObjCacheEntry
 
 /*!
 * \brief        Cache for Woolz objects within a Woolz IIP server.
+* 		All public methods are serialised by a mutex so that the
+* 		cache may be shared by the request worker threads.
 * \ingroup      WlzIIPServer
 */
 class WlzObjectCache
@@ -73,6 +76,8 @@ class WlzObjectCache
     int			enabled;		/*!< Used to enable and disable
     						     the cache. */
     AlcLRUCache		*objCache;		/*!< Woolz object cache. */
+    pthread_mutex_t	mutex;			/*!< Serialises access to
+    						     the cache. */
     inline size_t 	MBytesToBytes(size_t m)
     			{
 			  const int	c = 1024 * 1024;
@@ -85,7 +90,8 @@ class WlzObjectCache
 
 			  return((b + c - 1) / c);
 			};
-    size_t		ComputeObjectSize(WlzObject *obj);
+    size_t		ComputeObjectSize(WlzObject *obj,
+    					  bool mapped = false);
     static unsigned int WlzObjCacheKeyFn(AlcLRUCache *cache, const void *e);
     static int		WlzObjCacheCmpFn(const void *e0, const void *e1);
     static void		WlzObjCacheUnlinkFn(AlcLRUCache *cache, const void *e);
@@ -95,7 +101,8 @@ class WlzObjectCache
     ~WlzObjectCache();
     void 		insert(WlzThreeDViewStruct *vs, const std::string  str)
                 	throw(std::string);
-    void 		insert(WlzObject *obj, const std::string  str)
+    void 		insert(WlzObject *obj, const std::string  str,
+    			       bool mapped = false)
                 	throw (std::string);
     WlzObject 		*get(std::string str);
     WlzThreeDViewStruct *getVS(std::string str);
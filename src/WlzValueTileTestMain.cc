@@ -0,0 +1,217 @@
+#if defined(__GNUC__)
+#ident "University of Edinburgh $Id$"
+#else
+static char _WlzValueTileTestMain_cc[] = "University of Edinburgh $Id$";
+#endif
+/*!
+* \file         WlzValueTileTestMain.cc
+* \author       agent
+* \date         October 2026
+* \version      $Id$
+* \par
+* Address:
+*               MRC Human Genetics Unit,
+*               MRC Institute of Genetics and Molecular Medicine,
+*               University of Edinburgh,
+*               Western General Hospital,
+*               Edinburgh, EH4 2XU, UK.
+* \par
+* Copyright (C), [2026],
+* The University Court of the University of Edinburgh,
+* Old College, Edinburgh, UK.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This program is distributed in the hope that it will be
+* useful but WITHOUT ANY WARRANTY; without even the implied
+* warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+* PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public
+* License along with this program; if not, write to the Free
+* Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+* Boston, MA  02110-1301, USA.
+* \brief	This is a test program for the encoding of the domains of
+* 		objects without values in the grey value tiles sent by
+* 		the VTL command of the Woolz IIP server.
+* \ingroup	WlzIIPServer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <Wlz.h>
+#include "ValueTile.h"
+
+/*!
+* \struct	WlzValueTileTestRegion
+* \ingroup	WlzIIPServer
+* \brief	Region of a tile.
+*/
+typedef struct _WlzValueTileTestRegion
+{
+  int		x0;			/*!< Column of the first pixel. */
+  int		y0;			/*!< Line of the first pixel. */
+  int		width;			/*!< Tile width. */
+  int		height;			/*!< Tile height. */
+} WlzValueTileTestRegion;
+
+static const WlzValueTileTestRegion WlzValueTileTestRegions[] =
+{
+  {0, 0, 64, 64},			/* Holds the whole of each object. */
+  {20, 20, 16, 16},			/* Within the objects. */
+  {40, -5, 30, 30},			/* Straddles the objects' edges. */
+  {-7, 25, 13, 9},			/* Straddles the objects' edges. */
+  {100, 100, 8, 8}			/* Outside of the objects. */
+};
+
+/*!
+* \return	Number of pixels of the tile which are wrongly set.
+* \ingroup	WlzIIPServer
+* \brief	Makes a grey value tile of the domain of the given object
+* 		and checks its header and that each of its values is 255
+* 		within the domain and 0 outside of it.
+* \param	name			Name of the object for the output.
+* \param	obj			2D domain object without values.
+* \param	r			Tile region.
+* \param	verbose			Print the tile if non zero.
+*/
+static int	WlzValueTileTest(const char *name, WlzObject *obj,
+				 const WlzValueTileTestRegion *r, int verbose)
+{
+  int		x,
+  		y,
+		nBad = 0;
+  const int	dataSz = r->width * r->height;
+  unsigned char	*buf;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+
+  if((buf = (unsigned char *)calloc(VALUETILE_HEADER_SZ + dataSz,
+				    1)) == NULL)
+  {
+    (void )fprintf(stderr, "%s: failed to allocate tile\n", name);
+    return(dataSz);
+  }
+  ValueTileSetHeader(buf, VALUETILE_UBYTE, VALUETILE_NONE,
+		     r->width, r->height, dataSz);
+  if(memcmp(buf, "WLZV", 4) || (buf[5] != VALUETILE_UBYTE) ||
+     ((buf[8] | (buf[9] << 8)) != r->width) ||
+     ((buf[10] | (buf[11] << 8)) != r->height))
+  {
+    (void )fprintf(stderr, "%s: bad tile header\n", name);
+    ++nBad;
+  }
+  errNum = ValueTileSetDomain(buf + VALUETILE_HEADER_SZ, obj,
+			      r->x0, r->y0, r->width, r->height);
+  if(errNum != WLZ_ERR_NONE)
+  {
+    (void )fprintf(stderr, "%s: failed to set domain (%s)\n",
+		   name, WlzStringFromErrorNum(errNum, NULL));
+    nBad += dataSz;
+  }
+  for(y = 0; (errNum == WLZ_ERR_NONE) && (y < r->height); ++y)
+  {
+    for(x = 0; x < r->width; ++x)
+    {
+      const unsigned char v = buf[VALUETILE_HEADER_SZ + (y * r->width) + x];
+      const unsigned char expV = WlzInsideDomain(obj, 0.0, r->y0 + y,
+					         r->x0 + x, NULL)? 255: 0;
+
+      if(v != expV)
+      {
+	++nBad;
+      }
+      if(verbose)
+      {
+        (void )putchar((v == 255)? '#': (v == 0)? '.': '?');
+      }
+    }
+    if(verbose)
+    {
+      (void )putchar('\n');
+    }
+  }
+  (void )printf("%s, tile %d,%d %dx%d: %s\n",
+		name, r->x0, r->y0, r->width, r->height,
+		(nBad == 0)? "passed": "FAILED");
+  free(buf);
+  return(nBad);
+}
+
+int 		main(int argc, char *argv[])
+{
+  int		i,
+  		option,
+		nBad = 0,
+  		usage = 0,
+		verbose = 0;
+  WlzDomain	dom;
+  WlzValues	val;
+  WlzObject	*rectObj = NULL,
+  		*discObj = NULL;
+  WlzErrorNum	errNum = WLZ_ERR_NONE;
+  static char	optList[] = "hv";
+
+  while((usage == 0) && ((option = getopt(argc, argv, optList)) != EOF))
+  {
+    switch(option)
+    {
+      case 'v':
+        verbose = 1;
+	break;
+      case 'h':
+      default:
+        usage = 1;
+	break;
+    }
+  }
+  usage = usage || (optind != argc);
+  if(usage)
+  {
+    (void )fprintf(stderr,
+    "Usage: %s [-h] [-v]\n"
+    "Tests the grey value tiles of the Woolz IIP server VTL command for\n"
+    "objects without values, which should be 255 within the domain and 0\n"
+    "outside of it. The tiles of a rectangle and of a disc are checked.\n"
+    "Options are:\n"
+    "  -v  Verbose, prints each tile.\n"
+    "  -h  Help, prints this usage message.\n",
+    *argv);
+    return(1);
+  }
+  val.core = NULL;
+  if((dom.i = WlzMakeIntervalDomain(WLZ_INTERVALDOMAIN_RECT,
+				    10, 50, 5, 45, &errNum)) != NULL)
+  {
+    rectObj = WlzAssignObject(WlzMakeMain(WLZ_2D_DOMAINOBJ, dom, val,
+					  NULL, NULL, &errNum), NULL);
+  }
+  if(errNum == WLZ_ERR_NONE)
+  {
+    discObj = WlzAssignObject(WlzMakeSphereObject(WLZ_2D_DOMAINOBJ, 20.0,
+						  30.0, 30.0, 0.0,
+						  &errNum), NULL);
+  }
+  if(errNum != WLZ_ERR_NONE)
+  {
+    (void )fprintf(stderr, "%s: failed to make test objects (%s)\n",
+		   *argv, WlzStringFromErrorNum(errNum, NULL));
+    return(1);
+  }
+  for(i = 0; i < (int )(sizeof(WlzValueTileTestRegions) /
+			sizeof(WlzValueTileTestRegion)); ++i)
+  {
+    nBad += WlzValueTileTest("rectangle", rectObj,
+			     WlzValueTileTestRegions + i, verbose);
+    nBad += WlzValueTileTest("disc", discObj,
+			     WlzValueTileTestRegions + i, verbose);
+  }
+  (void )WlzFreeObj(rectObj);
+  (void )WlzFreeObj(discObj);
+  return(nBad != 0);
+}
@@ -29,6 +29,8 @@ static char _Writer_h[] = "University of Edinburgh $Id$";
 
 #include <fcgiapp.h>
 #include <cstdio>
+#include <cstring>
+#include <string>
 
 
 /// Virtual base class for various writers
@@ -57,10 +59,12 @@ class Writer {
 
 };
 
+inline Writer::~Writer() {}
+
 
 
 /// FCGI Writer Class
-class FCGIWriter {
+class FCGIWriter : public Writer {
 
  private:
 
@@ -88,7 +92,7 @@ class FCGIWriter {
 
 
 /// File Writer Class
-class FileWriter {
+class FileWriter : public Writer {
 
  private:
 
@@ -115,4 +119,91 @@ class FileWriter {
   
 
 
+
+/// Buffer Writer Class, which keeps the output for the HTTP server
+class BufferWriter : public Writer {
+
+ private:
+
+  std::string buf;
+
+ public:
+
+  int putStr( const char* msg, int len ){
+    buf.append( msg, len );
+    return len;
+  };
+  int putS( const char* msg ){
+    int len = strlen( msg );
+    buf.append( msg, len );
+    return len;
+  }
+  int printf( const char* msg ){
+    return putS( msg );
+  };
+  int flush(){
+    return 0;
+  };
+
+  /// Get the output written so far
+  std::string& getBuffer(){ return buf; };
+
+};
+
+
+
+/// Recording Writer Class, which passes output on to another writer and
+/// keeps a copy of it, up to a limit, for the response cache
+class RecordingWriter : public Writer {
+
+ private:
+
+  Writer* out;
+  std::string record;
+  size_t limit;
+  bool complete;
+
+  void keep( const char* msg, int len ){
+    if( complete && len > 0 ){
+      if( record.size() + len > limit ){
+	complete = false;
+	record.clear();
+      }
+      else record.append( msg, len );
+    }
+  };
+
+ public:
+
+  /// Constructor
+  /** \param o writer to pass the output on to
+      \param l maximum size of the copy kept, nothing is kept if zero
+   */
+  RecordingWriter( Writer* o, size_t l ){ out = o; limit = l; complete = l > 0; };
+
+  int putStr( const char* msg, int len ){
+    keep( msg, len );
+    return out->putStr( msg, len );
+  };
+  int putS( const char* msg ){
+    keep( msg, strlen( msg ) );
+    return out->putS( msg );
+  }
+  int printf( const char* msg ){
+    keep( msg, strlen( msg ) );
+    return out->printf( msg );
+  };
+  int flush(){
+    return out->flush();
+  };
+
+  /// Whether all the output has been kept
+  bool isComplete(){ return complete; };
+
+  /// Get the copy of the output
+  const std::string& getRecord(){ return record; };
+
+};
+
+
 #endif